@@ -27,6 +27,18 @@ class ErrorBufferInterface;
 PatternLexerInterface* createPatternLexer_std(
 		ErrorBufferInterface* errorhnd);
 
+/// \brief Create the interface for regular expression matching on text with a table driven DFA for small sets of simple token expressions
+/// \note Faster than the lexer created with createPatternLexer_std for sets of up to a few hundred token expressions matched on short inputs like queries:
+///	Compiling takes no more than milliseconds, a context has no scratch space to allocate and the scan has no callbacks.
+///	The lexer created with createPatternLexer_std is faster for big sets of expressions and for long documents, as this lexer runs the automaton from each start position.
+/// \note Supports a subset of the regular expression syntax without anchors, word boundaries, edit distance and sub expressions as result.
+///	The instances implement the basic interfaces only, they do not implement the extensions (stream, pipeline, cache, dictionaries)
+/// \note Available by linking this library, the analyzer module exports the lexer "std" only, because its entry point registers one lexer and one matcher
+/// \note For the supported expressions the lexems reported are the same as the ones of the lexer created with createPatternLexer_std:
+///	Each end of a match is assigned to the leftmost start it is reached from and the longest match assigned to a start is reported.
+PatternLexerInterface* createPatternLexer_dfa(
+		ErrorBufferInterface* errorhnd);
+
 /// \brief Create the interface for pattern matching on a regular language with tokens as alphabet
 PatternMatcherInterface* createPatternMatcher_std(
 		ErrorBufferInterface* errorhnd);
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for receiving the lexems recognized by a pattern lexer
+/// \file "patternLexemSinkInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXEM_SINK_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXEM_SINK_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/position.hpp"
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for receiving the lexems recognized by a pattern lexer one by one, in the order they would appear in the result of a match
+class PatternLexemSinkInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexemSinkInterface(){}
+
+	/// \brief Receive a lexem
+	/// \param[in] id identifier of the lexem
+	/// \param[in] ordpos ordinal position of the lexem
+	/// \param[in] origpos original position of the lexem in the source
+	/// \param[in] origsize original size of the lexem in bytes
+	virtual void pushLexem( unsigned int id, unsigned int ordpos, const analyzer::Position& origpos, unsigned int origsize)=0;
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Extension of the interface for detecting tokens defined as regular expressions in text
+/// \file "patternLexerContextExtInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_CONTEXT_EXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_CONTEXT_EXT_INTERFACE_HPP_INCLUDED
+#include "strus/patternLexerContextInterface.hpp"
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/analyzer/patternMatcherStatistics.hpp"
+#include "strus/patternLexemSinkInterface.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Extension of the pattern lexer context interface with functions specific to the standard lexer of this library
+/// \note Contexts created by instances of the lexer returned by createPatternLexer_std implement this interface and can be casted to it with dynamic_cast
+class PatternLexerContextExtInterface
+	:public PatternLexerContextInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexerContextExtInterface(){}
+
+	/// \brief Match a batch of independent sources, e.g. many short fields of a document, in one call
+	/// \param[in] srcar array of pointers to the sources
+	/// \param[in] srcsizear array of sizes of the sources in bytes
+	/// \param[in] nofsrc number of sources in the batch
+	/// \param[out] result where to write the lexems of all sources to, ordered by source, positions relative to the start of their source as if match was called for each source separately
+	/// \param[out] resultidxar where to write the index of the first lexem of each source in result to, nofsrc+1 elements with the size of result as last element
+	/// \return true on success, false on error
+	virtual bool matchBatch(
+			const char* const* srcar,
+			const std::size_t* srcsizear,
+			std::size_t nofsrc,
+			std::vector<analyzer::PatternLexem>& result,
+			std::vector<std::size_t>& resultidxar)=0;
+
+	/// \brief Match a source writing the result to a buffer provided by the caller
+	/// \param[in] src pointer to the source
+	/// \param[in] srcsize size of the source in bytes
+	/// \param[out] result where to write the lexems to, cleared before, but the capacity of the buffer is reused
+	/// \return true on success, false on error
+	virtual bool matchToBuffer( const char* src, std::size_t srcsize, std::vector<analyzer::PatternLexem>& result)=0;
+
+	/// \brief Match a source passing the lexems one by one to a sink provided by the caller without building a result
+	/// \param[in] src pointer to the source
+	/// \param[in] srcsize size of the source in bytes
+	/// \param[in] sink where to push the lexems to
+	/// \return true on success, false on error
+	/// \note In case of an error, some lexems might have been pushed to the sink already
+	virtual bool matchToSink( const char* src, std::size_t srcsize, PatternLexemSinkInterface* sink)=0;
+
+	/// \brief Match a document split into segments, e.g. by a document segmenter, in one call without joining the segments
+	/// \param[in] segidar array of the identifiers of the segments, the origseg of the positions of the lexems found in them
+	/// \param[in] srcar array of pointers to the segments
+	/// \param[in] srcsizear array of sizes of the segments in bytes
+	/// \param[in] nofseg number of segments
+	/// \param[out] result where to write the lexems of all segments to, cleared before, ordered by segment, the positions relative to the start of their segment
+	/// \return true on success, false on error
+	/// \note Every segment is scanned on its own, lexems do not span segments. The ordinal positions are continuous across the segments, every segment starts a new ordinal position
+	virtual bool matchSegments(
+			const int* segidar,
+			const char* const* srcar,
+			const std::size_t* srcsizear,
+			std::size_t nofseg,
+			std::vector<analyzer::PatternLexem>& result)=0;
+
+	/// \brief Get the statistics of the matches of this context since its creation
+	/// \return the statistics
+	virtual analyzer::PatternMatcherStatistics getStatistics() const=0;
+};
+
+}//namespace
+#endif
+
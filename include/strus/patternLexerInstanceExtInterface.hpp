@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Extension of the interface for building an automaton for detecting tokens defined as regular expressions in text
+/// \file "patternLexerInstanceExtInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_INSTANCE_EXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_INSTANCE_EXT_INTERFACE_HPP_INCLUDED
+#include "strus/patternLexerInstanceInterface.hpp"
+#include <string>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Forward declaration
+class PatternLexerStreamContextInterface;
+/// \brief Forward declaration
+class PatternMatchPipelineInterface;
+/// \brief Forward declaration
+class PatternMatcherInstanceInterface;
+
+/// \brief Extension of the pattern lexer instance interface with functions specific to the standard lexer of this library
+/// \note Instances created by the lexer returned by createPatternLexer_std implement this interface and can be casted to it with dynamic_cast
+class PatternLexerInstanceExtInterface
+	:public PatternLexerInstanceInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexerInstanceExtInterface(){}
+
+	/// \brief Create the context to process a document fed chunk by chunk with the pattern lexer
+	/// \return the lexer context (with ownership)
+	/// \note The instance has to be compiled with the option "STREAM"
+	virtual PatternLexerStreamContextInterface* createStreamContext() const=0;
+
+	/// \brief Create a pipeline feeding the lexems of this lexer directly to a pattern matcher
+	/// \param[in] matcher the pattern matcher instance, has to be created by the matcher returned by createPatternMatcher_std
+	/// \return the pipeline (with ownership)
+	virtual PatternMatchPipelineInterface* createMatchPipeline( const PatternMatcherInstanceInterface* matcher) const=0;
+
+	/// \brief Define a directory where the compiled automata are stored and loaded from on the next compilation of the same definitions on the same platform
+	/// \param[in] path path of the directory (must exist)
+	/// \note Has to be called before 'compile'
+	/// \note The cache stores the compiled automata with the analysis of the expressions, a compilation loading them does not parse the expressions anymore.
+	///	The regular expressions for the rematch of patterns selecting a sub expression or matched approximatively are compiled in any case, they are not cached.
+	virtual void defineCacheDirectory( const std::string& path)=0;
+
+	/// \brief Define the symbols of a pattern in bulk with a dictionary file
+	/// \param[in] patternid identifier of the pattern the symbols are defined for, the same as for 'defineSymbol'
+	/// \param[in] path path of the dictionary, either a text file with one symbol per line, the name followed by a tab and the symbol identifier, or the image of a dictionary built from such a file
+	/// \note The symbols are looked up with a minimal perfect hash. The image of a dictionary built from a text file is stored in the cache directory if defined before with 'defineCacheDirectory' and mapped read only from there, shared by all processes using it
+	/// \note Symbols defined with 'defineSymbol' have precedence
+	/// \note With the option "NORMALIZE" or "NODIACRITICS" the keys are normalized like the sources matched. The option has to be defined before, an image built with another normalization is rejected
+	virtual void defineSymbolDictionary( unsigned int patternid, const std::string& path)=0;
+
+	/// \brief Restrict the lexems compiled to the ones used as terms by the patterns of a pattern matcher
+	/// \param[in] matcher the pattern matcher instance with its patterns defined, has to be created by the matcher returned by createPatternMatcher_std
+	/// \note A lexem is used if its identifier or the identifier of one of its symbols is a term of a pattern. Lexems with a symbol dictionary are always used
+	/// \note Has to be called before 'compile', the lexems are selected when they are compiled. The lexems not used are neither scanned for nor reported
+	/// \remark Lexems not reported do not get an ordinal position and do not supersede other lexems. Lexems needed for this have to be marked with 'defineAlwaysEmit'
+	virtual void defineUsedTerms( const PatternMatcherInstanceInterface* matcher)=0;
+
+	/// \brief Mark a lexem to be compiled even if it is not used by the pattern matcher passed with 'defineUsedTerms'
+	/// \param[in] id identifier of the lexem, the same as for 'defineLexem'
+	virtual void defineAlwaysEmit( unsigned int id)=0;
+
+	/// \brief Merge the layers of the lexer into one, recompiling all patterns compiled
+	/// \return true on success, false on error
+	/// \note Lexems and symbols can be defined after 'compile'. Calling 'compile' again compiles the lexems defined since into a small layer added to the databases compiled before, the matches of all layers are merged into one lexem stream
+	/// \note Every call of 'compile' or 'mergeLayers' publishes an immutable snapshot of the compiled lexer. Contexts keep the snapshot they scan with and switch to the latest one on their next match, stream contexts on their next reset
+	/// \note May be called in a background thread while contexts are matching. Matching does not lock anything as long as no snapshot is published
+	/// \note The patterns are recompiled without blocking definitions and compilations called in the meantime, lexems defined meanwhile stay in the next layer.
+	///	The layers compiled meanwhile are kept on top of the merged one, they are compiled again if the code page of the approximative patterns changed
+	/// \note Symbols defined after 'compile' are visible to the contexts after the next call of 'compile'. Options cannot be defined anymore after the first call of 'compile'
+	/// \note The layers are replaced only if the merge succeeds
+	virtual bool mergeLayers()=0;
+};
+
+}//namespace
+#endif
+
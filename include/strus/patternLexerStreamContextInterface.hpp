@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for detecting tokens defined as regular expressions in a text fed chunk by chunk
+/// \file "patternLexerStreamContextInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_STREAM_CONTEXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_STREAM_CONTEXT_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/analyzer/patternMatcherStatistics.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting tokens defined as regular expressions in a text that is not available as one contiguous buffer
+/// \remark The state of the scanner is kept between chunks, so lexems spanning chunk borders are recognized and the positions reported are relative to the start of the document
+class PatternLexerStreamContextInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexerStreamContextInterface(){}
+
+	/// \brief Feed the next chunk of the document
+	/// \param[in] chunk pointer to the chunk
+	/// \param[in] chunksize size of the chunk in bytes
+	/// \remark A chunk may end in the middle of a multibyte UTF-8 character
+	virtual void putInput( const char* chunk, std::size_t chunksize)=0;
+
+	/// \brief Signal the end of the document
+	/// \remark Lexems not fetched yet are fetched with the next call of fetchResults()
+	virtual void close()=0;
+
+	/// \brief Fetch the lexems recognized since the last call of this function that cannot be superseded anymore by input following
+	/// \return the list of lexems with ordinal and original positions relative to the start of the document
+	virtual std::vector<analyzer::PatternLexem> fetchResults()=0;
+
+	/// \brief Reset the context for scanning a new document
+	virtual void reset()=0;
+
+	/// \brief Get the statistics of the matches of this context since its creation
+	/// \return the statistics
+	virtual analyzer::PatternMatcherStatistics getStatistics() const=0;
+};
+
+}//namespace
+#endif
+
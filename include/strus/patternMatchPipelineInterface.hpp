@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for detecting patterns in a document with the tokens of a pattern lexer fed directly to a pattern matcher
+/// \file "patternMatchPipelineInterface.hpp"
+#ifndef _STRUS_PATTERN_MATCH_PIPELINE_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCH_PIPELINE_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternMatcherResult.hpp"
+#include "strus/analyzer/patternMatcherStatistics.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting patterns in a document with the tokens of a pattern lexer fed directly to a pattern matcher
+/// \remark Equivalent to feeding the result of PatternLexerContextInterface::match lexem by lexem to PatternMatcherContextInterface::putInput, but without building the list of lexems
+class PatternMatchPipelineInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternMatchPipelineInterface(){}
+
+	/// \brief Detect the patterns in a document
+	/// \param[in] src pointer to the document
+	/// \param[in] srcsize size of the document in bytes
+	/// \return the patterns detected
+	virtual std::vector<analyzer::PatternMatcherResult> match( const char* src, std::size_t srcsize)=0;
+
+	/// \brief Get the statistics of the pattern matcher for the last document processed and of the lexer accumulated over all documents processed since the creation of the pipeline
+	/// \return the statistics
+	virtual analyzer::PatternMatcherStatistics getStatistics() const=0;
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Cache for hyperscan databases compiled for pattern lexers stored as files in a directory
+/// \file "lexerDatabaseCache.cpp"
+#include "lexerDatabaseCache.hpp"
+#include "serializer.hpp"
+#include "internationalization.hpp"
+#include "strus/base/stdint.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace strus;
+
+#define CACHE_FILE_MAGIC "strus pattern lexer database"
+enum {CacheFileFormatVersion=2};
+
+static uint64_t fnv1aHash( const std::string& str)
+{
+	uint64_t rt = 14695981039346656037ULL;
+	std::string::const_iterator si = str.begin(), se = str.end();
+	for (; si != se; ++si)
+	{
+		rt ^= (unsigned char)*si;
+		rt *= 1099511628211ULL;
+	}
+	return rt;
+}
+
+static bool readFile( const std::string& path, std::string& content)
+{
+	FILE* fh = std::fopen( path.c_str(), "rb");
+	if (!fh) return false;
+	char buf[ 1<<16];
+	std::size_t nn;
+	while (0!=(nn=std::fread( buf, 1, sizeof(buf), fh)))
+	{
+		content.append( buf, nn);
+	}
+	bool rt = !std::ferror( fh);
+	std::fclose( fh);
+	return rt;
+}
+
+static void writeFileAtomic( const std::string& path, const std::string& content)
+{
+	char tmpext[ 64];
+	std::snprintf( tmpext, sizeof(tmpext), ".tmp%u", (unsigned int)::getpid());
+	std::string tmppath( path + tmpext);
+
+	FILE* fh = std::fopen( tmppath.c_str(), "wb");
+	if (!fh)
+	{
+		throw strus::runtime_error( _TXT("failed to open file '%s' for writing: %s"), tmppath.c_str(), std::strerror( errno));
+	}
+	std::size_t nn = std::fwrite( content.c_str(), 1, content.size(), fh);
+	int ec = (nn != content.size()) ? errno : 0;
+	if (std::fclose( fh) != 0 && !ec) ec = errno;
+	if (ec)
+	{
+		std::remove( tmppath.c_str());
+		throw strus::runtime_error( _TXT("failed to write file '%s': %s"), tmppath.c_str(), std::strerror( ec));
+	}
+	//... other processes see either the old or the complete new file
+	if (0!=std::rename( tmppath.c_str(), path.c_str()))
+	{
+		ec = errno;
+		std::remove( tmppath.c_str());
+		throw strus::runtime_error( _TXT("failed to rename file '%s': %s"), tmppath.c_str(), std::strerror( ec));
+	}
+}
+
+std::string LexerDatabaseCache::cacheFilePath( const char* prefix, const std::string& signature, const char* extension) const
+{
+	char filename[ 64];
+	std::snprintf( filename, sizeof(filename), "%s_%016llx.%s", prefix, (unsigned long long)fnv1aHash( signature), extension);
+	std::string rt( m_directory);
+	if (!rt.empty() && rt[ rt.size()-1] != '/') rt.push_back( '/');
+	rt.append( filename);
+	return rt;
+}
+
+std::string LexerDatabaseCache::filePath( const std::string& signature) const
+{
+	return cacheFilePath( "lexer", signature, "hsdb");
+}
+
+std::string LexerDatabaseCache::dictionaryFilePath( const std::string& signature) const
+{
+	return cacheFilePath( "symbols", signature, "dict");
+}
+
+static void freeDatabases( hs_database_t** dbar, std::size_t nofdb)
+{
+	std::size_t di = 0;
+	for (; di != nofdb; ++di)
+	{
+		if (dbar[ di]) hs_free_database( dbar[ di]);
+		dbar[ di] = 0;
+	}
+}
+
+bool LexerDatabaseCache::load( const std::string& signature, std::string& analysis, hs_database_t** dbar, std::size_t nofdb) const
+{
+	std::size_t di = 0;
+	for (; di != nofdb; ++di) dbar[ di] = 0;
+
+	std::string content;
+	if (!readFile( filePath( signature), content)) return false;
+	try
+	{
+		Deserializer ds( content.c_str(), content.size());
+		if (ds.unpackString() != CACHE_FILE_MAGIC) return false;
+		if (ds.unpackUint32() != (uint32_t)CacheFileFormatVersion) return false;
+		if (ds.unpackString() != signature) return false;
+		//... different definition with the same hash
+		analysis = ds.unpackString();
+		if (ds.unpackUint32() != (uint32_t)nofdb) return false;
+
+		for (di=0; di != nofdb; ++di)
+		{
+			std::size_t blobsize;
+			const char* blob = ds.unpackBlob( blobsize);
+			if (blobsize)
+			{
+				if (HS_SUCCESS != hs_deserialize_database( blob, blobsize, &dbar[ di]))
+				{
+					//... e.g. database of a different hyperscan version or platform
+					dbar[ di] = 0;
+					freeDatabases( dbar, nofdb);
+					return false;
+				}
+			}
+		}
+		if (!ds.eof())
+		{
+			freeDatabases( dbar, nofdb);
+			return false;
+		}
+		return true;
+	}
+	catch (const std::runtime_error&)
+	{
+		//... corrupt file, treated as not existing
+		freeDatabases( dbar, nofdb);
+		return false;
+	}
+}
+
+void LexerDatabaseCache::store( const std::string& signature, const std::string& analysis, const hs_database_t* const* dbar, std::size_t nofdb) const
+{
+	std::string content;
+	Serializer::packString( content, CACHE_FILE_MAGIC);
+	Serializer::packUint32( content, CacheFileFormatVersion);
+	Serializer::packString( content, signature);
+	Serializer::packString( content, analysis);
+	Serializer::packUint32( content, nofdb);
+
+	std::size_t di = 0;
+	for (; di != nofdb; ++di)
+	{
+		if (dbar[ di])
+		{
+			char* bytes = 0;
+			std::size_t length = 0;
+			hs_error_t err = hs_serialize_database( dbar[ di], &bytes, &length);
+			if (err != HS_SUCCESS)
+			{
+				throw strus::runtime_error( _TXT("failed to serialize hyperscan database (error code %d)"), (int)err);
+			}
+			Serializer::packBlob( content, bytes, length);
+			std::free( bytes);
+		}
+		else
+		{
+			Serializer::packBlob( content, "", 0);
+		}
+	}
+	writeFileAtomic( filePath( signature), content);
+}
+
+void LexerDatabaseCache::storeDictionary( const std::string& signature, const std::string& image) const
+{
+	//... the signature is part of the image, a different source with the same hash is detected on load
+	writeFileAtomic( dictionaryFilePath( signature), image);
+}
+
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Cache for hyperscan databases compiled for pattern lexers stored as files in a directory
+/// \file "lexerDatabaseCache.hpp"
+#ifndef _STRUS_PATTERN_LEXER_DATABASE_CACHE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_DATABASE_CACHE_HPP_INCLUDED
+#include "hs/hs.h"
+#include <string>
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Cache for hyperscan databases compiled for pattern lexers stored as files in a directory
+/// \note The file of a cache entry is selected by a hash of the signature of the lexer definition, the signature itself is stored in the file and compared on load
+/// \note An entry stores the databases and the results of the analysis of the patterns (literals and widths of matches), so that a lexer loaded does not parse its expressions.
+///	Not stored are the regular expressions for the rematch compiled with tre and the code page of the patterns matched on a one byte character set,
+///	they are structures in memory without serialization and are built from the definitions on every compilation.
+class LexerDatabaseCache
+{
+public:
+	LexerDatabaseCache()
+		:m_directory(){}
+	explicit LexerDatabaseCache( const std::string& directory_)
+		:m_directory(directory_){}
+	LexerDatabaseCache( const LexerDatabaseCache& o)
+		:m_directory(o.m_directory){}
+
+	/// \brief Evaluate if the cache is defined
+	bool defined() const
+	{
+		return !m_directory.empty();
+	}
+
+	/// \brief Load the databases stored for a lexer definition
+	/// \param[in] signature serialized lexer definition the databases were compiled for, including compile options and platform
+	/// \param[out] analysis results of the analysis of the patterns stored with the databases
+	/// \param[out] dbar array where to write the databases loaded to (with ownership), NULL for databases not defined
+	/// \param[in] nofdb number of elements in dbar
+	/// \return true on success, false if there exists no valid cache entry for the signature
+	bool load( const std::string& signature, std::string& analysis, hs_database_t** dbar, std::size_t nofdb) const;
+
+	/// \brief Store the databases compiled for a lexer definition
+	/// \param[in] signature serialized lexer definition the databases were compiled for, including compile options and platform
+	/// \param[in] analysis results of the analysis of the patterns to store with the databases
+	/// \param[in] dbar array of databases to store, NULL for databases not defined
+	/// \param[in] nofdb number of elements in dbar
+	/// \remark Throws on error
+	void store( const std::string& signature, const std::string& analysis, const hs_database_t* const* dbar, std::size_t nofdb) const;
+
+	/// \brief Get the path of the file storing the cache entry for a lexer definition
+	std::string filePath( const std::string& signature) const;
+
+	/// \brief Store the image of a symbol dictionary built from a file
+	/// \param[in] signature signature of the source of the dictionary
+	/// \param[in] image image of the dictionary
+	/// \remark Throws on error
+	void storeDictionary( const std::string& signature, const std::string& image) const;
+
+	/// \brief Get the path of the file storing the image of a symbol dictionary
+	std::string dictionaryFilePath( const std::string& signature) const;
+
+private:
+	std::string cacheFilePath( const char* prefix, const std::string& signature, const char* extension) const;
+
+private:
+	std::string m_directory;
+};
+
+}//namespace
+#endif
+
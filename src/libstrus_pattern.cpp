@@ -11,6 +11,7 @@
 #include "strus/errorBufferInterface.hpp"
 #include "patternMatcher.hpp"
 #include "patternLexer.hpp"
+#include "patternLexerDfa.hpp"
 #include "strus/base/dll_tags.hpp"
 #include "internationalization.hpp"
 #include "errorUtils.hpp"
@@ -46,3 +47,17 @@ DLL_PUBLIC PatternLexerInterface* strus::createPatternLexer_std( ErrorBufferInte
 	CATCH_ERROR_MAP_RETURN( _TXT("error creating char regex match interface: %s"), *errorhnd, 0);
 }
 
+DLL_PUBLIC PatternLexerInterface* strus::createPatternLexer_dfa( ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return new PatternLexerDfa( errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error creating DFA char regex match interface: %s"), *errorhnd, 0);
+}
+
@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Resolution of the match events of a lexer to lexems with ordinal positions, shared by the lexer implementations
+/// \file "matchEventList.hpp"
+#ifndef _STRUS_PATTERN_MATCH_EVENT_LIST_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCH_EVENT_LIST_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/analyzer/positionBind.hpp"
+#include "strus/base/stdint.h"
+#include <vector>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+
+namespace strus
+{
+
+/// \brief Match of a lexem with the level and the position binding of its definition
+struct MatchEvent
+{
+	uint32_t id;
+	uint8_t level;
+	uint8_t posbind;
+	uint16_t origsize;
+	uint32_t origpos;
+
+	MatchEvent()
+		:id(0),level(0),posbind(0),origsize(0),origpos(0){}
+	MatchEvent( uint32_t id_, uint8_t level_, uint8_t posbind_, uint32_t origpos_, uint32_t origsize_)
+		:id(id_),level(level_),posbind(posbind_),origsize(origsize_),origpos(origpos_){}
+	MatchEvent( const MatchEvent& o)
+		:id(o.id),level(o.level),posbind(o.posbind),origsize(o.origsize),origpos(o.origpos){}
+};
+
+/// \brief Maximum size of a lexem in bytes, determined by the range of MatchEvent::origsize
+enum {MaxLexemSize=0xFFFF};
+
+/// \brief Maximum number of events of a batch sorted in place without the temporary buffer of std::stable_sort, the batches of query sized inputs are below
+enum {SmallBatchSize=64};
+
+/// \brief Stable sort of a small sequence in place, without allocating memory
+/// \note The events arrive nearly sorted by their start, because they are reported by their end, so the number of moves is small
+template <class Iterator, class Compare>
+static void insertionSort( const Iterator& start, const Iterator& end, Compare cmp)
+{
+	if (start == end) return;
+	Iterator ii = start;
+	for (++ii; ii != end; ++ii)
+	{
+		if (!cmp( *ii, *(ii-1))) continue;
+		typename std::iterator_traits<Iterator>::value_type elem( *ii);
+		Iterator wi = ii;
+		for (; wi != start && cmp( elem, *(wi-1)); --wi)
+		{
+			*wi = *(wi-1);
+		}
+		*wi = elem;
+	}
+}
+
+/// \brief List of match events collected in the order of their arrival, resolved to a list sorted by original position without the events superseded
+/// \remark An event is superseded if it is completely covered by an event with a higher level or if a later event of the same pattern with the same level starts at the same position
+/// \remark An event is later than another if the match it was created from ends later or if it arrived later from the same end, so that the result does not depend on the order the matches of different databases arrive
+class MatchEventList
+{
+public:
+	typedef std::vector<MatchEvent>::const_iterator const_iterator;
+
+	MatchEventList()
+		:m_pending(),m_batch(),m_ar(),m_minPendingPos(std::numeric_limits<uint32_t>::max()),m_levelar(),m_nofSuperseded(0)
+	{
+		std::memset( m_levelEndAr, 0, sizeof(m_levelEndAr));
+		std::memset( m_coverEndAr, 0, sizeof(m_coverEndAr));
+	}
+
+	/// \brief Iterator on the start of the resolved events
+	const_iterator begin() const			{return m_ar.begin();}
+	/// \brief Iterator on the end of the resolved events
+	const_iterator end() const			{return m_ar.end();}
+	/// \brief Number of resolved events
+	std::size_t size() const			{return m_ar.size();}
+	/// \brief Number of events dropped by the resolution because they were superseded or covered by others, accumulated over all documents
+	unsigned long nofSuperseded() const		{return m_nofSuperseded;}
+
+	void reserve( std::size_t size_)		{m_pending.reserve( size_);}
+
+	/// \brief Clear the list including the state of the resolution
+	void clear()
+	{
+		m_pending.clear();
+		m_ar.clear();
+		m_minPendingPos = std::numeric_limits<uint32_t>::max();
+		std::vector<uint8_t>::const_iterator li = m_levelar.begin(), le = m_levelar.end();
+		for (; li != le; ++li)
+		{
+			m_levelEndAr[ *li] = 0;
+			m_coverEndAr[ *li] = 0;
+		}
+		m_levelar.clear();
+	}
+
+	/// \brief Remove the resolved events, keeping the events not resolved yet
+	void clearResolved()
+	{
+		m_ar.clear();
+	}
+
+	/// \brief Add a new match event
+	/// \param[in] matchEvent the event to add
+	/// \param[in] patternid identifier of the event assigned by a symbol lookup or the id of the event if there is no symbol assigned
+	/// \param[in] reportpos end of the match reported the event was created from
+	void add( const MatchEvent& matchEvent, unsigned int patternid, uint32_t reportpos)
+	{
+		m_pending.push_back( PendingEvent( matchEvent, reportpos, false/*symbol*/));
+		if (patternid != matchEvent.id)
+		{
+			m_pending.push_back( PendingEvent( MatchEvent( patternid, matchEvent.level, matchEvent.posbind, matchEvent.origpos, matchEvent.origsize), reportpos, true/*symbol*/));
+		}
+		if (matchEvent.origpos < m_minPendingPos) m_minPendingPos = matchEvent.origpos;
+	}
+
+	/// \brief Add the events not resolved yet of another list with an original position in a range, keeping the order of their arrival
+	/// \param[in] o list to add the events from
+	/// \param[in] startpos start of the range of original positions
+	/// \param[in] endpos end of the range of original positions
+	void addPending( const MatchEventList& o, uint32_t startpos, uint32_t endpos)
+	{
+		std::vector<PendingEvent>::const_iterator pi = o.m_pending.begin(), pe = o.m_pending.end();
+		for (; pi != pe; ++pi)
+		{
+			if (pi->event.origpos >= startpos && pi->event.origpos < endpos)
+			{
+				m_pending.push_back( *pi);
+				if (pi->event.origpos < m_minPendingPos) m_minPendingPos = pi->event.origpos;
+			}
+		}
+	}
+
+	/// \brief Resolve the order and the superseding of the events added with an original position before a horizon and append them to the resolved events
+	/// \param[in] horizon original position the events resolved start before
+	/// \note Events added later must not start before the horizon
+	void resolve( uint32_t horizon)
+	{
+		if (horizon <= m_minPendingPos) return;
+
+		// Extract the events before the horizon, keeping the order of their arrival:
+		m_batch.clear();
+		m_minPendingPos = std::numeric_limits<uint32_t>::max();
+		std::vector<PendingEvent>::iterator pi = m_pending.begin(), pe = m_pending.end(), pw = m_pending.begin();
+		for (; pi != pe; ++pi)
+		{
+			if (pi->event.origpos < horizon)
+			{
+				m_batch.push_back( *pi);
+				m_batch.back().seq = m_batch.size();
+			}
+			else
+			{
+				if (pi->event.origpos < m_minPendingPos) m_minPendingPos = pi->event.origpos;
+				*pw++ = *pi;
+			}
+		}
+		m_pending.erase( pw, pe);
+		if (m_batch.size() <= (std::size_t)SmallBatchSize)
+		{
+			insertionSort( m_batch.begin(), m_batch.end(), OrigPosOrder());
+		}
+		else
+		{
+			std::stable_sort( m_batch.begin(), m_batch.end(), OrigPosOrder());
+		}
+
+		// Sweep through the groups of events with the same original position:
+		std::vector<PendingEvent>::iterator gi = m_batch.begin(), ge = m_batch.begin(), be = m_batch.end();
+		for (; gi != be; gi = ge)
+		{
+			for (++ge; ge != be && ge->event.origpos == gi->event.origpos; ++ge){}
+			if (ge - gi > 1)
+			{
+				markDuplicates( gi, ge);
+			}
+			std::vector<PendingEvent>::iterator ei = gi;
+			for (; ei != ge; ++ei)
+			{
+				if (!ei->superseded) registerCoverage( ei->event);
+			}
+			updateCoverage();
+			for (ei = gi; ei != ge; ++ei)
+			{
+				if (!ei->superseded && !isCovered( ei->event))
+				{
+					m_ar.push_back( ei->event);
+				}
+				else
+				{
+					++m_nofSuperseded;
+				}
+			}
+		}
+	}
+
+	/// \brief Resolve all events added
+	void resolveAll()
+	{
+		resolve( std::numeric_limits<uint32_t>::max());
+	}
+
+private:
+	struct PendingEvent
+	{
+		MatchEvent event;
+		uint32_t reportpos;
+		uint32_t seq;
+		bool symbol;
+		bool superseded;
+
+		PendingEvent( const MatchEvent& event_, uint32_t reportpos_, bool symbol_)
+			:event(event_),reportpos(reportpos_),seq(0),symbol(symbol_),superseded(false){}
+		PendingEvent( const PendingEvent& o)
+			:event(o.event),reportpos(o.reportpos),seq(o.seq),symbol(o.symbol),superseded(o.superseded){}
+	};
+	struct OrigPosOrder
+	{
+		bool operator()( const PendingEvent& a, const PendingEvent& b) const
+		{
+			return a.event.origpos < b.event.origpos;
+		}
+	};
+	struct IdLevelArrivalOrder
+	{
+		bool operator()( const PendingEvent& a, const PendingEvent& b) const
+		{
+			if (a.event.id != b.event.id) return a.event.id < b.event.id;
+			if (a.event.level != b.event.level) return a.event.level < b.event.level;
+			if (a.reportpos != b.reportpos) return a.reportpos < b.reportpos;
+			return a.seq < b.seq;
+		}
+	};
+	struct ArrivalOrder
+	{
+		bool operator()( const PendingEvent& a, const PendingEvent& b) const
+		{
+			return a.seq < b.seq;
+		}
+	};
+
+	/// \brief Mark the events of a group starting at the same position that are replaced by an event of the same pattern and level arriving later
+	/// \note Symbol events do not replace other events, they are only replaced
+	static void markDuplicates( std::vector<PendingEvent>::iterator gi, const std::vector<PendingEvent>::iterator& ge)
+	{
+		std::sort( gi, ge, IdLevelArrivalOrder());
+		std::vector<PendingEvent>::iterator ri = gi, re = gi;
+		for (; ri != ge; ri = re)
+		{
+			std::vector<PendingEvent>::iterator lastPrimary = ge;
+			for (; re != ge && re->event.id == ri->event.id && re->event.level == ri->event.level; ++re)
+			{
+				if (!re->symbol) lastPrimary = re;
+			}
+			if (lastPrimary != ge)
+			{
+				for (; ri != lastPrimary; ++ri) ri->superseded = true;
+			}
+		}
+		std::sort( gi, ge, ArrivalOrder());
+	}
+
+	void registerCoverage( const MatchEvent& event)
+	{
+		uint64_t end = (uint64_t)event.origpos + event.origsize + 1;
+		if (m_levelEndAr[ event.level] == 0)
+		{
+			m_levelar.insert( std::lower_bound( m_levelar.begin(), m_levelar.end(), event.level), event.level);
+		}
+		if (m_levelEndAr[ event.level] < end)
+		{
+			m_levelEndAr[ event.level] = end;
+		}
+	}
+
+	/// \brief Calculate for each level the maximum end (+1) of the events seen with a higher level
+	void updateCoverage()
+	{
+		uint64_t maxEnd = 0;
+		std::vector<uint8_t>::const_reverse_iterator li = m_levelar.rbegin(), le = m_levelar.rend();
+		for (; li != le; ++li)
+		{
+			m_coverEndAr[ *li] = maxEnd;
+			if (maxEnd < m_levelEndAr[ *li]) maxEnd = m_levelEndAr[ *li];
+		}
+	}
+
+	/// \brief Evaluate if an event is completely covered by an event with a higher level starting before or at the same position
+	bool isCovered( const MatchEvent& event) const
+	{
+		return m_coverEndAr[ event.level] > (uint64_t)event.origpos + event.origsize;
+	}
+
+private:
+	std::vector<PendingEvent> m_pending;		///< events added but not resolved yet in the order of their arrival
+	std::vector<PendingEvent> m_batch;		///< buffer for the events resolved
+	std::vector<MatchEvent> m_ar;			///< resolved events
+	uint32_t m_minPendingPos;			///< minimum original position of the events not resolved yet
+	std::vector<uint8_t> m_levelar;			///< ascending list of levels of the events seen
+	uint64_t m_levelEndAr[ 256];		///< map level -> maximum end (+1) of the events seen with this level
+	uint64_t m_coverEndAr[ 256];		///< map level -> maximum end (+1) of the events seen with a higher level
+	unsigned long m_nofSuperseded;			///< number of events dropped by the resolution
+};
+
+/// \brief Output of lexems appending them to a vector
+class LexemVectorOutput
+{
+public:
+	/// \param[in] origseg_ segment of the positions of the lexems
+	explicit LexemVectorOutput( std::vector<analyzer::PatternLexem>& res_, int origseg_=0)
+		:m_res(res_),m_origseg(origseg_){}
+
+	void push( uint32_t id, uint32_t ordpos, uint32_t origpos, uint16_t origsize)
+	{
+		m_res.push_back( analyzer::PatternLexem( id, ordpos, analyzer::Position( m_origseg, origpos), origsize));
+	}
+
+private:
+	std::vector<analyzer::PatternLexem>& m_res;
+	int m_origseg;
+};
+
+/// \brief Evaluate if a sequence of match events contains an event binding an ordinal position, the lexems of the sequence are not valid otherwise
+inline bool containsContentEvent( MatchEventList::const_iterator mi, const MatchEventList::const_iterator& me)
+{
+	for (; mi != me; ++mi)
+	{
+		if (mi->posbind == (uint8_t)analyzer::BindContent || mi->posbind == (uint8_t)analyzer::BindUnique) return true;
+	}
+	return false;
+}
+
+/// \brief Assignment of ordinal positions to match events visited in ascending order of their original position
+class OrdinalPositionAssigner
+{
+public:
+	OrdinalPositionAssigner()
+		:m_ordpos(0),m_origpos(0),m_lastposbind((uint8_t)analyzer::BindContent),m_newSegment(false){}
+
+	void reset()
+	{
+		m_ordpos = 0;
+		m_origpos = 0;
+		m_lastposbind = (uint8_t)analyzer::BindContent;
+		m_newSegment = false;
+	}
+
+	/// \brief Declare the start of a new segment, the original positions of the elements appended next start again, the next element with content gets a new ordinal position
+	void startSegment()
+	{
+		if (m_ordpos) m_newSegment = true;
+	}
+
+	/// \brief Evaluate if an element binding a position has been visited, elements visited before are not valid otherwise
+	bool started() const
+	{
+		return m_ordpos != 0;
+	}
+
+	/// \brief Append the lexems for a sequence of match events to a result
+	/// \param[in,out] out where to append the lexems to (LexemVectorOutput or LexemSinkOutput)
+	/// \param[in] mi start of the sequence of events
+	/// \param[in] me end of the sequence of events
+	template <class Output>
+	void append( Output& out, MatchEventList::const_iterator mi, const MatchEventList::const_iterator& me)
+	{
+		for (; mi != me && m_ordpos == 0; ++mi)
+		{
+			switch ((analyzer::PositionBind)mi->posbind)
+			{
+				case analyzer::BindUnique:
+				case analyzer::BindContent:
+					m_ordpos = 1;
+					m_origpos = mi->origpos;
+					out.push( mi->id, 1, mi->origpos, mi->origsize);
+					break;
+				case analyzer::BindSuccessor:
+					out.push( mi->id, 1, mi->origpos, mi->origsize);
+					break;
+				case analyzer::BindPredecessor:
+					break;
+			}
+			m_lastposbind = mi->posbind;
+		}
+		for (; mi != me; ++mi)
+		{
+			switch ((analyzer::PositionBind)mi->posbind)
+			{
+				case analyzer::BindUnique:
+					if (m_lastposbind == (uint8_t)analyzer::BindUnique) break;
+				case analyzer::BindContent:
+					if (mi->origpos > m_origpos || m_newSegment)
+					{
+						m_origpos = mi->origpos;
+						m_newSegment = false;
+						++m_ordpos;
+					}
+					out.push( mi->id, m_ordpos, mi->origpos, mi->origsize);
+					break;
+				case analyzer::BindSuccessor:
+					out.push( mi->id, m_ordpos+1, mi->origpos, mi->origsize);
+					break;
+				case analyzer::BindPredecessor:
+					out.push( mi->id, m_ordpos, mi->origpos, mi->origsize);
+					break;
+			}
+			m_lastposbind = mi->posbind;
+		}
+	}
+
+private:
+	uint32_t m_ordpos;
+	uint32_t m_origpos;
+	uint8_t m_lastposbind;
+	bool m_newSegment;			///< true if a new segment started since the last element with content
+};
+
+}//namespace
+#endif
+
@@ -8,30 +8,51 @@
 /// \brief Implementation of detecting tokens defined as regular expressions on text
 /// \file "patternLexer.hpp"
 #include "patternLexer.hpp"
+#include "patternMatcher.hpp"
 #include "unicodeUtils.hpp"
 #include "strus/analyzer/patternLexem.hpp"
 #include "strus/analyzer/positionBind.hpp"
 #include "strus/patternLexerInstanceInterface.hpp"
 #include "strus/patternLexerContextInterface.hpp"
+#include "strus/patternLexerContextExtInterface.hpp"
+#include "strus/patternLexemSinkInterface.hpp"
+#include "strus/patternMatcherInstanceInterface.hpp"
+#include "strus/patternMatcherContextInterface.hpp"
+#include "strus/patternMatchPipelineInterface.hpp"
+#include "strus/patternLexerInstanceExtInterface.hpp"
+#include "strus/patternLexerStreamContextInterface.hpp"
 #include "strus/errorBufferInterface.hpp"
 #include "strus/reference.hpp"
 #include "strus/base/stdint.h"
 #include "strus/base/symbolTable.hpp"
 #include "strus/base/string_conv.hpp"
+#include "strus/base/unordered_map.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/local_ptr.hpp"
 #include "strus/debugTraceInterface.hpp"
 #include "compactNodeTrie.hpp"
 #include "errorUtils.hpp"
 #include "internationalization.hpp"
 #include "hyperscanErrorCode.hpp"
+#include "lexerDatabaseCache.hpp"
+#include "symbolDictionary.hpp"
+#include "serializer.hpp"
+#include "matchEventList.hpp"
 #include "hs/hs_compile.h"
 #include "hs/hs.h"
 #include <vector>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
 #include <stdexcept>
 #include <limits>
 #include <iostream>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <time.h>
 #undef TRE_USE_SYSTEM_REGEX_H
 #include <tre/tre.h>
 
@@ -48,6 +69,8 @@ public:
 	PatternDef()
 		:m_expression()
 		,m_expression_onebyte()
+		,m_literal()
+		,m_width(UndefinedWidth)
 		,m_subexpref(0)
 		,m_id(0)
 		,m_posbind(analyzer::BindContent)
@@ -65,6 +88,8 @@ public:
 			unsigned int symtabref_=0)
 		:m_expression(expression_)
 		,m_expression_onebyte()
+		,m_literal()
+		,m_width(UndefinedWidth)
 		,m_subexpref(subexpref_)
 		,m_id(id_)
 		,m_posbind(posbind_)
@@ -101,6 +126,8 @@ public:
 	PatternDef( const PatternDef& o)
 		:m_expression(o.m_expression)
 		,m_expression_onebyte(o.m_expression_onebyte)
+		,m_literal(o.m_literal)
+		,m_width(o.m_width)
 		,m_subexpref(o.m_subexpref)
 		,m_id(o.m_id)
 		,m_posbind(o.m_posbind)
@@ -145,6 +172,18 @@ public:
 	{
 		return m_expression_onebyte;
 	}
+	const std::string& literal() const
+	{
+		return m_literal;
+	}
+	bool hasFixedWidth() const
+	{
+		return m_width != UndefinedWidth;
+	}
+	uint32_t width() const
+	{
+		return m_width;
+	}
 	void setSymtabref( unsigned int symtabref_)
 	{
 		if (symtabref_ > std::numeric_limits<uint8_t>::max())
@@ -153,20 +192,32 @@ public:
 		}
 		m_symtabref = symtabref_;
 	}
-	void setExpressionOneByteCharMap()
+	void setExpressionOneByteCharMap( const OneByteCodePage* codepage)
 	{
 		OneByteCharMap obcmap;
-		obcmap.init( m_expression.c_str(), m_expression.size());
-		m_expression_onebyte = obcmap.value;
+		obcmap.init( m_expression.c_str(), m_expression.size(), codepage);
+		m_expression_onebyte = std::string( obcmap.data(), obcmap.size());
 	}
 	void setSubExpressionRef( unsigned int subexpref_)
 	{
 		m_subexpref = subexpref_;
 	}
+	void setLiteral( const std::string& literal_)
+	{
+		m_literal = literal_;
+	}
+	void setFixedWidth( uint32_t width_)
+	{
+		m_width = width_;
+	}
+
+	enum {UndefinedWidth=0xFFFFffffU};
 
 private:
 	std::string m_expression;		///< regular expression string
 	std::string m_expression_onebyte;	///< regular expression string mapped down to one byte character set for prematching
+	std::string m_literal;			///< string matched if the expression is a plain literal, empty else
+	uint32_t m_width;			///< width of all matches in bytes of the string scanned if fixed and compiled without start of match tracking, UndefinedWidth else
 	uint32_t m_subexpref;			///< index of sub expression in sub expression table, for 2nd matching to get the sub expression match
 	uint32_t m_id;				///< id of the lexem as defined by definedLexem
 	uint8_t m_posbind;			///< analyzer position bind specificaction
@@ -184,20 +235,24 @@ public:
 	unsigned int* idar;
 	unsigned int* flagar;
 	hs_expr_ext_t** extar;
+	std::size_t* lenar;		///< sizes of the patterns of a table of literals
+	bool literal;			///< true if the patterns are literals to be compiled with hs_compile_lit_multi
 
 	HsPatternTable()
-		:arsize(0),patternar(0),idar(0),flagar(0),extar(0)
+		:arsize(0),patternar(0),idar(0),flagar(0),extar(0),lenar(0),literal(false)
 	{}
 
-	void init( std::size_t arsize_)
+	void init( std::size_t arsize_, bool literal_=false)
 	{
 		arsize = arsize_;
+		literal = literal_;
 		clear();
 		patternar = (const char**)std::calloc( (arsize+1),sizeof(*patternar));
 		idar = (unsigned int*)std::calloc( (arsize+1),sizeof(*idar));
 		flagar = (unsigned int*)std::calloc( (arsize+1),sizeof(*flagar));
 		extar = (hs_expr_ext_t**)std::calloc( (arsize+1),sizeof(*extar));
-		if (!patternar | !idar | !flagar | !extar)
+		lenar = (std::size_t*)std::calloc( (arsize+1),sizeof(*lenar));
+		if (!patternar | !idar | !flagar | !extar | !lenar)
 		{
 			clear();
 			throw std::bad_alloc();
@@ -209,11 +264,23 @@ public:
 		clear();
 	}
 
+	/// \brief Evaluate if any pattern of a range of this table is compiled with start of match tracking
+	bool withStartOfMatch( std::size_t start, std::size_t size) const
+	{
+		std::size_t ai = start, ae = start + size;
+		for (; ai != ae; ++ai)
+		{
+			if (flagar[ai] & HS_FLAG_SOM_LEFTMOST) return true;
+		}
+		return false;
+	}
+
 	void clear()
 	{
 		if (patternar) {std::free(patternar); patternar = 0;}
 		if (idar) {std::free(idar); idar = 0;}
 		if (flagar) {std::free(flagar); flagar = 0;}
+		if (lenar) {std::free(lenar); lenar = 0;}
 		if (extar)
 		{
 			std::size_t ai = 0, ae = arsize;
@@ -227,21 +294,249 @@ public:
 	}
 };
 
+/// \brief Bounded cache of the results of the approximative rematch of candidates with tre, keyed by the sub expression and the bytes of the candidate inspected by the rematch
+/// \remark The cache is owned by a context and kept between documents, because the same surface strings of a language recur in many documents
+/// \remark The entries are held in two generations, the older one is dropped when the current one is full, entries found in the older one are moved to the current one
+class RematchCache
+{
+public:
+	/// \brief Maximum number of entries in one generation
+	enum {MaxNofEntries=4096};
+	/// \brief Maximum size of a candidate in bytes to be cached, longer candidates are rare and not worth to be cached
+	enum {MaxCandidateSize=256};
+
+	/// \brief Result of a rematch relative to the start of the candidate
+	struct Result
+	{
+		bool match;
+		uint32_t start;
+		uint32_t end;
+		int cost;
+
+		Result()
+			:match(false),start(0),end(0),cost(0){}
+		Result( bool match_, uint32_t start_, uint32_t end_, int cost_)
+			:match(match_),start(start_),end(end_),cost(cost_){}
+	};
+
+	RematchCache()
+		:m_curmap(),m_prevmap(),m_key(),m_nofLookups(0),m_nofHits(0){}
+
+	/// \brief Find the result of a rematch in the cache
+	/// \param[in] subexpref reference of the sub expression
+	/// \param[in] candidate pointer to the bytes inspected by the rematch
+	/// \param[in] candidatesize number of bytes inspected by the rematch
+	/// \param[out] result the result found
+	/// \return true if found, false if not
+	/// \note The key of the last lookup is kept for a following call of put
+	bool get( uint32_t subexpref, const char* candidate, std::size_t candidatesize, Result& result)
+	{
+		m_key.clear();
+		Serializer::packUint32( m_key, subexpref);
+		m_key.append( candidate, candidatesize);
+		++m_nofLookups;
+
+		Map::const_iterator ci = m_curmap.find( m_key);
+		if (ci != m_curmap.end())
+		{
+			result = ci->second;
+			++m_nofHits;
+			return true;
+		}
+		ci = m_prevmap.find( m_key);
+		if (ci != m_prevmap.end())
+		{
+			result = ci->second;
+			++m_nofHits;
+			put( result);
+			return true;
+		}
+		return false;
+	}
+
+	/// \brief Store the result of a rematch for the key of the last call of get
+	void put( const Result& result)
+	{
+		if (m_curmap.size() >= MaxNofEntries)
+		{
+			m_prevmap.swap( m_curmap);
+			m_curmap.clear();
+		}
+		m_curmap[ m_key] = result;
+	}
+
+	/// \brief Get the number of lookups since the creation of the cache
+	unsigned long nofLookups() const	{return m_nofLookups;}
+	/// \brief Get the number of lookups found in the cache since the creation of the cache
+	unsigned long nofHits() const		{return m_nofHits;}
+	/// \brief Get the ratio of lookups that were found in the cache
+	double hitRate() const			{return m_nofLookups ? ((double)m_nofHits / (double)m_nofLookups) : 0.0;}
+
+private:
+	typedef strus::unordered_map<std::string,Result> Map;
+	Map m_curmap;				///< current generation of entries
+	Map m_prevmap;				///< previous generation of entries
+	std::string m_key;			///< key of the last lookup
+	unsigned long m_nofLookups;		///< number of lookups
+	unsigned long m_nofHits;		///< number of lookups found
+};
+
+/// \brief Counters and timers of the phases of a lexer context, measured only if switched on with the option "STATISTICS"
+struct LexerProfile
+{
+	bool enabled;				///< true if the phases are measured
+	unsigned long nofBytes;			///< number of bytes of the sources scanned
+	unsigned long nofCallbacks;		///< number of matches reported by hyperscan
+	unsigned long nofRematchAccepted;	///< number of matches confirmed by a rematch
+	unsigned long nofRematchRejected;	///< number of matches rejected by a rematch
+	double timeNormalize;			///< seconds spent normalizing the sources
+	double timeCharMap;			///< seconds spent mapping the sources to a one byte character set
+	double timeScan;			///< seconds spent scanning with hyperscan, without the time of the callbacks measured
+	double timeRematch;			///< seconds spent rematching with tre
+	double timeSymbolLookup;		///< seconds spent looking up symbols
+	double timeResolve;			///< seconds spent resolving the order and the superseding of the events
+	double timeOutput;			///< seconds spent assigning the ordinal positions and passing the lexems to the output
+	std::vector<unsigned long> patternCallbacks;	///< number of matches reported per pattern index
+
+	LexerProfile()
+		:enabled(false),nofBytes(0),nofCallbacks(0),nofRematchAccepted(0),nofRematchRejected(0)
+		,timeNormalize(0.0),timeCharMap(0.0),timeScan(0.0),timeRematch(0.0),timeSymbolLookup(0.0),timeResolve(0.0),timeOutput(0.0)
+		,patternCallbacks(){}
+
+	/// \brief Count a match reported by hyperscan
+	/// \param[in] patternIdx index of the pattern starting with 1
+	void countCallback( unsigned int patternIdx)
+	{
+		++nofCallbacks;
+		if (patternCallbacks.size() < patternIdx) patternCallbacks.resize( patternIdx, 0);
+		++patternCallbacks[ patternIdx-1];
+	}
+
+	/// \brief Add the counters and timers of another profile, e.g. of a scanner of a piece of the document
+	void add( const LexerProfile& o)
+	{
+		nofBytes += o.nofBytes;
+		nofCallbacks += o.nofCallbacks;
+		nofRematchAccepted += o.nofRematchAccepted;
+		nofRematchRejected += o.nofRematchRejected;
+		timeNormalize += o.timeNormalize;
+		timeCharMap += o.timeCharMap;
+		timeScan += o.timeScan;
+		timeRematch += o.timeRematch;
+		timeSymbolLookup += o.timeSymbolLookup;
+		timeResolve += o.timeResolve;
+		timeOutput += o.timeOutput;
+		if (patternCallbacks.size() < o.patternCallbacks.size()) patternCallbacks.resize( o.patternCallbacks.size(), 0);
+		std::vector<unsigned long>::const_iterator ci = o.patternCallbacks.begin(), ce = o.patternCallbacks.end();
+		for (std::size_t cidx=0; ci != ce; ++ci,++cidx) patternCallbacks[ cidx] += *ci;
+	}
+};
+
+/// \brief Data of a context reused for the rematch of candidates
+struct RematchWorkspace
+{
+	RematchCache cache;			///< results of approximative rematches
+	WCharBuffer wcharbuf;			///< buffer for the conversion of candidates to wide characters
+	unsigned long nofCandidates;		///< number of candidates of patterns matched on the source mapped to a one byte character set
+	unsigned long nofFalseCandidates;	///< number of these candidates rejected by the rematch
+	LexerProfile profile;			///< counters and timers of the phases of the lexer
+
+	RematchWorkspace()
+		:cache(),wcharbuf(),nofCandidates(0),nofFalseCandidates(0),profile(){}
+};
+
+/// \brief Define the statistics of the candidates of patterns matched on the source mapped to a one byte character set
+static void defineCandidateStatistics( analyzer::PatternMatcherStatistics& stats, unsigned long nofCandidates, unsigned long nofFalseCandidates)
+{
+	if (nofCandidates)
+	{
+		stats.define( "nofApproxCandidates", nofCandidates);
+		stats.define( "approxFalsePositiveRate", (double)nofFalseCandidates / (double)nofCandidates);
+	}
+}
+
+
+static void joinThreads( std::vector<strus::Reference<strus::thread> >& threadGroup)
+{
+	std::vector<strus::Reference<strus::thread> >::iterator gi = threadGroup.begin(), ge = threadGroup.end();
+	for (; gi != ge; ++gi) (*gi)->join();
+}
+
+/// \brief Run workers in parallel, the first one in the calling thread, and wait for all to finish
+/// \remark The workers keep their errors, they are checked by the caller
+template <class Worker>
+static void runParallel( std::vector<strus::Reference<Worker> >& workers, std::size_t nofWorkers)
+{
+	std::vector<strus::Reference<strus::thread> > threadGroup;
+	try
+	{
+		std::size_t wi = 1;
+		for (; wi < nofWorkers; ++wi)
+		{
+			threadGroup.push_back( strus::Reference<strus::thread>( new strus::thread( &Worker::run, workers[ wi].get())));
+		}
+		if (nofWorkers) workers[ 0]->run();
+	}
+	catch (...)
+	{
+		joinThreads( threadGroup);
+		throw;
+	}
+	joinThreads( threadGroup);
+}
 
 class PatternTable
 {
 public:
 	explicit PatternTable( ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_debugtrace(0),m_withOneByteCharMap(false)
+		:m_errorhnd(errorhnd_),m_debugtrace(0),m_withOneByteCharMap(false),m_normalization(0),m_nofCompleted(0)
+		,m_pruneUnused(false),m_usedTerms(),m_alwaysEmit(),m_nofPruned(0)
 	{
 		DebugTraceInterface* debugtrace = m_errorhnd->debugTrace();
 		if (debugtrace) m_debugtrace = debugtrace->createTraceContext( "pattern");
 	}
+	/// \brief Copy constructor for the snapshot of a table scanned by the contexts
+	/// \note The symbol tables are shared with the copy, the original has to call markSymbolTablesShared before defining a symbol again
+	PatternTable( const PatternTable& o)
+		:m_errorhnd(o.m_errorhnd),m_debugtrace(0),m_defar(o.m_defar),m_symtabmap(o.m_symtabmap),m_idsymtabmap(o.m_idsymtabmap),m_subexprmap(o.m_subexprmap)
+		,m_withOneByteCharMap(o.m_withOneByteCharMap),m_normalization(o.m_normalization),m_nofCompleted(o.m_nofCompleted)
+		,m_pruneUnused(o.m_pruneUnused),m_usedTerms(o.m_usedTerms),m_alwaysEmit(o.m_alwaysEmit),m_nofPruned(o.m_nofPruned){}
+
 	~PatternTable()
 	{
 		if (m_debugtrace) delete m_debugtrace;
 	}
 
+	/// \brief Mark the symbol tables as shared with a snapshot of this table, they are copied before a symbol is added to them
+	void markSymbolTablesShared()
+	{
+		std::vector<PatternSymbolTable>::iterator si = m_symtabmap.begin(), se = m_symtabmap.end();
+		for (; si != se; ++si) si->shared = true;
+	}
+
+	/// \brief Drop the definitions after a number of definitions completed, for a copy recompiling the patterns compiled so far
+	/// \param[in] nofDefinitions number of definitions kept
+	void truncate( std::size_t nofDefinitions)
+	{
+		if (nofDefinitions > m_nofCompleted)
+		{
+			throw std::runtime_error( _TXT("logic error: truncating pattern table to definitions not completed"));
+		}
+		m_defar.erase( m_defar.begin() + nofDefinitions, m_defar.end());
+		m_nofCompleted = nofDefinitions;
+	}
+
+	/// \brief Take the results of the preparation and the analysis of a range of definitions from a copy they have been compiled with
+	/// \param[in] o the copy compiled
+	/// \param[in] startidx index of the first definition compiled with the copy
+	/// \param[in] endidx index of the definition after the last one compiled with the copy
+	/// \param[in] nofPruned_ number of patterns pruned in all layers with the definitions taken
+	void adoptAnalysis( const PatternTable& o, std::size_t startidx, std::size_t endidx, std::size_t nofPruned_)
+	{
+		std::copy( o.m_defar.begin() + startidx, o.m_defar.begin() + endidx, m_defar.begin() + startidx);
+		m_nofPruned = nofPruned_;
+	}
+
 	void definePattern(
 			unsigned int id,
 			const std::string& expression_,
@@ -251,6 +546,11 @@ public:
 	{
 		std::string expression( expression_);
 		unsigned int editdist = extractEditDistFromExpression( expression);
+		if (m_normalization)
+		{
+			//... the patterns are matched on the normalized source
+			expression = NormalizedCharMap::normalizeExpression( expression, m_normalization);
+		}
 		if (m_debugtrace) m_debugtrace->event( "pattern", "idx=%d expr='%s' level=%d result=%d edist=%d posbind=%d",
 						(int)(m_defar.size()+1), expression.c_str(), (int)level, (int)resultIndex,
 						(int)editdist, ((int)(posbind+1) % 3 - 1));
@@ -271,18 +571,13 @@ public:
 		{
 			throw strus::runtime_error(_TXT("symbol id out of range, The id must be a positive integer in the range 1..%u"), MaxPatternId);
 		}
-		uint8_t symtabref;
-		IdSymTabMap::const_iterator yi = m_idsymtabmap.find( patternid);
-		if (yi == m_idsymtabmap.end())
-		{
-			symtabref = m_idsymtabmap[ patternid] = createSymbolTable();
-		}
-		else
+		PatternSymbolTable& pst = m_symtabmap[ getOrCreateSymbolTable( patternid)-1];
+		if (pst.shared)
 		{
-			symtabref = yi->second;
+			//... the symbol table scanned by the contexts is not changed, the new symbols are visible after the next compile
+			pst.copySymbolTable( m_errorhnd);
 		}
-		PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
-		uint32_t symidx = pst.symtab->getOrCreate( name_);
+		uint32_t symidx = pst.symtab->getOrCreate( normalized( name_));
 		if (symidx != pst.idmap.size()+1)
 		{
 			if (symidx == 0) throw strus::runtime_error( "%s", m_errorhnd->fetchError());
@@ -303,17 +598,104 @@ public:
 		else
 		{
 			symtabref = yi->second;
-			const PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
-			uint32_t symidx = pst.symtab->get( name_);
-			return symidx?pst.idmap[ symidx-1]:0;
+			std::string key = normalized( name_);
+			return symbolId( symtabref, key.c_str(), key.size());
+		}
+	}
+
+	/// \brief Define the symbols of a pattern in bulk with a dictionary file
+	/// \param[in] patternid identifier of the pattern the symbols are defined for
+	/// \param[in] path path of the dictionary, either a text file or an image of a dictionary built before
+	/// \param[in] cache cache where the image of a dictionary built from a text file is stored and mapped from, if defined
+	void defineSymbolDictionary( unsigned int patternid, const std::string& path, const LexerDatabaseCache& cache)
+	{
+		if (patternid > MaxPatternId)
+		{
+			throw strus::runtime_error(_TXT("pattern id out of range, The id must be a positive integer in the range 1..%u"), MaxPatternId);
+		}
+		strus::local_ptr<SymbolDictionary> dict;
+		if (SymbolDictionary::isImageFile( path))
+		{
+			dict.reset( SymbolDictionary::map( path, std::string()));
+			if (!dict.get()) throw strus::runtime_error(_TXT("invalid symbol dictionary image '%s'"), path.c_str());
+			if (dict->normalization() != m_normalization)
+			{
+				throw strus::runtime_error(_TXT("symbol dictionary image '%s' built with another normalization of the keys than the one of the lexer"), path.c_str());
+			}
+		}
+		else if (cache.defined())
+		{
+			//... the image is built once and shared by all processes mapping it
+			std::string signature = SymbolDictionary::sourceSignature( path, m_normalization);
+			dict.reset( SymbolDictionary::map( cache.dictionaryFilePath( signature), signature));
+			if (!dict.get())
+			{
+				dict.reset( SymbolDictionary::build( path, signature, MaxPatternId, m_normalization));
+				cache.storeDictionary( signature, dict->image());
+				SymbolDictionary* mapped = SymbolDictionary::map( cache.dictionaryFilePath( signature), signature);
+				if (mapped) dict.reset( mapped);
+			}
+		}
+		else
+		{
+			dict.reset( SymbolDictionary::build( path, std::string(), MaxPatternId, m_normalization));
 		}
+		if (m_debugtrace) m_debugtrace->event( "dictionary", "patternid=%d size=%d path='%s'", (int)patternid, (int)dict->size(), path.c_str());
+		PatternSymbolTable& pst = m_symtabmap[ getOrCreateSymbolTable( patternid)-1];
+		pst.dictionaries.push_back( Reference<SymbolDictionary>( dict.release()));
+	}
+
+	/// \brief Restrict the patterns compiled to the ones used, the pattern identifier or one of its symbol identifiers has to be in the set of terms used
+	/// \param[in] termids identifiers of the terms used
+	void defineUsedTerms( const std::vector<uint32_t>& termids)
+	{
+		m_usedTerms.clear();
+		m_usedTerms.insert( termids.begin(), termids.end());
+		m_pruneUnused = true;
+	}
+
+	/// \brief Mark the patterns with an identifier to be compiled even if not used
+	void defineAlwaysEmit( unsigned int patternid)
+	{
+		m_alwaysEmit.insert( patternid);
+	}
+
+	/// \brief Evaluate if a pattern is used, patterns not used are not compiled
+	/// \note A pattern with a symbol dictionary is always used, because its symbol identifiers are not known
+	bool isUsed( const PatternDef& def) const
+	{
+		if (!m_pruneUnused) return true;
+		if (m_usedTerms.find( def.id()) != m_usedTerms.end() || m_alwaysEmit.find( def.id()) != m_alwaysEmit.end()) return true;
+		IdSymTabMap::const_iterator ti = m_idsymtabmap.find( def.id());
+		if (ti == m_idsymtabmap.end()) return false;
+		const PatternSymbolTable& pst = m_symtabmap[ ti->second-1];
+		if (!pst.dictionaries.empty()) return true;
+		std::vector<unsigned int>::const_iterator si = pst.idmap.begin(), se = pst.idmap.end();
+		for (; si != se && m_usedTerms.find( *si) == m_usedTerms.end(); ++si){}
+		return si != se;
+	}
+
+	/// \brief Number of patterns not compiled because they are not used
+	std::size_t nofPruned() const
+	{
+		return m_nofPruned;
 	}
 
 	unsigned int symbolId( uint8_t symtabref, const char* keystr, std::size_t keylen) const
 	{
 		const PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
-		uint32_t symidx = pst.symtab->get( keystr, keylen);
-		return symidx?pst.idmap[ symidx-1]:0;
+		if (!pst.idmap.empty())
+		{
+			uint32_t symidx = pst.symtab->get( keystr, keylen);
+			if (symidx) return pst.idmap[ symidx-1];
+		}
+		std::vector<Reference<SymbolDictionary> >::const_iterator di = pst.dictionaries.begin(), de = pst.dictionaries.end();
+		for (; di != de; ++di)
+		{
+			uint32_t symid = (*di)->get( keystr, keylen);
+			if (symid) return symid;
+		}
+		return 0;
 	}
 
 	const PatternDef& patternDef( unsigned int id) const
@@ -329,195 +711,584 @@ public:
 		rt->edit_distance = edit_distance;
 		return rt;
 	}
-	///\param[in] options options to stear matching
-	void complete( HsPatternTable& hspt, unsigned int options)
+	/// \brief Evaluate if a pattern is matched on the source mapped to a one byte character set, with the original expression rematched on every match
+	bool isApproximate( const PatternDef& def) const
+	{
+		return m_withOneByteCharMap || def.editdist();
+	}
+
+	/// \brief Analyse the width of the matches of a pattern, start of match tracking is only needed if the start cannot be derived from the end of a match
+	/// \param[in,out] def pattern definition, the width is set if fixed
+	/// \param[in] expression expression compiled for the pattern
+	/// \param[in] flags flags to compile the expression with
+	void analyseWidth( PatternDef& def, const char* expression, unsigned int flags)
 	{
+		hs_expr_info_t* info = 0;
+		hs_compile_error_t* compile_err = 0;
+		hs_expr_ext_t* ext = def.editdist() ? createPatternExprExtFlags( def.editdist()) : 0;
+		hs_error_t err = ext
+			? hs_expression_ext_info( expression, flags, ext, &info, &compile_err)
+			: hs_expression_info( expression, flags, &info, &compile_err);
+		if (ext) std::free( ext);
+		if (err != HS_SUCCESS)
 		{
-			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			for (; di != de; ++di)
-			{
-				if (di->editdist()) break;
-			}
-			m_withOneByteCharMap |= (di != de);
+			//... the error is reported by the compilation of the database
+			if (compile_err) hs_free_compile_error( compile_err);
+			return;
 		}
-		if (m_withOneByteCharMap)
+		bool fixedWidth = info->min_width == info->max_width && info->max_width <= (unsigned int)std::numeric_limits<uint16_t>::max();
+		unsigned int width = info->min_width;
+		std::free( info);
+		//... patterns with a variable width need start of match tracking, a rematch for finding the start would not be cheaper
+		if (fixedWidth) def.setFixedWidth( width);
+	}
+
+	/// \brief Get the number of patterns compiled without start of match tracking
+	std::size_t nofFixedWidth() const
+	{
+		std::size_t rt = 0;
+		std::vector<PatternDef>::const_iterator di = m_defar.begin(), de = m_defar.end();
+		for (; di != de; ++di) if (di->hasFixedWidth()) ++rt;
+		return rt;
+	}
+
+	/// \brief Create the code page of the source mapped to a one byte character set from the characters of the patterns matched on it
+	/// \return the code page or NULL if there are no such patterns
+	OneByteCodePage* createCodePage() const
+	{
+		std::vector<uint32_t> chars;
+		bool withApprox = false;
+		std::vector<PatternDef>::const_iterator di = m_defar.begin(), de = m_defar.begin() + m_nofCompleted;
+		for (; di != de; ++di)
 		{
-			//... always do rematch expression in case of using edit dist because a match is only a hint:
-			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			for (; di != de; ++di)
+			if (isApproximate( *di))
 			{
-				SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), true/*wchar matching*/));
-				m_subexprmap.push_back( ref);
-				di->setSubExpressionRef( m_subexprmap.size());
+				OneByteCodePage::collectChars( chars, di->expression().c_str(), di->expression().size());
+				withApprox = true;
 			}
 		}
-		else
+		return withApprox ? new OneByteCodePage( chars) : 0;
+	}
+
+	/// \brief Get the number of patterns defined
+	std::size_t nofDefinitions() const
+	{
+		return m_defar.size();
+	}
+
+	/// \brief Get the start of a match reported
+	/// \param[in] patternIdx index of the pattern matching
+	/// \param[in] from start of the match reported, only valid if the pattern is compiled with start of match tracking
+	/// \param[in] to end of the match reported
+	unsigned_long_long matchStart( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to) const
+	{
+		const PatternDef& def = m_defar[ patternIdx-1];
+		return def.hasFixedWidth() ? (to - def.width()) : from;
+	}
+
+	/// \brief Evaluate if a pattern is a plain literal and get the string it matches
+	/// \param[in] def pattern definition
+	/// \param[in] options options to stear matching
+	/// \param[out] literal the string matched
+	/// \return true if the pattern can be matched as literal, false if not
+	bool isLiteral( const PatternDef& def, unsigned int options, std::string& literal) const
+	{
+		if (isApproximate( def) || def.resultidx() != 0) return false;
+		literal.clear();
+		char const* ei = def.expression().c_str();
+		for (; *ei; ++ei)
 		{
-			//... do rematch expression that select a subexpression:
-			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			for (; di != de; ++di)
+			unsigned char ch = *ei;
+			if (ch == '\\')
 			{
-				if (di->resultidx() != 0)
-				{
-					SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), false/*byte matching*/));
-					m_subexprmap.push_back( ref);
-					di->setSubExpressionRef( m_subexprmap.size());
-				}
+				//... only escaped punctuation characters are literals, other escapes are character classes, assertions or codes
+				ch = *++ei;
+				if (!ch || ch >= 128 || (ch >= '0' && ch <= '9') || ((ch|32) >= 'a' && (ch|32) <= 'z') || ch <= 32) return false;
 			}
-		}
-		{
-			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			hspt.init( m_defar.size());
-			di = m_defar.begin();
-			for (std::size_t didx=0; di != de; ++di,++didx)
+			else if (0!=std::strchr( ".^$|?*+()[]{}", ch))
 			{
-				const char* expr;
-				if (m_withOneByteCharMap)
-				{
-					di->setExpressionOneByteCharMap();
-					expr = di->expression_onebyte().c_str();
-				}
-				else
-				{
-					expr = di->expression().c_str();
-				}
-				IdSymTabMap::const_iterator ti = m_idsymtabmap.find( di->id());
-				if (ti != m_idsymtabmap.end())
-				{
-					di->setSymtabref( ti->second);
-				}
-				hspt.patternar[ didx] = expr;
-				hspt.idar[ didx] = didx+1;
-				if (di->editdist())
-				{
-					hspt.flagar[ didx] = options | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = createPatternExprExtFlags( di->editdist());
-				}
-				else if (m_withOneByteCharMap)
-				{
-					hspt.flagar[ didx] = options | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = 0;
-				}
-				else
-				{
-					hspt.flagar[ didx] = options | HS_FLAG_UTF8 | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = 0;
-				}
+				return false;
 			}
+			else if (ch >= 128 && (options & HS_FLAG_CASELESS))
+			{
+				//... the literal matcher does case folding for ASCII characters only
+				return false;
+			}
+			literal.push_back( ch);
 		}
-		hspt.patternar[ m_defar.size()] = 0;
-		hspt.idar[ m_defar.size()] = 0;
-		hspt.flagar[ m_defar.size()] = 0;
-		hspt.extar[ m_defar.size()] = 0;
+		return !literal.empty();
 	}
 
-	bool matchSubExpression( uint32_t subexpref, const char* src, unsigned_long_long& from, unsigned_long_long& to) const
+	/// \brief Complete the definitions added since the last call with the regular expressions for the rematch
+	///\param[in] nofThreads number of threads compiling the regular expressions for the rematch
+	/// \note The regular expressions for the rematch are compiled with tre into structures in memory, they are not stored in the cache of the databases
+	void complete( unsigned int nofThreads)
 	{
-		const SubExpressionDef& subedef = *m_subexprmap[ subexpref-1];
-		if (subedef.editdist)
-		{
-			int cost = 0;
-			return subedef.approx_match( src, from, to, cost);
-		}
-		else
+		std::vector<std::size_t> subexprdefs;
+		std::vector<PatternDef>::iterator di = m_defar.begin() + m_nofCompleted, de = m_defar.end();
+		for (; di != de; ++di)
 		{
-			return subedef.match( src, from, to);
+			if (isApproximate( *di) || di->resultidx() != 0)
+			{
+				//... always do rematch expression of patterns matched on the one byte character set because a match is only a hint,
+				//... and rematch expressions that select a subexpression:
+				subexprdefs.push_back( di - m_defar.begin());
+				di->setSubExpressionRef( m_subexprmap.size() + subexprdefs.size());
+			}
 		}
+		compileSubExpressions( subexprdefs, nofThreads);
+		m_nofCompleted = m_defar.size();
 	}
 
-	/// \brief Check, if there exists a pattern with edit distance match
-	bool withOneByteCharMap() const
-	{
-		return m_withOneByteCharMap;
-	}
-	/// \brief Force mapping to a virtual character set of one byte characters used as hash and post filtering
-	void forceOneByteCharMap()
-	{
-		m_withOneByteCharMap = true;
-	}
-
-private:
-	uint8_t createSymbolTable()
+	/// \brief Prepare the definitions completed for compiling their databases or for loading them from the cache
+	///\param[in] startidx index of the first definition compiled, 0 for all
+	///\param[in] codepage code page of the source mapped to a one byte character set
+	void prepare( std::size_t startidx, const OneByteCodePage* codepage)
 	{
-		if (m_symtabmap.size() >= std::numeric_limits<uint8_t>::max())
+		std::size_t nofPruned = 0;
+		std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.begin() + m_nofCompleted;
+		for (std::size_t didx=0; di != de; ++di,++didx)
 		{
-			throw strus::runtime_error(_TXT("too many patter symbol tables defined, %u allowed"), (unsigned int)m_defar.size());
+			//... symbol tables of patterns defined before may have been added with the definitions of the last layer
+			IdSymTabMap::const_iterator ti = m_idsymtabmap.find( di->id());
+			if (ti != m_idsymtabmap.end())
+			{
+				di->setSymtabref( ti->second);
+			}
+			if (didx < startidx) continue;
+			if (!isUsed( *di))
+			{
+				++nofPruned;
+			}
+			else if (isApproximate( *di))
+			{
+				di->setExpressionOneByteCharMap( codepage);
+			}
 		}
-		m_symtabmap.push_back( PatternSymbolTable( m_errorhnd));
-		return m_symtabmap.size();
+		//... the patterns pruned are summed up over the layers, a compilation of all patterns counts them again
+		m_nofPruned = (startidx ? m_nofPruned : 0) + nofPruned;
 	}
 
-	struct SubExpressionDef
+	/// \brief Append everything determining the databases compiled from the definitions prepared and the results of their analysis to a signature
+	///\param[in,out] buf where to append the signature to
+	///\param[in] options options to stear matching
+	///\param[in] startidx index of the first definition compiled, 0 for all
+	void serializeDefinitions( std::string& buf, unsigned int options, std::size_t startidx) const
 	{
-		regex_t regex;
-		std::size_t index;
-		unsigned int editdist;
-		bool usewchar;
-		enum {MaxSubexpressionIndex=99};
-
-		SubExpressionDef( const std::string& expression, std::size_t index_, unsigned int editdist_, bool usewchar_)
-			:index(index_),editdist(editdist_),usewchar(usewchar_)
+		Serializer::packUint32( buf, options);
+		Serializer::packUint64( buf, startidx);
+		Serializer::packUint64( buf, m_nofCompleted - startidx);
+		std::vector<PatternDef>::const_iterator di = m_defar.begin() + startidx, de = m_defar.begin() + m_nofCompleted;
+		for (; di != de; ++di)
 		{
-			if (index > MaxSubexpressionIndex+1)
+			if (!isUsed( *di))
 			{
-				throw std::runtime_error( _TXT("error in sub expression selection index out of range"));
+				Serializer::packUint32( buf, 0);
 			}
-			int errcode;
-			if (usewchar)
+			else if (isApproximate( *di))
 			{
-				WCharString wsrc( expression.c_str(), expression.size());
-				const wchar_t* wexpr = wsrc.str();
-				errcode = tre_regwcomp( &regex, wexpr, REG_EXTENDED | REG_APPROX_MATCHER);
+				Serializer::packUint32( buf, 2);
+				Serializer::packString( buf, di->expression_onebyte());
 			}
 			else
 			{
-				errcode = tre_regcomp( &regex, expression.c_str(), REG_EXTENDED | REG_APPROX_MATCHER);
-			}
-			if (errcode)
-			{
-				char errbuf[ 1024];
-				(void)tre_regerror( errcode, &regex, errbuf, sizeof(errbuf));
-				throw strus::runtime_error(_TXT("error compiling regular expression: %s"), errbuf);
+				Serializer::packUint32( buf, 1);
+				Serializer::packString( buf, di->expression());
 			}
+			Serializer::packUint32( buf, di->resultidx());
+			Serializer::packUint32( buf, di->editdist());
 		}
-		~SubExpressionDef()
-		{
-			tre_regfree( &regex);
-		}
+	}
 
-		bool match( const char* src, unsigned_long_long& from, unsigned_long_long& to) const
+	/// \brief Analyse the definitions prepared, whether they are plain literals and the width of their matches
+	///\param[in] options options to stear matching
+	///\param[in] startidx index of the first definition compiled, 0 for all
+	/// \remark Expensive, because hyperscan parses every expression for getting its width, skipped if the databases are loaded from the cache
+	void analyse( unsigned int options, std::size_t startidx)
+	{
+		std::string literal;
+		std::vector<PatternDef>::iterator di = m_defar.begin() + startidx, de = m_defar.begin() + m_nofCompleted;
+		for (; di != de; ++di)
 		{
-			const char* start = src + from;
-			regmatch_t pmatch[ MaxSubexpressionIndex+1];
-			int errcode = tre_regexec( &regex, start, index+1, pmatch, REG_NOTBOL | REG_NOTEOL);
-			if (errcode)
+			di->setLiteral( std::string());
+			di->setFixedWidth( PatternDef::UndefinedWidth);
+			if (!isUsed( *di))
 			{
-				if (errcode == REG_NOMATCH) return false;
-
-				char errbuf[ 1024];
-				(void)tre_regerror( errcode, &regex, errbuf, sizeof(errbuf));
-				throw strus::runtime_error(_TXT("error matching of a regular expression: %s"), errbuf);
+				continue;
 			}
-			const regmatch_t& mt0 = pmatch[ 0];
-			const regmatch_t& mt = pmatch[ index];
-			if (mt0.rm_so < 0 || mt.rm_so < 0 || mt.rm_eo > (regoff_t)(to - from)) return false;
-			from += mt.rm_so;
-			to = from + mt.rm_eo - mt.rm_so;
-			return true;
-		}
-
-		bool approx_match( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
-		{
-			if (usewchar)
+			else if (isApproximate( *di))
 			{
-				return approx_match_wchar( src, from, to, cost);
+				analyseWidth( *di, di->expression_onebyte().c_str(), options);
+			}
+			else if (isLiteral( *di, options, literal))
+			{
+				//... the start of a literal match is derived from its size:
+				di->setLiteral( literal);
+				di->setFixedWidth( literal.size());
 			}
 			else
 			{
-				return approx_match_utf8( src, from, to, cost);
+				analyseWidth( *di, di->expression().c_str(), options | HS_FLAG_UTF8);
 			}
 		}
-		
+	}
+
+	/// \brief Append the results of the analysis of the definitions prepared to a buffer for storing them in the cache
+	///\param[in,out] buf where to append the results to
+	///\param[in] startidx index of the first definition compiled, 0 for all
+	void serializeAnalysis( std::string& buf, std::size_t startidx) const
+	{
+		std::vector<PatternDef>::const_iterator di = m_defar.begin() + startidx, de = m_defar.begin() + m_nofCompleted;
+		for (; di != de; ++di)
+		{
+			Serializer::packUint32( buf, di->width());
+			Serializer::packString( buf, di->literal());
+		}
+	}
+
+	/// \brief Set the results of the analysis of the definitions prepared loaded from the cache
+	///\param[in] buf the results serialized with serializeAnalysis
+	///\param[in] startidx index of the first definition compiled, 0 for all
+	/// \return true on success, false if the results do not fit to the definitions
+	bool deserializeAnalysis( const std::string& buf, std::size_t startidx)
+	{
+		try
+		{
+			Deserializer ds( buf.c_str(), buf.size());
+			std::vector<PatternDef>::iterator di = m_defar.begin() + startidx, de = m_defar.begin() + m_nofCompleted;
+			for (; di != de; ++di)
+			{
+				di->setFixedWidth( ds.unpackUint32());
+				di->setLiteral( ds.unpackString());
+			}
+			return ds.eof();
+		}
+		catch (const std::runtime_error&)
+		{
+			return false;
+		}
+	}
+
+	/// \brief Build the tables for compiling the databases of the definitions analysed
+	///\param[out] hspt_exact table of regular expression patterns matched on the UTF-8 source
+	///\param[out] hspt_literal table of literal patterns matched on the UTF-8 source
+	///\param[out] hspt_approx table of patterns matched on the source mapped to a one byte character set
+	///\param[in] options options to stear matching
+	///\param[in] startidx index of the first definition to put into the tables, 0 for all
+	void buildTables( HsPatternTable& hspt_exact, HsPatternTable& hspt_literal, HsPatternTable& hspt_approx, unsigned int options, std::size_t startidx)
+	{
+		std::size_t nofApprox = 0;
+		std::size_t nofLiteral = 0;
+		std::size_t nofUsed = 0;
+		std::vector<PatternDef>::const_iterator di = m_defar.begin() + startidx, de = m_defar.begin() + m_nofCompleted;
+		for (; di != de; ++di)
+		{
+			if (!isUsed( *di)) continue;
+			++nofUsed;
+			if (isApproximate( *di))
+			{
+				++nofApprox;
+			}
+			else if (!di->literal().empty())
+			{
+				++nofLiteral;
+			}
+		}
+		hspt_exact.init( nofUsed - nofApprox - nofLiteral);
+		hspt_literal.init( nofLiteral, true/*literal*/);
+		hspt_approx.init( nofApprox);
+		std::size_t exactidx = 0;
+		std::size_t literalidx = 0;
+		std::size_t approxidx = 0;
+		di = m_defar.begin() + startidx;
+		for (std::size_t didx=startidx; di != de; ++di,++didx)
+		{
+			//... patterns with a fixed width are compiled without start of match tracking
+			unsigned int somflag = di->hasFixedWidth() ? 0 : HS_FLAG_SOM_LEFTMOST;
+			if (!isUsed( *di))
+			{
+				continue;
+			}
+			else if (isApproximate( *di))
+			{
+				hspt_approx.patternar[ approxidx] = di->expression_onebyte().c_str();
+				hspt_approx.idar[ approxidx] = didx+1;
+				hspt_approx.extar[ approxidx] = di->editdist() ? createPatternExprExtFlags( di->editdist()) : 0;
+				hspt_approx.flagar[ approxidx] = options | somflag;
+				++approxidx;
+			}
+			else if (!di->literal().empty())
+			{
+				hspt_literal.patternar[ literalidx] = di->literal().c_str();
+				hspt_literal.lenar[ literalidx] = di->literal().size();
+				hspt_literal.idar[ literalidx] = didx+1;
+				hspt_literal.flagar[ literalidx] = (options & HS_FLAG_CASELESS);
+				hspt_literal.extar[ literalidx] = 0;
+				++literalidx;
+			}
+			else
+			{
+				hspt_exact.patternar[ exactidx] = di->expression().c_str();
+				hspt_exact.idar[ exactidx] = didx+1;
+				hspt_exact.extar[ exactidx] = 0;
+				hspt_exact.flagar[ exactidx] = options | HS_FLAG_UTF8 | somflag;
+				++exactidx;
+			}
+		}
+		//... the tables are terminated with a null element by their initialization
+	}
+
+	/// \brief Rematch a candidate with the expression of a pattern to verify it or to select a sub expression
+	/// \param[in] subexpref reference of the sub expression
+	/// \param[in] src pointer to the source the candidate positions are relative to
+	/// \param[in] srcsize size of the source available
+	/// \param[in,out] from start of the candidate, start of the match returned
+	/// \param[in,out] to end of the candidate, end of the match returned
+	/// \param[in,out] workspace data of the context used for the rematch
+	/// \return true if the candidate matches, false if not
+	bool matchSubExpression( uint32_t subexpref, const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, RematchWorkspace& workspace) const
+	{
+		const SubExpressionDef& subedef = *m_subexprmap[ subexpref-1];
+		if (subedef.editdist)
+		{
+			int cost = 0;
+			//... only the approximative matches on a bounded window are cached, the rematch of a sub expression selection inspects the source up to its end
+			std::size_t candidatesize = subedef.inspectedSize( srcsize, from, to);
+			if (!candidatesize || candidatesize > (std::size_t)RematchCache::MaxCandidateSize)
+			{
+				return subedef.approx_match( src, srcsize, from, to, cost, workspace.wcharbuf);
+			}
+			RematchCache::Result result;
+			if (!workspace.cache.get( subexpref, src + from, candidatesize, result))
+			{
+				unsigned_long_long match_from = from;
+				unsigned_long_long match_to = to;
+				result.match = subedef.approx_match( src, srcsize, match_from, match_to, cost, workspace.wcharbuf);
+				if (result.match)
+				{
+					result.start = match_from - from;
+					result.end = match_to - from;
+					result.cost = cost;
+				}
+				workspace.cache.put( result);
+			}
+			if (!result.match) return false;
+			to = from + result.end;
+			from += result.start;
+			return true;
+		}
+		else
+		{
+			return subedef.match( src, from, to);
+		}
+	}
+
+	/// \brief Force mapping to a virtual character set of one byte characters used as hash and post filtering
+	void forceOneByteCharMap()
+	{
+		m_withOneByteCharMap = true;
+	}
+
+	/// \brief Define the normalization of the sources matched, the patterns and symbols defined after are normalized the same way
+	/// \param[in] mode normalization steps (bit set of NormalizedCharMap::Mode)
+	void defineNormalization( unsigned int mode)
+	{
+		m_normalization |= mode;
+	}
+
+	/// \brief Get the normalization of the sources matched (bit set of NormalizedCharMap::Mode), 0 if the sources are matched as they are
+	unsigned int normalization() const
+	{
+		return m_normalization;
+	}
+
+	/// \brief Evaluate if no patterns and no symbols have been defined yet
+	bool empty() const
+	{
+		return m_defar.empty() && m_symtabmap.empty();
+	}
+
+private:
+	/// \brief Compiler of the regular expressions for the rematch of a part of the patterns in a thread of its own
+	/// \remark Errors are kept and checked by the caller after the compilation
+	class SubExpressionCompiler
+	{
+	public:
+		/// \param[in] table_ pattern table to compile the sub expressions of
+		/// \param[in] defs_ indices of the pattern definitions with a sub expression, in the order of their sub expressions appended to the table
+		/// \param[in] startidx_ index of the first sub expression compiled by this compiler
+		/// \param[in] stride_ distance between the sub expressions compiled by this compiler
+		SubExpressionCompiler( PatternTable* table_, const std::vector<std::size_t>* defs_, std::size_t startidx_, std::size_t stride_)
+			:m_table(table_),m_defs(defs_),m_startidx(startidx_),m_stride(stride_),m_error(){}
+
+		/// \brief Compile the sub expressions, the entry point of the thread
+		void run()
+		{
+			try
+			{
+				std::size_t nofExisting = m_table->m_subexprmap.size() - m_defs->size();
+				std::size_t si = m_startidx, se = m_defs->size();
+				for (; si < se; si += m_stride)
+				{
+					const PatternDef& def = m_table->m_defar[ (*m_defs)[ si]];
+					m_table->m_subexprmap[ nofExisting + si].reset( new SubExpressionDef( def.expression(), def.resultidx(), def.editdist(), m_table->isApproximate( def)/*wchar matching*/));
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				m_error = _TXT("out of memory");
+			}
+			catch (const std::exception& err)
+			{
+				m_error = err.what();
+			}
+		}
+
+		/// \brief Get the error of the compilation, empty if it succeeded
+		const std::string& error() const	{return m_error;}
+
+	private:
+		PatternTable* m_table;
+		const std::vector<std::size_t>* m_defs;
+		std::size_t m_startidx;
+		std::size_t m_stride;
+		std::string m_error;
+	};
+
+	/// \brief Compile the regular expressions for the rematch of patterns with tre, in parallel if more than one thread is passed
+	/// \param[in] defs indices of the pattern definitions with a sub expression, in the order of their sub expression references
+	/// \param[in] nofThreads number of threads to use
+	void compileSubExpressions( const std::vector<std::size_t>& defs, unsigned int nofThreads)
+	{
+		m_subexprmap.resize( m_subexprmap.size() + defs.size());
+		std::size_t nofCompilers = nofThreads > 1 ? std::min( (std::size_t)nofThreads, defs.size()) : 1;
+		std::vector<Reference<SubExpressionCompiler> > compilers;
+		std::size_t ci = 0;
+		for (; ci != nofCompilers; ++ci)
+		{
+			compilers.push_back( Reference<SubExpressionCompiler>( new SubExpressionCompiler( this, &defs, ci, nofCompilers)));
+		}
+		runParallel( compilers, nofCompilers);
+		for (ci = 0; ci != nofCompilers; ++ci)
+		{
+			if (!compilers[ ci]->error().empty())
+			{
+				throw std::runtime_error( compilers[ ci]->error());
+			}
+		}
+	}
+
+	/// \brief Get a string normalized the same way as the sources matched
+	std::string normalized( const std::string& str) const
+	{
+		if (!m_normalization) return str;
+		NormalizedCharMap map;
+		map.init( str.c_str(), str.size(), m_normalization);
+		return std::string( map.data(), map.size());
+	}
+
+	uint8_t getOrCreateSymbolTable( unsigned int patternid)
+	{
+		IdSymTabMap::const_iterator yi = m_idsymtabmap.find( patternid);
+		if (yi == m_idsymtabmap.end())
+		{
+			return m_idsymtabmap[ patternid] = createSymbolTable();
+		}
+		else
+		{
+			return yi->second;
+		}
+	}
+
+	uint8_t createSymbolTable()
+	{
+		if (m_symtabmap.size() >= std::numeric_limits<uint8_t>::max())
+		{
+			throw strus::runtime_error(_TXT("too many patter symbol tables defined, %u allowed"), (unsigned int)m_defar.size());
+		}
+		m_symtabmap.push_back( PatternSymbolTable( m_errorhnd));
+		return m_symtabmap.size();
+	}
+
+	struct SubExpressionDef
+	{
+		regex_t regex;
+		std::size_t index;
+		unsigned int editdist;
+		bool usewchar;
+		enum {MaxSubexpressionIndex=99};
+
+		SubExpressionDef( const std::string& expression, std::size_t index_, unsigned int editdist_, bool usewchar_)
+			:index(index_),editdist(editdist_),usewchar(usewchar_)
+		{
+			if (index > MaxSubexpressionIndex+1)
+			{
+				throw std::runtime_error( _TXT("error in sub expression selection index out of range"));
+			}
+			int errcode;
+			if (usewchar)
+			{
+				WCharBuffer wexpr;
+				wexpr.init( expression.c_str(), expression.size());
+				errcode = tre_regwcomp( &regex, wexpr.str(), REG_EXTENDED | REG_APPROX_MATCHER);
+			}
+			else
+			{
+				errcode = tre_regcomp( &regex, expression.c_str(), REG_EXTENDED | REG_APPROX_MATCHER);
+			}
+			if (errcode)
+			{
+				char errbuf[ 1024];
+				(void)tre_regerror( errcode, &regex, errbuf, sizeof(errbuf));
+				throw strus::runtime_error(_TXT("error compiling regular expression: %s"), errbuf);
+			}
+		}
+		~SubExpressionDef()
+		{
+			tre_regfree( &regex);
+		}
+
+		bool match( const char* src, unsigned_long_long& from, unsigned_long_long& to) const
+		{
+			const char* start = src + from;
+			regmatch_t pmatch[ MaxSubexpressionIndex+1];
+			int errcode = tre_regexec( &regex, start, index+1, pmatch, REG_NOTBOL | REG_NOTEOL);
+			if (errcode)
+			{
+				if (errcode == REG_NOMATCH) return false;
+
+				char errbuf[ 1024];
+				(void)tre_regerror( errcode, &regex, errbuf, sizeof(errbuf));
+				throw strus::runtime_error(_TXT("error matching of a regular expression: %s"), errbuf);
+			}
+			const regmatch_t& mt0 = pmatch[ 0];
+			const regmatch_t& mt = pmatch[ index];
+			if (mt0.rm_so < 0 || mt.rm_so < 0 || mt.rm_eo > (regoff_t)(to - from)) return false;
+			from += mt.rm_so;
+			to = from + mt.rm_eo - mt.rm_so;
+			return true;
+		}
+
+		/// \brief Get the number of bytes of the source following the start of a candidate inspected by approx_match or 0 if not bounded
+		std::size_t inspectedSize( std::size_t srcsize, unsigned_long_long from, unsigned_long_long to) const
+		{
+			if (!usewchar) return 0;
+			std::size_t rt = to - from + editdist * sizeof(wchar_t);
+			return (from + rt > srcsize) ? (srcsize - from) : rt;
+		}
+
+		bool approx_match( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, int& cost, WCharBuffer& wcharbuf) const
+		{
+			if (usewchar)
+			{
+				return approx_match_wchar( src, srcsize, from, to, cost, wcharbuf);
+			}
+			else
+			{
+				return approx_match_utf8( src, from, to, cost);
+			}
+		}
+		
 private:
 		bool approx_match_utf8( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
 		{
@@ -555,9 +1326,9 @@ private:
 			return true;
 		}
 
-		bool approx_match_wchar( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
+		bool approx_match_wchar( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, int& cost, WCharBuffer& wsrc) const
 		{
-			WCharString wsrc( src + from, to - from + editdist * sizeof(wchar_t));
+			wsrc.init( src + from, inspectedSize( srcsize, from, to));
 			const wchar_t* wstart = wsrc.str();
 
 			regaparams_t params;
@@ -630,11 +1401,30 @@ private:
 	{
 		Reference<SymbolTable> symtab;
 		std::vector<unsigned int> idmap;
+		std::vector<Reference<SymbolDictionary> > dictionaries;	///< dictionaries looked up if the symbol is not defined in symtab
+		bool shared;						///< true if symtab is shared with a snapshot scanned by the contexts
 
 		explicit PatternSymbolTable( ErrorBufferInterface* errorhnd)
-			:symtab( new SymbolTable(errorhnd)),idmap(){}
+			:symtab( new SymbolTable(errorhnd)),idmap(),dictionaries(),shared(false){}
 		PatternSymbolTable( const PatternSymbolTable& o)
-			:symtab(o.symtab),idmap(o.idmap){}
+			:symtab(o.symtab),idmap(o.idmap),dictionaries(o.dictionaries),shared(o.shared){}
+
+		/// \brief Replace the symbol table shared by a copy of its own
+		void copySymbolTable( ErrorBufferInterface* errorhnd)
+		{
+			Reference<SymbolTable> copy( new SymbolTable( errorhnd));
+			std::size_t si = 1, se = idmap.size()+1;
+			for (; si != se; ++si)
+			{
+				const char* key = symtab->key( si);
+				if (!copy->getOrCreate( key, std::strlen( key)))
+				{
+					throw strus::runtime_error( "%s", errorhnd->fetchError());
+				}
+			}
+			symtab = copy;
+			shared = false;
+		}
 	};
 
 	ErrorBufferInterface* m_errorhnd;
@@ -645,325 +1435,1788 @@ private:
 	IdSymTabMap m_idsymtabmap;				///< map pattern id -> index in m_symtabmap == PatternDef::symtabref
 	typedef Reference<SubExpressionDef> SubExpressionReference;
 	std::vector<SubExpressionReference> m_subexprmap;	///< single regular expression patterns for extracting subexpressions if they are referenced.
-	bool m_withOneByteCharMap;				///< true if the automaton has to be mapped down to a one byte character set serving as hash
+	bool m_withOneByteCharMap;				///< true if all patterns are matched on the source mapped down to a one byte character set serving as hash, otherwise only the patterns with edit distance
+	unsigned int m_normalization;				///< normalization of the sources matched (bit set of NormalizedCharMap::Mode), the patterns and symbols are normalized the same way
+	std::size_t m_nofCompleted;				///< number of definitions completed, the ones defined after are completed by the next call of complete
+	bool m_pruneUnused;					///< true if only the patterns used are compiled
+	std::set<uint32_t> m_usedTerms;				///< identifiers of the terms used, if the patterns not used are pruned
+	std::set<uint32_t> m_alwaysEmit;			///< identifiers of the patterns compiled even if not used
+	std::size_t m_nofPruned;				///< number of patterns not compiled because they are not used
 };
 
-
-struct TermMatchData
+/// \brief Databases compiled from a shard of the patterns, NULL if the shard has no patterns of a kind
+struct TermMatchShard
 {
-	PatternTable patternTable;
-	hs_database_t* patterndb;
-
-	explicit TermMatchData( ErrorBufferInterface* errorhnd_)
-		:patternTable( errorhnd_),patterndb(0){}
-	~TermMatchData()
+	hs_database_t* patterndb;		///< block mode database of the patterns matched on the UTF-8 source
+	hs_database_t* streamdb;		///< stream mode database of the patterns matched on the UTF-8 source
+	hs_database_t* literaldb;		///< block mode database of the literal patterns
+	hs_database_t* literalstreamdb;		///< stream mode database of the literal patterns
+	hs_database_t* approxdb;		///< block mode database of the patterns matched on the source mapped to a one byte character set
+	hs_database_t* approxstreamdb;		///< stream mode database of the patterns matched on the source mapped to a one byte character set
+
+	TermMatchShard()
+		:patterndb(0),streamdb(0),literaldb(0),literalstreamdb(0),approxdb(0),approxstreamdb(0){}
+	~TermMatchShard()
 	{
-		if (patterndb) hs_free_database(patterndb);
+		if (patterndb) hs_free_database( patterndb);
+		if (streamdb) hs_free_database( streamdb);
+		if (literaldb) hs_free_database( literaldb);
+		if (literalstreamdb) hs_free_database( literalstreamdb);
+		if (approxdb) hs_free_database( approxdb);
+		if (approxstreamdb) hs_free_database( approxstreamdb);
 	}
+
+private:
+	TermMatchShard( const TermMatchShard&){}	//... non copyable
+	void operator=( const TermMatchShard&){}	//... non copyable
 };
 
-struct MatchEvent
+/// \brief Shared reference to the databases of a shard, a stream context keeps the shards it opened its streams with alive
+typedef strus::Reference<TermMatchShard> TermMatchShardReference;
+
+/// \brief Evaluate if there are patterns matched on the source mapped to a one byte character set in a list of shards
+static bool shardsWithApprox( const std::vector<TermMatchShardReference>& shards)
 {
-	uint32_t id;
-	uint8_t level;
-	uint8_t posbind;
-	uint16_t origsize;
-	uint32_t origpos;
-
-	MatchEvent()
-		:id(0),level(0),posbind(0),origsize(0),origpos(0){}
-	MatchEvent( uint32_t id_, uint8_t level_, uint8_t posbind_, uint32_t origpos_, uint32_t origsize_)
-		:id(id_),level(level_),posbind(posbind_),origsize(origsize_),origpos(origpos_){}
-	MatchEvent( const MatchEvent& o)
-		:id(o.id),level(o.level),posbind(o.posbind),origsize(o.origsize),origpos(o.origpos){}
-};
+	std::vector<TermMatchShardReference>::const_iterator si = shards.begin(), se = shards.end();
+	for (; si != se && !(*si)->approxdb; ++si){}
+	return si != se;
+}
 
-class PatternLexerContext
-	:public PatternLexerContextInterface
+/// \brief Allocate a scratch space or grow an existing one, so that it can be used for all databases of a list of shards of a mode
+static void allocScratch( hs_scratch_t** scratch, const std::vector<TermMatchShardReference>& shards, bool streamMode)
 {
-public:
-	PatternLexerContext( const TermMatchData* data_, ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_data(data_),m_hs_scratch(0),m_src(0),m_matchEventAr(),m_charmap()
+	std::vector<TermMatchShardReference>::const_iterator si = shards.begin(), se = shards.end();
+	for (; si != se; ++si)
 	{
-		hs_error_t err = hs_alloc_scratch( m_data->patterndb, &m_hs_scratch);
-		if (err != HS_SUCCESS)
+		const TermMatchShard& shard = **si;
+		const hs_database_t* dbar[3];
+		dbar[0] = streamMode ? shard.streamdb : shard.patterndb;
+		dbar[1] = streamMode ? shard.literalstreamdb : shard.literaldb;
+		dbar[2] = streamMode ? shard.approxstreamdb : shard.approxdb;
+		int di = 0;
+		for (; di < 3; ++di)
 		{
-			throw std::bad_alloc();
+			if (dbar[di] && HS_SUCCESS != hs_alloc_scratch( dbar[di], scratch))
+			{
+				throw std::bad_alloc();
+			}
 		}
 	}
+}
 
-	virtual ~PatternLexerContext()
+/// \brief Pool of hyperscan scratch spaces of a mode shared by the contexts of a lexer instance
+/// \note Contexts borrow a scratch space on creation and give it back on destruction. A scratch space not in the pool is cloned from a prototype instead of being allocated for every database
+/// \note The scratch spaces are tagged with the generation of the list of shards they are allocated for, a scratch space of an older generation is grown when borrowed
+class ScratchPool
+{
+public:
+	explicit ScratchPool( bool streamMode_)
+		:m_mutex(),m_streamMode(streamMode_),m_prototype(0),m_prototypeGeneration(0),m_ar(){}
+
+	~ScratchPool()
 	{
-		hs_free_scratch( m_hs_scratch);
+		if (m_prototype) hs_free_scratch( m_prototype);
+		std::vector<Entry>::const_iterator ai = m_ar.begin(), ae = m_ar.end();
+		for (; ai != ae; ++ai) hs_free_scratch( ai->scratch);
 	}
 
-	virtual void reset()
+	/// \brief Borrow a scratch space usable for all databases of a list of shards
+	/// \param[in] shards list of shards
+	/// \param[in] generation generation of the list of shards
+	/// \return the scratch space (with ownership until given back)
+	/// \remark Throws on error
+	hs_scratch_t* borrow( const std::vector<TermMatchShardReference>& shards, unsigned int generation)
 	{
-		try
+		strus::scoped_lock lock( m_mutex);
+		hs_scratch_t* rt = 0;
+		if (!m_ar.empty())
 		{
-			hs_scratch_t* new_scratch = 0;
-			hs_error_t err = hs_alloc_scratch( m_data->patterndb, &m_hs_scratch);
-			if (err != HS_SUCCESS)
+			rt = m_ar.back().scratch;
+			bool current = m_ar.back().generation == generation;
+			m_ar.pop_back();
+			if (!current)
 			{
-				throw std::bad_alloc();
+				try
+				{
+					allocScratch( &rt, shards, m_streamMode);
+				}
+				catch (...)
+				{
+					hs_free_scratch( rt);
+					throw;
+				}
 			}
-			hs_free_scratch( m_hs_scratch);
-			m_hs_scratch = new_scratch;
-			m_src = 0;
+			return rt;
 		}
-		CATCH_ERROR_MAP( _TXT("error calling hyperscan lexer reset: %s"), *m_errorhnd);
+		if (!m_prototype || m_prototypeGeneration != generation)
+		{
+			//... growing the prototype keeps it valid for the databases it was allocated for before
+			allocScratch( &m_prototype, shards, m_streamMode);
+			m_prototypeGeneration = generation;
+		}
+		if (!m_prototype)
+		{
+			//... no databases to scan
+			return 0;
+		}
+		if (HS_SUCCESS != hs_clone_scratch( m_prototype, &rt))
+		{
+			throw std::bad_alloc();
+		}
+		return rt;
 	}
-	
-	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+
+	/// \brief Give back a scratch space borrowed
+	/// \param[in] scratch the scratch space (with ownership)
+	/// \param[in] generation generation of the list of shards the scratch space was used for last
+	/// \note Does not throw, a scratch space that cannot be kept is freed
+	void giveBack( hs_scratch_t* scratch, unsigned int generation)
 	{
-		PatternLexerContext* THIS = (PatternLexerContext*)context;
+		if (!scratch) return;
 		try
 		{
-			if (THIS->m_data->patternTable.withOneByteCharMap())
-			{
-				from = THIS->m_charmap.posar[ from];
-				to = THIS->m_charmap.posar[ to];
-			}
-			if (to - from >= std::numeric_limits<uint16_t>::max())
-			{
-				throw strus::runtime_error( "size of matched term out of range");
-			}
-			const PatternDef& patternDef = THIS->m_data->patternTable.patternDef( patternIdx);
-			if (patternDef.subexpref())
-			{
-				if (!THIS->m_data->patternTable.matchSubExpression( patternDef.subexpref(), THIS->m_src, from, to))
-				{
-					return 0;
-				}
-			}
-			unsigned int patternid = patternDef.id();
-			if (patternDef.symtabref())
-			{
-				unsigned int symid = THIS->m_data->patternTable.symbolId( patternDef.symtabref(), THIS->m_src + from, (uint32_t)(to-from));
-				if (symid) patternid = symid;
-			}
-			MatchEvent matchEvent( patternDef.id(), patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from));
-			if (THIS->m_matchEventAr.empty())
-			{
-				THIS->m_matchEventAr.push_back( matchEvent);
-				if (patternid != patternDef.id())
-				{
-					THIS->m_matchEventAr.push_back( MatchEvent( patternid, patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from)));
-				}
-			}
+			strus::scoped_lock lock( m_mutex);
+			m_ar.push_back( Entry( scratch, generation));
+		}
+		catch (...)
+		{
+			hs_free_scratch( scratch);
+		}
+	}
+
+private:
+	ScratchPool( const ScratchPool&){}		//... non copyable
+	void operator=( const ScratchPool&){}		//... non copyable
+
+private:
+	struct Entry
+	{
+		hs_scratch_t* scratch;
+		unsigned int generation;
+
+		Entry( hs_scratch_t* scratch_, unsigned int generation_)
+			:scratch(scratch_),generation(generation_){}
+		Entry( const Entry& o)
+			:scratch(o.scratch),generation(o.generation){}
+	};
+
+	strus::mutex m_mutex;				///< mutex guarding the pool, the contexts of an instance may be created and destroyed in different threads
+	bool m_streamMode;				///< true if the scratch spaces are used for stream mode databases
+	hs_scratch_t* m_prototype;			///< scratch space the scratch spaces not in the pool are cloned from
+	unsigned int m_prototypeGeneration;		///< generation of the list of shards the prototype is allocated for
+	std::vector<Entry> m_ar;			///< scratch spaces given back
+};
+
+/// \brief Snapshot of a compiled lexer scanned by the contexts, immutable after its publication
+/// \note A compilation or a merge of the layers publishes a new snapshot, the contexts pin the snapshot they scan with a shared reference until they switch to the next one
+struct TermMatchData
+{
+	PatternTable patternTable;		///< copy of the pattern definitions at the time of the compilation
+	std::vector<TermMatchShardReference> shards;	///< databases of the shards of the patterns followed by the ones of the layers compiled incrementally, the matches of all shards are merged by the resolution of the events
+	Reference<OneByteCodePage> codepage;	///< code page of the source mapped to a one byte character set, NULL if no patterns are matched on it
+	unsigned int nofLayers;			///< number of layers compiled, the first one is the base with all patterns at the time of the first compile or the last merge
+	unsigned int generation;		///< counter incremented with every snapshot published, the scratch spaces are tagged with it
+	unsigned int nofThreads;		///< maximum number of threads scanning a document in parallel, 0 or 1 for sequential scanning
+	bool profiling;				///< true if the contexts measure the phases of the lexer for the statistics
+
+	/// \brief Number of databases per shard
+	enum {NofDatabases=6};
+
+	TermMatchData( const PatternTable& patternTable_, const std::vector<TermMatchShardReference>& shards_, const Reference<OneByteCodePage>& codepage_, unsigned int nofLayers_, unsigned int generation_, unsigned int nofThreads_, bool profiling_)
+		:patternTable(patternTable_),shards(shards_),codepage(codepage_),nofLayers(nofLayers_),generation(generation_),nofThreads(nofThreads_),profiling(profiling_){}
+
+	/// \brief Evaluate if there are patterns matched on the source mapped to a one byte character set
+	bool withApprox() const
+	{
+		return shardsWithApprox( shards);
+	}
+
+private:
+	TermMatchData( const TermMatchData&);		//... non copyable
+	void operator=( const TermMatchData&);		//... non copyable
+};
+
+/// \brief Shared reference to a snapshot of a compiled lexer
+typedef strus::Reference<TermMatchData> TermMatchDataReference;
+
+/// \brief Data of a lexer instance shared with its contexts, the snapshot published last and the pools of scratch spaces
+/// \note The contexts compare the generation of the snapshot published without locking, the mutex is only taken for fetching a snapshot that has changed
+class TermMatchShared
+{
+public:
+	TermMatchShared()
+		:blockScratch(false/*block mode*/),streamScratch(true/*stream mode*/),m_mutex(),m_data(),m_generation(0){}
+
+	/// \brief Get the snapshot published last, NULL if not compiled yet
+	/// \return the snapshot pinned by the reference returned
+	TermMatchDataReference data() const
+	{
+		strus::scoped_lock lock( m_mutex);
+		return m_data;
+	}
+
+	/// \brief Get the generation of the snapshot published last without locking, 0 if not compiled yet
+	unsigned int generation() const
+	{
+		return m_generation.value();
+	}
+
+	/// \brief Replace the snapshot scanned by the contexts, the ones scanning the snapshot replaced keep it until they switch
+	void publish( const TermMatchDataReference& data_)
+	{
+		TermMatchDataReference replaced;	//... released after the lock
+		strus::scoped_lock lock( m_mutex);
+		replaced = m_data;
+		m_data = data_;
+		m_generation.set( data_->generation);
+	}
+
+	mutable ScratchPool blockScratch;	///< scratch spaces of the block mode contexts, borrowed by the contexts
+	mutable ScratchPool streamScratch;	///< scratch spaces of the stream mode contexts, borrowed by the contexts
+
+private:
+	TermMatchShared( const TermMatchShared&);	//... non copyable
+	void operator=( const TermMatchShared&);	//... non copyable
+
+private:
+	mutable strus::mutex m_mutex;		///< mutex guarding the snapshot published, it is replaced by 'compile' or 'mergeLayers' while the contexts are scanning
+	TermMatchDataReference m_data;		///< snapshot published last
+	AtomicCounter<unsigned int> m_generation;	///< generation of the snapshot published last, set after the snapshot is replaced
+};
+
+/// \brief Reserve space for appending elements to a vector, growing its capacity geometrically
+/// \note An exact reserve for every source appended would copy the whole vector for each source of a batch
+template <typename Element>
+static void reserveAppend( std::vector<Element>& ar, std::size_t nofElements)
+{
+	std::size_t required = ar.size() + nofElements;
+	if (required > ar.capacity())
+	{
+		ar.reserve( std::max( required, ar.capacity() * 2));
+	}
+}
+
+/// \brief Get the time of a monotonic clock in seconds, for measuring durations
+static double monotonicTime()
+{
+	struct timespec ts;
+	if (0!=::clock_gettime( CLOCK_MONOTONIC, &ts)) return 0.0;
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/// \brief Scan a source in block mode with the databases of all shards, the matches of all databases are merged by the resolution of the events
+/// \param[in,out] charmap buffer for the source mapped to the one byte character set of the approximative patterns
+/// \param[in,out] shardScanTime scan time accumulated per shard in seconds, only measured with the option "STATISTICS" if there are several shards
+/// \param[in,out] profile counters and timers of the phases of the lexer, updated if enabled
+static hs_error_t scanShards( const TermMatchData* data, const char* src, std::size_t srclen, hs_scratch_t* scratch, OneByteCharMap& charmap, match_event_handler onMatch, match_event_handler onApproxMatch, void* context, std::vector<double>& shardScanTime, LexerProfile& profile)
+{
+	hs_error_t err = HS_SUCCESS;
+	//... the clock is read per shard only if the phases are measured, the option "STATISTICS"
+	bool measure = profile.enabled && data->shards.size() > 1;
+	if (measure && shardScanTime.size() < data->shards.size())
+	{
+		shardScanTime.resize( data->shards.size(), 0.0);
+	}
+	if (data->withApprox())
+	{
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		charmap.init( src, srclen, data->codepage.get());
+		if (profile.enabled) profile.timeCharMap += monotonicTime() - start;
+	}
+	//... the time of the callbacks measured (rematch and symbol lookup) is subtracted from the scan time
+	double callbackTime = profile.timeRematch + profile.timeSymbolLookup;
+	double scanStart = profile.enabled ? monotonicTime() : 0.0;
+	std::vector<TermMatchShardReference>::const_iterator si = data->shards.begin(), se = data->shards.end();
+	for (std::size_t sidx=0; err == HS_SUCCESS && si != se; ++si,++sidx)
+	{
+		const TermMatchShard& shard = **si;
+		double start = measure ? monotonicTime() : 0.0;
+		if (shard.patterndb)
+		{
+			err = hs_scan( shard.patterndb, src, srclen, 0/*reserved*/, scratch, onMatch, context);
+		}
+		if (err == HS_SUCCESS && shard.literaldb)
+		{
+			err = hs_scan( shard.literaldb, src, srclen, 0/*reserved*/, scratch, onMatch, context);
+		}
+		if (err == HS_SUCCESS && shard.approxdb)
+		{
+			err = hs_scan( shard.approxdb, charmap.data(), charmap.size(), 0/*reserved*/, scratch, onApproxMatch, context);
+		}
+		if (measure) shardScanTime[ sidx] += monotonicTime() - start;
+	}
+	if (profile.enabled)
+	{
+		profile.timeScan += (monotonicTime() - scanStart) - (profile.timeRematch + profile.timeSymbolLookup - callbackTime);
+	}
+	return err;
+}
+
+/// \brief Define the statistics of the scan time per shard
+static void defineShardStatistics( analyzer::PatternMatcherStatistics& stats, const std::vector<double>& shardScanTime)
+{
+	std::vector<double>::const_iterator ti = shardScanTime.begin(), te = shardScanTime.end();
+	for (int tidx=1; ti != te; ++ti,++tidx)
+	{
+		char name[ 64];
+		std::snprintf( name, sizeof(name), "scanTimeShard%d", tidx);
+		stats.define( name, *ti);
+	}
+}
+
+/// \brief Order of patterns by the number of matches reported, descending
+struct PatternCallbacksOrder
+{
+	bool operator()( const std::pair<unsigned int,unsigned long>& a, const std::pair<unsigned int,unsigned long>& b) const
+	{
+		return a.second == b.second ? a.first < b.first : a.second > b.second;
+	}
+};
+
+/// \brief Define the statistics of the phases of the lexer if measured
+/// \param[in] profile counters and timers of the phases summed up over all scanners of a context
+/// \param[in] nofSuperseded number of events dropped because they were superseded or covered by others
+/// \param[in] patternTable table of the patterns for mapping pattern indices to pattern identifiers
+/// \note The patterns are reported with the identifier defined with 'defineLexem', patterns sharing an identifier are counted together
+static void defineProfileStatistics( analyzer::PatternMatcherStatistics& stats, const LexerProfile& profile, unsigned long nofSuperseded, const PatternTable& patternTable)
+{
+	enum {NofTopPatterns=10};
+	if (!profile.enabled) return;
+
+	stats.define( "nofBytesScanned", profile.nofBytes);
+	stats.define( "nofCallbacks", profile.nofCallbacks);
+	stats.define( "callbacksPerKB", profile.nofBytes ? (double)profile.nofCallbacks * 1024.0 / (double)profile.nofBytes : 0.0);
+	stats.define( "nofRematchAccepted", profile.nofRematchAccepted);
+	stats.define( "nofRematchRejected", profile.nofRematchRejected);
+	stats.define( "nofSuperseded", nofSuperseded);
+	stats.define( "timeNormalize", profile.timeNormalize);
+	stats.define( "timeCharMap", profile.timeCharMap);
+	stats.define( "timeScan", profile.timeScan);
+	stats.define( "timeRematch", profile.timeRematch);
+	stats.define( "timeSymbolLookup", profile.timeSymbolLookup);
+	stats.define( "timeResolve", profile.timeResolve);
+	stats.define( "timeOutput", profile.timeOutput);
+
+	std::map<unsigned int,unsigned long> idmap;
+	std::vector<unsigned long>::const_iterator ci = profile.patternCallbacks.begin(), ce = profile.patternCallbacks.end();
+	for (unsigned int pidx=1; ci != ce; ++ci,++pidx)
+	{
+		if (*ci) idmap[ patternTable.patternDef( pidx).id()] += *ci;
+	}
+	std::vector<std::pair<unsigned int,unsigned long> > top( idmap.begin(), idmap.end());
+	std::size_t nofTop = top.size() < (std::size_t)NofTopPatterns ? top.size() : (std::size_t)NofTopPatterns;
+	std::partial_sort( top.begin(), top.begin() + nofTop, top.end(), PatternCallbacksOrder());
+	std::vector<std::pair<unsigned int,unsigned long> >::const_iterator ti = top.begin(), te = top.begin() + nofTop;
+	for (; ti != te; ++ti)
+	{
+		char name[ 64];
+		std::snprintf( name, sizeof(name), "nofCallbacksPattern%u", ti->first);
+		stats.define( name, ti->second);
+	}
+}
+
+
+/// \brief Number of bytes following a match that have to be available for evaluating the match in a stream
+/// \note The approximative rematch of a match reads up to (editdist * sizeof(wchar_t)) bytes following the match
+enum {RematchLookahead=1024};
+
+/// \brief Evaluate a match reported by hyperscan and add the resulting events to a list of match events
+/// \param[in,out] list where to add the match events to
+/// \param[in] patternTable table with the pattern definitions
+/// \param[in] patternIdx index of the pattern matching
+/// \param[in] src pointer to the source the match positions are relative to
+/// \param[in] srcsize size of the source available
+/// \param[in] srcofs offset of the source relative to the start of the document
+/// \param[in] from start of the match in the source
+/// \param[in] to end of the match in the source
+/// \param[in,out] workspace data of the context used for rematches
+static void pushMatchEvent( MatchEventList& list, const PatternTable& patternTable, unsigned int patternIdx, const char* src, std::size_t srcsize, std::size_t srcofs, unsigned_long_long from, unsigned_long_long to, RematchWorkspace& workspace)
+{
+	if (to - from >= MaxLexemSize)
+	{
+		throw strus::runtime_error( "size of matched term out of range");
+	}
+	unsigned_long_long reportpos = srcofs + to;
+	if (reportpos >= (unsigned_long_long)std::numeric_limits<uint32_t>::max())
+	{
+		throw strus::runtime_error( "position of matched term out of range");
+	}
+	const PatternDef& patternDef = patternTable.patternDef( patternIdx);
+	LexerProfile& profile = workspace.profile;
+	if (profile.enabled) profile.countCallback( patternIdx);
+	if (patternDef.subexpref())
+	{
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		bool match = patternTable.matchSubExpression( patternDef.subexpref(), src, srcsize, from, to, workspace);
+		if (profile.enabled)
+		{
+			profile.timeRematch += monotonicTime() - start;
+			if (match) ++profile.nofRematchAccepted; else ++profile.nofRematchRejected;
+		}
+		if (!patternDef.expression_onebyte().empty())
+		{
+			//... a match on the source mapped to a one byte character set is a candidate, the false ones are measured for judging the code page
+			++workspace.nofCandidates;
+			if (!match) ++workspace.nofFalseCandidates;
+		}
+		if (!match)
+		{
+			return;
+		}
+	}
+	unsigned int patternid = patternDef.id();
+	if (patternDef.symtabref())
+	{
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		unsigned int symid = patternTable.symbolId( patternDef.symtabref(), src + from, (uint32_t)(to-from));
+		if (symid) patternid = symid;
+		if (profile.enabled) profile.timeSymbolLookup += monotonicTime() - start;
+	}
+	unsigned_long_long origpos = srcofs + from;
+	if (origpos >= (unsigned_long_long)std::numeric_limits<uint32_t>::max())
+	{
+		throw strus::runtime_error( "position of matched term out of range");
+	}
+	list.add( MatchEvent( patternDef.id(), patternDef.level(), patternDef.posbind(), (uint32_t)origpos, (uint32_t)(to-from)), patternid, (uint32_t)reportpos);
+}
+
+/// \brief Output of lexems passing them to a sink provided by the caller
+class LexemSinkOutput
+{
+public:
+	/// \param[in] origseg_ segment of the positions of the lexems
+	explicit LexemSinkOutput( PatternLexemSinkInterface* sink_, int origseg_=0)
+		:m_sink(sink_),m_origseg(origseg_){}
+
+	void push( uint32_t id, uint32_t ordpos, uint32_t origpos, uint16_t origsize)
+	{
+		m_sink->pushLexem( id, ordpos, analyzer::Position( m_origseg, origpos), origsize);
+	}
+
+private:
+	PatternLexemSinkInterface* m_sink;
+	int m_origseg;
+};
+
+/// \brief Output of lexems feeding them directly as term events to a pattern matcher
+class MatcherTermOutput
+{
+public:
+	/// \param[in] origseg_ segment of the positions of the terms
+	explicit MatcherTermOutput( PatternMatcherTermConsumer* consumer_, uint32_t origseg_=0)
+		:m_consumer(consumer_),m_origseg(origseg_){}
+
+	void push( uint32_t id, uint32_t ordpos, uint32_t origpos, uint16_t origsize)
+	{
+		m_consumer->putTerm( id, ordpos, m_origseg, origpos, origsize);
+	}
+
+private:
+	PatternMatcherTermConsumer* m_consumer;
+	uint32_t m_origseg;
+};
+
+/// \brief Output of lexems matched on a normalized source, mapping their positions back to the original source before passing them to another output
+template <class Output>
+class NormalizedPositionOutput
+{
+public:
+	/// \param[in] checkpoints_ checkpoints mapping the positions in the normalized source to the original source
+	NormalizedPositionOutput( Output& out_, const std::vector<CharMapCheckpoint>& checkpoints_)
+		:m_out(&out_),m_checkpoints(&checkpoints_){}
+
+	void push( uint32_t id, uint32_t ordpos, uint32_t origpos, uint16_t origsize)
+	{
+		std::size_t start = OneByteCharMap::charMapOrigPos( *m_checkpoints, origpos);
+		std::size_t end = origsize ? OneByteCharMap::charMapOrigPos( *m_checkpoints, origpos + origsize) : start;
+		//... the removal of diacritical marks can make the original of a lexem bigger than the maximum size
+		if (end - start > (std::size_t)MaxLexemSize) end = start + MaxLexemSize;
+		m_out->push( id, ordpos, (uint32_t)start, (uint16_t)(end - start));
+	}
+
+private:
+	Output* m_out;
+	const std::vector<CharMapCheckpoint>* m_checkpoints;
+};
+
+static const char* hsErrorName( int ec)
+{
+	switch (ec) {
+		case HS_SUCCESS:
+			return "HS_SUCCESS";
+		case HS_INVALID:
+			return "HS_INVALID";
+		case HS_NOMEM:
+			return "HS_NOMEM";
+		case HS_SCAN_TERMINATED:
+			return "HS_SCAN_TERMINATED";
+		case HS_COMPILER_ERROR:
+			return "HS_COMPILER_ERROR";
+		case HS_DB_VERSION_ERROR:
+			return "HS_DB_VERSION_ERROR";
+		case HS_DB_PLATFORM_ERROR:
+			return "HS_DB_PLATFORM_ERROR";
+		case HS_DB_MODE_ERROR:
+			return "HS_DB_MODE_ERROR";
+		case HS_BAD_ALIGN:
+			return "HS_BAD_ALIGN";
+		case HS_BAD_ALLOC:
+			return "HS_BAD_ALLOC";
+		case HS_SCRATCH_IN_USE:
+			return "HS_SCRATCH_IN_USE";
+		default:
+			return "unknown";
+	}
+}
+
+/// \brief Minimum size of a piece of a document scanned by one thread in parallel match mode
+enum {ParallelMinPieceSize=1<<20};
+/// \brief Size of a source in bytes below which it is scanned on the fast path for queries, without reserving the event list for it and without the branches of the profiling and of the parallel scan
+enum {ShortSourceSize=256};
+/// \brief Number of bytes scanned before and after a piece of a document in parallel match mode, so that all matches starting in the piece are found as in a scan of the whole document
+enum {ParallelPieceOverlap=MaxLexemSize+1};
+
+/// \brief Get the start of the UTF-8 character at a position
+static std::size_t utf8CharStart( const char* src, std::size_t pos)
+{
+	for (; pos > 0 && ((unsigned char)src[ pos] & 0xC0) == 0x80; --pos){}
+	return pos;
+}
+
+/// \brief Get the position of a split of a document for parallel scanning near a position, preferably after a space
+static std::size_t parallelSplitPosition( const char* src, std::size_t srcsize, std::size_t pos)
+{
+	std::size_t pi = pos, pe = (srcsize - pos > (std::size_t)MaxLexemSize) ? (pos + MaxLexemSize) : srcsize;
+	for (; pi != pe; ++pi)
+	{
+		if ((unsigned char)src[ pi] <= 32) return pi+1;
+	}
+	return utf8CharStart( src, pos);
+}
+
+/// \brief Scanner of a piece of a document in a thread of its own for the parallel match mode
+/// \remark Errors are not reported to the error buffer, because the thread might not be known to it, but kept and checked by the caller after the scan
+class PatternLexerPieceScanner
+{
+public:
+	/// \param[in] shared_ data of the instance with the pool the scratch space is borrowed from
+	/// \param[in] data_ snapshot scanned, pinned by the context owning this scanner
+	PatternLexerPieceScanner( const TermMatchShared* shared_, const TermMatchData* data_)
+		:m_shared(shared_),m_data(data_),m_generation(data_->generation),m_hs_scratch(0),m_src(0),m_srcsize(0),m_scanstart(0),m_scanend(0),m_matchEventList(),m_charmap(),m_rematch(),m_shardScanTime(),m_error()
+	{
+		m_rematch.profile.enabled = m_data->profiling;
+		m_hs_scratch = m_shared->blockScratch.borrow( m_data->shards, m_generation);
+	}
+
+	~PatternLexerPieceScanner()
+	{
+		m_shared->blockScratch.giveBack( m_hs_scratch, m_generation);
+	}
+
+	/// \brief Define the piece to scan
+	/// \param[in] src pointer to the document
+	/// \param[in] srcsize size of the document in bytes
+	/// \param[in] scanstart start of the part of the document to scan
+	/// \param[in] scanend end of the part of the document to scan
+	void init( const char* src, std::size_t srcsize, std::size_t scanstart, std::size_t scanend)
+	{
+		m_src = src;
+		m_srcsize = srcsize;
+		m_scanstart = scanstart;
+		m_scanend = scanend;
+		m_matchEventList.clear();
+		m_error.clear();
+	}
+
+	/// \brief Scan the piece, the entry point of the thread
+	void run()
+	{
+		try
+		{
+			const char* scanptr = m_src + m_scanstart;
+			std::size_t scansize = m_scanend - m_scanstart;
+			hs_error_t err = scanShards( m_data, scanptr, scansize, m_hs_scratch, m_charmap, match_event_handler, approx_match_event_handler, this, m_shardScanTime, m_rematch.profile);
+			if (err != HS_SUCCESS && m_error.empty())
+			{
+				m_error = std::string( _TXT("error matching pattern, hyperscan error ")) + hsErrorName(err);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = _TXT("out of memory");
+		}
+		catch (const std::exception& err)
+		{
+			m_error = err.what();
+		}
+	}
+
+	/// \brief Get the events of the last scan, not resolved
+	const MatchEventList& matchEventList() const	{return m_matchEventList;}
+	/// \brief Get the error of the last scan, empty if it succeeded
+	const std::string& error() const		{return m_error;}
+	/// \brief Get the workspace of the rematches with its cache, counters and the profile of the phases
+	const RematchWorkspace& rematch() const		{return m_rematch;}
+	/// \brief Get the scan time accumulated per shard
+	const std::vector<double>& shardScanTime() const	{return m_shardScanTime;}
+
+private:
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerPieceScanner* THIS = (PatternLexerPieceScanner*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			pushMatchEvent( THIS->m_matchEventList, THIS->m_data->patternTable, patternIdx, THIS->m_src, THIS->m_srcsize, 0/*srcofs*/, THIS->m_scanstart + from, THIS->m_scanstart + to, THIS->m_rematch);
+			return 0;
+		}
+		catch (const std::exception& err)
+		{
+			THIS->m_error = err.what();
+			return -1;
+		}
+	}
+
+	static int approx_match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerPieceScanner* THIS = (PatternLexerPieceScanner*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			from = THIS->m_scanstart + THIS->m_charmap.origpos( from);
+			to = THIS->m_scanstart + THIS->m_charmap.origpos( to);
+			pushMatchEvent( THIS->m_matchEventList, THIS->m_data->patternTable, patternIdx, THIS->m_src, THIS->m_srcsize, 0/*srcofs*/, from, to, THIS->m_rematch);
+			return 0;
+		}
+		catch (const std::exception& err)
+		{
+			THIS->m_error = err.what();
+			return -1;
+		}
+	}
+
+private:
+	PatternLexerPieceScanner( const PatternLexerPieceScanner&){}	//... non copyable
+	void operator=( const PatternLexerPieceScanner&){}		//... non copyable
+
+private:
+	const TermMatchShared* m_shared;
+	const TermMatchData* m_data;
+	unsigned int m_generation;				///< generation of the snapshot the scratch space is borrowed for
+	hs_scratch_t* m_hs_scratch;
+	const char* m_src;
+	std::size_t m_srcsize;
+	std::size_t m_scanstart;
+	std::size_t m_scanend;
+	MatchEventList m_matchEventList;
+	OneByteCharMap m_charmap;
+	RematchWorkspace m_rematch;
+	std::vector<double> m_shardScanTime;
+	std::string m_error;
+};
+
+class PatternLexerContext
+	:public PatternLexerContextExtInterface
+{
+public:
+	PatternLexerContext( const TermMatchShared* shared_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_shared(shared_),m_data(shared_->data()),m_generation(m_data->generation),m_hs_scratch(0),m_src(0),m_srcsize(0),m_matchEventList(),m_charmap(),m_normalized(),m_rematch(),m_shardScanTime(),m_pieceScanners()
+	{
+		m_rematch.profile.enabled = m_data->profiling;
+		m_hs_scratch = m_shared->blockScratch.borrow( m_data->shards, m_generation);
+	}
+
+	virtual ~PatternLexerContext()
+	{
+		m_pieceScanners.clear();
+		m_shared->blockScratch.giveBack( m_hs_scratch, m_generation);
+	}
+
+	virtual void reset()
+	{
+		try
+		{
+			//... the scratch spaces are kept, they are only grown if the layers of the lexer changed
+			updateLayers();
+			m_shardScanTime.clear();
+			m_src = 0;
+			m_srcsize = 0;
+		}
+		CATCH_ERROR_MAP( _TXT("error calling hyperscan lexer reset: %s"), *m_errorhnd);
+	}
+	
+	virtual analyzer::PatternMatcherStatistics getStatistics() const
+	{
+		try
+		{
+			analyzer::PatternMatcherStatistics rt;
+			collectStatistics( rt);
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to get pattern lexer statistics: %s"), *m_errorhnd, analyzer::PatternMatcherStatistics());
+	}
+
+	/// \brief Add the statistics of this context to a structure
+	void collectStatistics( analyzer::PatternMatcherStatistics& stats) const
+	{
+		unsigned long nofLookups = m_rematch.cache.nofLookups();
+		unsigned long nofHits = m_rematch.cache.nofHits();
+		unsigned long nofCandidates = m_rematch.nofCandidates;
+		unsigned long nofFalseCandidates = m_rematch.nofFalseCandidates;
+		std::vector<double> shardScanTime( m_shardScanTime);
+		LexerProfile profile( m_rematch.profile);
+		std::vector<PieceScannerReference>::const_iterator si = m_pieceScanners.begin(), se = m_pieceScanners.end();
+		for (; si != se; ++si)
+		{
+			profile.add( (*si)->rematch().profile);
+			nofLookups += (*si)->rematch().cache.nofLookups();
+			nofHits += (*si)->rematch().cache.nofHits();
+			nofCandidates += (*si)->rematch().nofCandidates;
+			nofFalseCandidates += (*si)->rematch().nofFalseCandidates;
+			const std::vector<double>& pieceScanTime = (*si)->shardScanTime();
+			if (shardScanTime.size() < pieceScanTime.size()) shardScanTime.resize( pieceScanTime.size(), 0.0);
+			std::size_t ti = 0, te = pieceScanTime.size();
+			for (; ti != te; ++ti) shardScanTime[ ti] += pieceScanTime[ ti];
+		}
+		stats.define( "nofRematchCacheLookups", nofLookups);
+		stats.define( "rematchCacheHitRate", nofLookups ? ((double)nofHits / (double)nofLookups) : 0.0);
+		defineCandidateStatistics( stats, nofCandidates, nofFalseCandidates);
+		defineShardStatistics( stats, shardScanTime);
+		defineProfileStatistics( stats, profile, m_matchEventList.nofSuperseded(), m_data->patternTable);
+	}
+
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerContext* THIS = (PatternLexerContext*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			pushMatchEvent( THIS->m_matchEventList, THIS->m_data->patternTable, patternIdx, THIS->m_src, THIS->m_srcsize, 0/*srcofs*/, from, to, THIS->m_rematch);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	static int approx_match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerContext* THIS = (PatternLexerContext*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			from = THIS->m_charmap.origpos( from);
+			to = THIS->m_charmap.origpos( to);
+			pushMatchEvent( THIS->m_matchEventList, THIS->m_data->patternTable, patternIdx, THIS->m_src, THIS->m_srcsize, 0/*srcofs*/, from, to, THIS->m_rematch);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	virtual std::vector<analyzer::PatternLexem> match( const char* src, std::size_t srclen)
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			matchAppend( rt, src, srclen);
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+	virtual bool matchBatch(
+			const char* const* srcar,
+			const std::size_t* srcsizear,
+			std::size_t nofsrc,
+			std::vector<analyzer::PatternLexem>& result,
+			std::vector<std::size_t>& resultidxar)
+	{
+		try
+		{
+			result.clear();
+			resultidxar.clear();
+			resultidxar.reserve( nofsrc+1);
+			std::size_t si = 0;
+			for (; si != nofsrc; ++si)
+			{
+				resultidxar.push_back( result.size());
+				matchAppend( result, srcar[ si], srcsizear[ si]);
+			}
+			resultidxar.push_back( result.size());
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions on a batch of sources: %s"), *m_errorhnd, false);
+	}
+
+	virtual bool matchSegments(
+			const int* segidar,
+			const char* const* srcar,
+			const std::size_t* srcsizear,
+			std::size_t nofseg,
+			std::vector<analyzer::PatternLexem>& result)
+	{
+		try
+		{
+			result.clear();
+			OrdinalPositionAssigner ordposAssigner;
+			std::size_t si = 0;
+			for (; si != nofseg; ++si)
+			{
+				//... the segments are scanned where they are, the ordinal positions are continued from one segment to the next
+				scan( srcar[ si], srcsizear[ si]);
+				reserveAppend( result, m_matchEventList.size());
+				LexemVectorOutput out( result, segidar[ si]);
+				ordposAssigner.startSegment();
+				appendEvents( out, ordposAssigner);
+				m_matchEventList.clear();
+			}
+			if (!ordposAssigner.started())
+			{
+				// ... lexems bound to the successor before the first lexem with content are only valid if such a lexem exists
+				result.clear();
+			}
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions on the segments of a document: %s"), *m_errorhnd, false);
+	}
+
+	virtual bool matchToBuffer( const char* src, std::size_t srclen, std::vector<analyzer::PatternLexem>& result)
+	{
+		try
+		{
+			result.clear();
+			matchAppend( result, src, srclen);
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, false);
+	}
+
+	virtual bool matchToSink( const char* src, std::size_t srclen, PatternLexemSinkInterface* sink)
+	{
+		try
+		{
+			scan( src, srclen);
+			LexemSinkOutput out( sink);
+			output( out);
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, false);
+	}
+
+	/// \brief Match a source feeding the lexems directly to a pattern matcher
+	/// \remark Throws on error
+	void matchToMatcher( const char* src, std::size_t srclen, PatternMatcherTermConsumer* consumer)
+	{
+		scan( src, srclen);
+		MatcherTermOutput out( consumer);
+		output( out);
+	}
+
+private:
+	/// \brief Match a source and append the lexems found to a result
+	void matchAppend( std::vector<analyzer::PatternLexem>& res, const char* src, std::size_t srclen)
+	{
+		scan( src, srclen);
+		reserveAppend( res, m_matchEventList.size());
+		LexemVectorOutput out( res);
+		output( out);
+	}
+
+	/// \brief Scan a source and resolve the match events found
+	void scan( const char* src, std::size_t srclen)
+	{
+		m_matchEventList.clear();
+		updateLayers();
+		if (srclen < (std::size_t)ShortSourceSize && !m_rematch.profile.enabled && !m_data->patternTable.normalization())
+		{
+			//... fast path for queries, the event list keeps the capacity it got from the sources scanned before
+			scanSequential( src, srclen);
+			return;
+		}
+		unsigned int nofExpectedTokens = srclen / 4 + 10;
+		m_matchEventList.reserve( nofExpectedTokens);
+		if (srclen >= (std::size_t)std::numeric_limits<uint32_t>::max())
+		{
+			throw strus::runtime_error( "size of string to scan out of range");
+		}
+		LexerProfile& profile = m_rematch.profile;
+		if (profile.enabled) profile.nofBytes += srclen;
+		if (m_data->patternTable.normalization())
+		{
+			//... the source is matched in normalized form, the positions are mapped back on output
+			double start = profile.enabled ? monotonicTime() : 0.0;
+			m_normalized.init( src, srclen, m_data->patternTable.normalization());
+			src = m_normalized.data();
+			srclen = m_normalized.size();
+			if (profile.enabled) profile.timeNormalize += monotonicTime() - start;
+		}
+		std::size_t nofPieces = m_data->nofThreads > 1 ? std::min( (std::size_t)m_data->nofThreads, srclen / ParallelMinPieceSize) : 1;
+		if (nofPieces > 1)
+		{
+			scanParallel( src, srclen, nofPieces);
+			return;
+		}
+		scanSequential( src, srclen);
+	}
+
+	/// \brief Scan a source as a whole with the scratch space of the context and resolve the match events found
+	void scanSequential( const char* src, std::size_t srclen)
+	{
+		m_src = src;
+		m_srcsize = srclen;
+		// Collect all matches calling the Hyperscan engine:
+		hs_error_t err = scanShards( m_data.get(), src, srclen, m_hs_scratch, m_charmap, match_event_handler, approx_match_event_handler, this, m_shardScanTime, m_rematch.profile);
+		m_src = 0;
+		m_srcsize = 0;
+		if (err != HS_SUCCESS)
+		{
+			char srcbuf[ 128];
+			if (srclen > sizeof(srcbuf)-1) srclen = sizeof(srcbuf)-1;
+			std::memcpy( srcbuf, src, srclen);
+			srcbuf[ srclen] = 0;
+			m_matchEventList.clear();
+			throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) on '%s'"), hsErrorName(err), srcbuf);
+		}
+		resolveEvents();
+	}
+
+	/// \brief Resolve the order and the superseding of all match events found
+	void resolveEvents()
+	{
+		LexerProfile& profile = m_rematch.profile;
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		m_matchEventList.resolveAll();
+		if (profile.enabled) profile.timeResolve += monotonicTime() - start;
+	}
+
+	/// \brief Release the piece scanners, keeping the profile of the phases measured by them
+	void releasePieceScanners()
+	{
+		std::vector<PieceScannerReference>::const_iterator si = m_pieceScanners.begin(), se = m_pieceScanners.end();
+		for (; si != se; ++si) m_rematch.profile.add( (*si)->rematch().profile);
+		m_pieceScanners.clear();
+	}
+
+	/// \brief Switch to the snapshot with the layers of databases added or merged since the creation of the context or its last update, if there is one
+	void updateLayers()
+	{
+		//... the generation is compared without locking, a query does not touch the mutex of the instance as long as nothing is published
+		if (m_shared->generation() == m_generation) return;
+		TermMatchDataReference data( m_shared->data());
+		if (data.get() == m_data.get()) return;
+		//... growing the scratch space keeps it valid for the databases it was allocated for before
+		allocScratch( &m_hs_scratch, data->shards, false/*block mode*/);
+		// ... the scratch spaces of the piece scanners are given back to the pool and grown when borrowed again:
+		releasePieceScanners();
+		m_shardScanTime.clear();
+		m_data = data;
+		m_generation = m_data->generation;
+	}
+
+	/// \brief Scan a document split into pieces in parallel, collecting the events in the same order as a sequential scan
+	/// \note Each piece is scanned with an overlap on both sides, the events found are only taken from the piece where they start
+	void scanParallel( const char* src, std::size_t srclen, std::size_t nofPieces)
+	{
+		std::vector<std::size_t> splitar;
+		splitar.push_back( 0);
+		std::size_t pi = 1, pe = nofPieces;
+		for (; pi != pe; ++pi)
+		{
+			std::size_t splitpos = parallelSplitPosition( src, srclen, pi * (srclen / nofPieces));
+			if (splitpos > splitar.back() && splitpos < srclen) splitar.push_back( splitpos);
+		}
+		splitar.push_back( srclen);
+		nofPieces = splitar.size()-1;
+
+		while (m_pieceScanners.size() < nofPieces)
+		{
+			m_pieceScanners.push_back( PieceScannerReference( new PatternLexerPieceScanner( m_shared, m_data.get())));
+		}
+		for (pi = 0; pi != nofPieces; ++pi)
+		{
+			std::size_t scanstart = splitar[ pi] > (std::size_t)ParallelPieceOverlap ? utf8CharStart( src, splitar[ pi] - ParallelPieceOverlap) : 0;
+			std::size_t scanend = srclen - splitar[ pi+1] > (std::size_t)ParallelPieceOverlap ? utf8CharStart( src, splitar[ pi+1] + ParallelPieceOverlap) : srclen;
+			m_pieceScanners[ pi]->init( src, srclen, scanstart, scanend);
+		}
+		// ... the first piece is scanned by the calling thread
+		runParallel( m_pieceScanners, nofPieces);
+		for (pi = 0; pi != nofPieces; ++pi)
+		{
+			if (!m_pieceScanners[ pi]->error().empty())
+			{
+				throw strus::runtime_error(_TXT("error matching pattern in parallel: %s"), m_pieceScanners[ pi]->error().c_str());
+			}
+		}
+		// ... the resolution of the events merged is the same as for the events of a sequential scan, because the events with the same start are in the same piece in the same order
+		for (pi = 0; pi != nofPieces; ++pi)
+		{
+			m_matchEventList.addPending( m_pieceScanners[ pi]->matchEventList(), splitar[ pi], splitar[ pi+1]);
+		}
+		resolveEvents();
+	}
+
+	/// \brief Write the lexems of the match events resolved to an output, calculating their ordinal positions
+	template <class Output>
+	void output( Output& out)
+	{
+		// ... lexems bound to the successor before the first lexem with content are only valid if such a lexem exists
+		if (containsContentEvent( m_matchEventList.begin(), m_matchEventList.end()))
+		{
+			OrdinalPositionAssigner ordposAssigner;
+			appendEvents( out, ordposAssigner);
+		}
+		m_matchEventList.clear();
+	}
+
+	/// \brief Write the lexems of the match events resolved to an output, continuing the ordinal positions of an assigner
+	template <class Output>
+	void appendEvents( Output& out, OrdinalPositionAssigner& ordposAssigner)
+	{
+		LexerProfile& profile = m_rematch.profile;
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		if (m_data->patternTable.normalization())
+		{
+			NormalizedPositionOutput<Output> normout( out, m_normalized.checkpoints());
+			ordposAssigner.append( normout, m_matchEventList.begin(), m_matchEventList.end());
+		}
+		else
+		{
+			ordposAssigner.append( out, m_matchEventList.begin(), m_matchEventList.end());
+		}
+		if (profile.enabled) profile.timeOutput += monotonicTime() - start;
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const TermMatchShared* m_shared;
+	TermMatchDataReference m_data;				///< snapshot scanned, pinned until the switch to the next one
+	unsigned int m_generation;				///< generation of the snapshot the scratch space is allocated for
+	hs_scratch_t* m_hs_scratch;
+	const char* m_src;
+	std::size_t m_srcsize;
+	MatchEventList m_matchEventList;
+	OneByteCharMap m_charmap;
+	NormalizedCharMap m_normalized;				///< source normalized, if the patterns are matched on normalized sources
+	RematchWorkspace m_rematch;
+	std::vector<double> m_shardScanTime;			///< scan time accumulated per shard in seconds, if the patterns are split into shards
+	typedef strus::Reference<PatternLexerPieceScanner> PieceScannerReference;
+	std::vector<PieceScannerReference> m_pieceScanners;	///< scanners of the pieces of a document for the parallel match mode, created on demand
+};
+
+class PatternLexerStreamContext
+	:public PatternLexerStreamContextInterface
+{
+public:
+	PatternLexerStreamContext( const TermMatchShared* shared_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_shared(shared_),m_data(shared_->data()),m_generation(m_data->generation),m_hs_scratch(0),m_withApprox(m_data->withApprox()),m_streams(m_data->shards.size()),m_shardScanTime()
+		,m_buf(),m_bufpos(0),m_scanpos(0),m_mappos(0),m_checkpoints(),m_charmap()
+		,m_normalized(),m_rawtail(),m_origpos(0),m_normCheckpoints()
+		,m_rawMatchAr(),m_matchEventList(),m_ordposAssigner(),m_result(),m_rematch(),m_closed(false)
+	{
+		m_rematch.profile.enabled = m_data->profiling;
+		m_hs_scratch = m_shared->streamScratch.borrow( m_data->shards, m_generation);
+		try
+		{
+			openStreams();
+		}
+		catch (...)
+		{
+			closeStreams();
+			m_shared->streamScratch.giveBack( m_hs_scratch, m_generation);
+			throw;
+		}
+		m_checkpoints.push_back( CharMapCheckpoint( 0, 0));
+		m_normCheckpoints.push_back( CharMapCheckpoint( 0, 0));
+	}
+
+	virtual ~PatternLexerStreamContext()
+	{
+		closeStreams();
+		m_shared->streamScratch.giveBack( m_hs_scratch, m_generation);
+	}
+
+	virtual void reset()
+	{
+		try
+		{
+			updateLayers();
+			openStreams();
+			m_buf.clear();
+			m_bufpos = 0;
+			m_scanpos = 0;
+			m_mappos = 0;
+			m_checkpoints.clear();
+			m_checkpoints.push_back( CharMapCheckpoint( 0, 0));
+			m_rawtail.clear();
+			m_origpos = 0;
+			m_normCheckpoints.clear();
+			m_normCheckpoints.push_back( CharMapCheckpoint( 0, 0));
+			m_rawMatchAr.clear();
+			m_matchEventList.clear();
+			m_ordposAssigner.reset();
+			m_result.clear();
+			m_closed = false;
+		}
+		CATCH_ERROR_MAP( _TXT("error calling hyperscan lexer stream reset: %s"), *m_errorhnd);
+	}
+
+	virtual analyzer::PatternMatcherStatistics getStatistics() const
+	{
+		try
+		{
+			analyzer::PatternMatcherStatistics rt;
+			collectStatistics( rt);
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to get pattern lexer statistics: %s"), *m_errorhnd, analyzer::PatternMatcherStatistics());
+	}
+
+	/// \brief Add the statistics of this context to a structure
+	void collectStatistics( analyzer::PatternMatcherStatistics& stats) const
+	{
+		stats.define( "nofRematchCacheLookups", m_rematch.cache.nofLookups());
+		stats.define( "rematchCacheHitRate", m_rematch.cache.hitRate());
+		defineCandidateStatistics( stats, m_rematch.nofCandidates, m_rematch.nofFalseCandidates);
+		defineShardStatistics( stats, m_shardScanTime);
+		defineProfileStatistics( stats, m_rematch.profile, m_matchEventList.nofSuperseded(), m_data->patternTable);
+	}
+
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerStreamContext* THIS = (PatternLexerStreamContext*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			THIS->pushRawMatch( patternIdx, from, to);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	static int approx_match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerStreamContext* THIS = (PatternLexerStreamContext*)context;
+		try
+		{
+			from = THIS->m_data->patternTable.matchStart( patternIdx, from, to);
+			if (from < THIS->m_checkpoints[0].pos)
+			{
+				throw strus::runtime_error( "size of matched term out of range");
+			}
+			from = OneByteCharMap::charMapOrigPos( THIS->m_checkpoints, from);
+			to = OneByteCharMap::charMapOrigPos( THIS->m_checkpoints, to);
+			THIS->pushRawMatch( patternIdx, from, to);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	virtual void putInput( const char* chunk, std::size_t chunksize)
+	{
+		try
+		{
+			if (m_closed)
+			{
+				throw std::runtime_error( _TXT("called put input after close"));
+			}
+			if ((unsigned_long_long)m_bufpos + m_buf.size() + chunksize >= (unsigned_long_long)std::numeric_limits<uint32_t>::max())
+			{
+				throw strus::runtime_error( "size of string to scan out of range");
+			}
+			LexerProfile& profile = m_rematch.profile;
+			if (profile.enabled) profile.nofBytes += chunksize;
+			if (m_data->patternTable.normalization())
+			{
+				double start = profile.enabled ? monotonicTime() : 0.0;
+				appendNormalized( chunk, chunksize);
+				if (profile.enabled) profile.timeNormalize += monotonicTime() - start;
+			}
+			else
+			{
+				m_buf.append( chunk, chunksize);
+			}
+			const char* scanptr = m_buf.c_str() + (m_scanpos - m_bufpos);
+			std::size_t scansize = m_buf.size() - (m_scanpos - m_bufpos);
+
+			// Feed the new input to the Hyperscan engine:
+			hs_error_t err = HS_SUCCESS;
+			if (m_withApprox)
+			{
+				// ... a multibyte character at the end of the chunk that is not complete is mapped with the next chunk, all streams are fed with the same input
+				double start = profile.enabled ? monotonicTime() : 0.0;
+				scansize = utf8CompletePrefixSize( scanptr, scansize);
+				m_charmap.init( scanptr, scansize, m_data->codepage.get());
+				// ... the mapping of a chunk continues the mapping of the previous one, only the checkpoints after its multibyte characters are added
+				std::vector<CharMapCheckpoint>::const_iterator ci = m_charmap.checkpoints().begin(), ce = m_charmap.checkpoints().end();
+				for (++ci; ci != ce; ++ci)
+				{
+					m_checkpoints.push_back( CharMapCheckpoint( m_mappos + ci->pos, m_scanpos + ci->origpos));
+				}
+				m_mappos += m_charmap.size();
+				if (profile.enabled) profile.timeCharMap += monotonicTime() - start;
+			}
+			//... the callbacks in stream mode only buffer the matches, their evaluation is measured separately
+			double scanStart = profile.enabled ? monotonicTime() : 0.0;
+			bool measure = profile.enabled && m_streams.size() > 1;
+			if (measure && m_shardScanTime.size() < m_streams.size())
+			{
+				m_shardScanTime.resize( m_streams.size(), 0.0);
+			}
+			std::vector<ShardStreams>::iterator si = m_streams.begin(), se = m_streams.end();
+			for (std::size_t sidx=0; err == HS_SUCCESS && si != se; ++si,++sidx)
+			{
+				double start = measure ? monotonicTime() : 0.0;
+				if (si->stream)
+				{
+					err = hs_scan_stream( si->stream, scanptr, scansize, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				}
+				if (err == HS_SUCCESS && si->literalstream)
+				{
+					err = hs_scan_stream( si->literalstream, scanptr, scansize, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				}
+				if (err == HS_SUCCESS && si->approxstream)
+				{
+					err = hs_scan_stream( si->approxstream, m_charmap.data(), m_charmap.size(), 0/*reserved*/, m_hs_scratch, approx_match_event_handler, this);
+				}
+				if (measure) m_shardScanTime[ sidx] += monotonicTime() - start;
+			}
+			if (profile.enabled) profile.timeScan += monotonicTime() - scanStart;
+			m_scanpos += scansize;
+			if (err != HS_SUCCESS)
+			{
+				throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) in stream"), hsErrorName(err));
+			}
+			uint32_t evalpos = m_scanpos > (uint32_t)RematchLookahead ? (m_scanpos - (uint32_t)RematchLookahead) : 0;
+			evaluateMatches( evalpos);
+
+			// Matches evaluated later cannot start before the horizon, so all events before are final:
+			uint32_t horizon = evalpos > (uint32_t)MaxLexemSize ? (evalpos - (uint32_t)MaxLexemSize) : 0;
+			finalizeEvents( horizon);
+			releaseInput( horizon);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to feed input to pattern lexer stream: %s"), *m_errorhnd);
+	}
+
+	virtual void close()
+	{
+		try
+		{
+			if (m_closed)
+			{
+				throw std::runtime_error( _TXT("called close twice"));
+			}
+			// Report the matches at the end of data:
+			LexerProfile& profile = m_rematch.profile;
+			double scanStart = profile.enabled ? monotonicTime() : 0.0;
+			hs_error_t err = HS_SUCCESS;
+			std::vector<ShardStreams>::iterator si = m_streams.begin(), se = m_streams.end();
+			for (; si != se; ++si)
+			{
+				hs_error_t shard_err = si->close( m_hs_scratch, match_event_handler, approx_match_event_handler, this);
+				if (err == HS_SUCCESS) err = shard_err;
+			}
+			if (profile.enabled) profile.timeScan += monotonicTime() - scanStart;
+			m_closed = true;
+			if (err != HS_SUCCESS)
+			{
+				throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) at end of stream"), hsErrorName(err));
+			}
+			evaluateMatches( m_scanpos);
+			finalizeEvents( std::numeric_limits<uint32_t>::max());
+			if (!m_ordposAssigner.started())
+			{
+				m_result.clear();
+			}
+		}
+		CATCH_ERROR_MAP( _TXT("failed to close pattern lexer stream: %s"), *m_errorhnd);
+	}
+
+	virtual std::vector<analyzer::PatternLexem> fetchResults()
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			if (m_ordposAssigner.started())
+			{
+				// ... lexems bound to the successor before the first lexem with content are only valid if such a lexem exists
+				rt.swap( m_result);
+			}
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to fetch results of pattern lexer stream: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+private:
+	/// \brief Switch to the snapshot with the layers of databases added or merged since the creation of the context or its last update, if there is one
+	/// \note A document is always matched with the snapshot that was current when its stream was opened, the switch is done on reset
+	void updateLayers()
+	{
+		if (m_shared->generation() == m_generation) return;
+		TermMatchDataReference data( m_shared->data());
+		if (data.get() == m_data.get()) return;
+		closeStreams();
+		allocScratch( &m_hs_scratch, data->shards, true/*stream mode*/);
+		m_data = data;
+		m_withApprox = m_data->withApprox();
+		m_streams.assign( m_data->shards.size(), ShardStreams());
+		m_shardScanTime.clear();
+		m_generation = m_data->generation;
+	}
+
+	/// \brief Open the hyperscan streams or reset them if already open
+	void openStreams()
+	{
+		hs_error_t err = HS_SUCCESS;
+		std::vector<TermMatchShardReference>::const_iterator hi = m_data->shards.begin(), he = m_data->shards.end();
+		std::vector<ShardStreams>::iterator si = m_streams.begin();
+		for (; err == HS_SUCCESS && hi != he; ++hi,++si)
+		{
+			err = openStream( &si->stream, (*hi)->streamdb);
+			if (err == HS_SUCCESS)
+			{
+				err = openStream( &si->literalstream, (*hi)->literalstreamdb);
+			}
+			if (err == HS_SUCCESS)
+			{
+				err = openStream( &si->approxstream, (*hi)->approxstreamdb);
+			}
+		}
+		if (err != HS_SUCCESS)
+		{
+			throw strus::runtime_error(_TXT("failed to reset hyperscan stream (hyperscan error %s)"), hsErrorName(err));
+		}
+	}
+
+	hs_error_t openStream( hs_stream_t** stream, const hs_database_t* db)
+	{
+		if (!db) return HS_SUCCESS;
+		if (*stream)
+		{
+			return hs_reset_stream( *stream, 0/*flags*/, m_hs_scratch, NULL/*no match reporting*/, NULL);
+		}
+		return hs_open_stream( db, 0/*flags*/, stream);
+	}
+
+	/// \brief Close the hyperscan streams without reporting matches
+	void closeStreams()
+	{
+		std::vector<ShardStreams>::iterator si = m_streams.begin(), se = m_streams.end();
+		for (; si != se; ++si)
+		{
+			(void)si->close( m_hs_scratch, NULL/*no match reporting*/, NULL, NULL);
+		}
+	}
+
+	void pushRawMatch( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to)
+	{
+		if (from < m_bufpos)
+		{
+			throw strus::runtime_error( "size of matched term out of range");
+		}
+		// ... the evaluation of the match is delayed until the input following the match is available
+		m_rawMatchAr.push_back( RawMatch( patternIdx, (uint32_t)from, (uint32_t)to));
+	}
+
+	void evaluateMatches( uint32_t evalpos)
+	{
+		// ... the matches of the two streams are not ordered by their end, so all matches are checked
+		std::vector<RawMatch>::iterator ri = m_rawMatchAr.begin(), re = m_rawMatchAr.end(), rw = m_rawMatchAr.begin();
+		for (; ri != re; ++ri)
+		{
+			if (ri->to <= evalpos)
+			{
+				pushMatchEvent( m_matchEventList, m_data->patternTable, ri->patternIdx, m_buf.c_str(), m_buf.size(), m_bufpos, ri->from - m_bufpos, ri->to - m_bufpos, m_rematch);
+			}
 			else
 			{
-				// Handle superseeding of elements by elements with higher level:
-				std::size_t nofDeletes = 0;
-				uint32_t matchLastPos = matchEvent.origpos + matchEvent.origsize;
-				std::vector<MatchEvent>::reverse_iterator
-					mi = THIS->m_matchEventAr.rbegin(),
-					me = THIS->m_matchEventAr.rend();
-				for (; mi != me && mi->origpos >= matchEvent.origpos; ++mi)
-				{
-					if ((matchEvent.id == mi->id && mi->origpos == matchEvent.origpos && mi->level == matchEvent.level)
-					|| (mi->level < matchEvent.level && mi->origpos + mi->origsize <= matchLastPos))
-					{
-						// ... an old element is overwritten because it is completely covered by one element with a higher level already in the list
-						std::vector<MatchEvent>::iterator oi = mi.base()-1;
-						std::vector<MatchEvent>::iterator prev_oi = oi++;
-						for (; oi != THIS->m_matchEventAr.end(); prev_oi = oi++)
-						{
-							*prev_oi = *oi;
-						}
-						++nofDeletes;
-					}
-				}
-				THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size()-nofDeletes);
-				if (!nofDeletes)
-				{
-					// ... if we had delete then there cannot exist an element covering the
-					//     new element. Otherwise deletes would have happened before
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					for (; mi != me && mi->origpos + mi->origsize >= matchLastPos; ++mi)
-					{
-						if (mi->level > matchEvent.level && mi->origpos <= matchEvent.origpos)
-						{
-							// ... the new element is ignored because it is completely covered by one element with a higher level already in the list
-							return 0;
-						}
-					}
-				}
-				// Insert the new element with ascending order of origpos
-				if (patternid == patternDef.id())
-				{
-					THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size() + 1);
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					std::vector<MatchEvent>::reverse_iterator prev_mi = mi;
-					for (++mi; mi != me && mi->origpos > matchEvent.origpos; prev_mi=mi++)
-					{
-						*prev_mi = *mi;
-					}
-					--mi;
-					*mi = matchEvent;
-				}
-				else
+				*rw++ = *ri;
+			}
+		}
+		m_rawMatchAr.erase( rw, re);
+	}
+
+	void finalizeEvents( uint32_t horizon)
+	{
+		LexerProfile& profile = m_rematch.profile;
+		double start = profile.enabled ? monotonicTime() : 0.0;
+		m_matchEventList.resolve( horizon);
+		if (profile.enabled)
+		{
+			double resolved = monotonicTime();
+			profile.timeResolve += resolved - start;
+			start = resolved;
+		}
+		LexemVectorOutput out( m_result);
+		if (m_data->patternTable.normalization())
+		{
+			NormalizedPositionOutput<LexemVectorOutput> normout( out, m_normCheckpoints);
+			m_ordposAssigner.append( normout, m_matchEventList.begin(), m_matchEventList.end());
+		}
+		else
+		{
+			m_ordposAssigner.append( out, m_matchEventList.begin(), m_matchEventList.end());
+		}
+		m_matchEventList.clearResolved();
+		if (profile.enabled) profile.timeOutput += monotonicTime() - start;
+	}
+
+	/// \brief Append a chunk of input normalized to the buffer, a multibyte character at the end of the chunk that is not complete is normalized with the next chunk
+	void appendNormalized( const char* chunk, std::size_t chunksize)
+	{
+		m_rawtail.append( chunk, chunksize);
+		std::size_t completesize = utf8CompletePrefixSize( m_rawtail.c_str(), m_rawtail.size());
+		m_normalized.init( m_rawtail.c_str(), completesize, m_data->patternTable.normalization());
+		uint32_t normpos = m_bufpos + m_buf.size();
+		std::vector<CharMapCheckpoint>::const_iterator ci = m_normalized.checkpoints().begin(), ce = m_normalized.checkpoints().end();
+		for (++ci; ci != ce; ++ci)
+		{
+			m_normCheckpoints.push_back( CharMapCheckpoint( normpos + ci->pos, m_origpos + ci->origpos));
+		}
+		m_origpos += completesize;
+		m_rawtail.erase( 0, completesize);
+		m_buf.append( m_normalized.data(), m_normalized.size());
+	}
+
+	void releaseInput( uint32_t horizon)
+	{
+		if (horizon > m_bufpos + (uint32_t)MaxLexemSize)
+		{
+			// ... release only bigger blocks to amortize the cost of moving the rest
+			m_buf.erase( 0, horizon - m_bufpos);
+			m_bufpos = horizon;
+			// ... keep the last checkpoint before the horizon, it is needed to map the positions following
+			std::vector<CharMapCheckpoint>::iterator ci = m_checkpoints.begin(), ce = m_checkpoints.end();
+			for (; ci+1 != ce && (ci+1)->origpos <= horizon; ++ci){}
+			m_checkpoints.erase( m_checkpoints.begin(), ci);
+			std::vector<CharMapCheckpoint>::iterator ni = m_normCheckpoints.begin(), ne = m_normCheckpoints.end();
+			for (; ni+1 != ne && (ni+1)->pos <= horizon; ++ni){}
+			m_normCheckpoints.erase( m_normCheckpoints.begin(), ni);
+		}
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const TermMatchShared* m_shared;
+	TermMatchDataReference m_data;				///< snapshot the streams are opened with, kept alive by this context if the layers of the lexer change
+	unsigned int m_generation;				///< generation of the snapshot the streams are opened with
+	hs_scratch_t* m_hs_scratch;
+	bool m_withApprox;					///< true if there are patterns matched on the source mapped to a one byte character set in the shards
+	/// \brief Streams of the databases of a shard, NULL if the shard has no patterns of a kind
+	struct ShardStreams
+	{
+		hs_stream_t* stream;			///< stream of the patterns matched on the UTF-8 source
+		hs_stream_t* literalstream;		///< stream of the literal patterns
+		hs_stream_t* approxstream;		///< stream of the patterns matched on the source mapped to a one byte character set
+
+		ShardStreams()
+			:stream(0),literalstream(0),approxstream(0){}
+		ShardStreams( const ShardStreams& o)
+			:stream(o.stream),literalstream(o.literalstream),approxstream(o.approxstream){}
+
+		/// \brief Close the streams, reporting the matches at the end of data if handlers are passed
+		hs_error_t close( hs_scratch_t* scratch, ::match_event_handler onMatch, ::match_event_handler onApproxMatch, void* context)
+		{
+			hs_error_t rt = HS_SUCCESS;
+			hs_stream_t* streamar[3] = {stream, literalstream, approxstream};
+			stream = 0;
+			literalstream = 0;
+			approxstream = 0;
+			int si = 0;
+			for (; si < 3; ++si)
+			{
+				if (!streamar[ si]) continue;
+				hs_error_t err = hs_close_stream( streamar[ si], scratch, si == 2 ? onApproxMatch : onMatch, context);
+				if (rt == HS_SUCCESS) rt = err;
+			}
+			return rt;
+		}
+	};
+	std::vector<ShardStreams> m_streams;		///< streams per shard of the patterns
+	std::vector<double> m_shardScanTime;		///< scan time accumulated per shard in seconds, if the patterns are split into shards
+	std::string m_buf;				///< input not released yet, needed for the evaluation of matches in the following chunks
+	uint32_t m_bufpos;				///< document position of the start of m_buf
+	uint32_t m_scanpos;				///< document position of the end of the input fed to hyperscan
+	uint32_t m_mappos;				///< one byte char map position of the end of the input fed to hyperscan
+	std::vector<CharMapCheckpoint> m_checkpoints;	///< map of one byte char map positions to document positions, starting with the last checkpoint before the input released
+	OneByteCharMap m_charmap;
+	NormalizedCharMap m_normalized;			///< last chunk normalized, if the patterns are matched on normalized sources (the document positions are then positions in the normalized document)
+	std::string m_rawtail;				///< incomplete multibyte character at the end of the last chunk, normalized with the next chunk
+	uint32_t m_origpos;				///< position in the original document of the end of the input normalized
+	std::vector<CharMapCheckpoint> m_normCheckpoints;	///< map of normalized document positions to original document positions, starting with the last checkpoint before the input released
+	struct RawMatch
+	{
+		unsigned int patternIdx;
+		uint32_t from;
+		uint32_t to;
+
+		RawMatch( unsigned int patternIdx_, uint32_t from_, uint32_t to_)
+			:patternIdx(patternIdx_),from(from_),to(to_){}
+	};
+	std::vector<RawMatch> m_rawMatchAr;		///< matches reported by hyperscan not evaluated yet
+	MatchEventList m_matchEventList;
+	OrdinalPositionAssigner m_ordposAssigner;
+	std::vector<analyzer::PatternLexem> m_result;
+	RematchWorkspace m_rematch;
+	bool m_closed;
+};
+
+class PatternMatchPipeline
+	:public PatternMatchPipelineInterface
+{
+public:
+	/// \param[in] matcher_ pattern matcher context (with ownership, passed only if the constructor succeeds)
+	PatternMatchPipeline( const TermMatchShared* shared_, PatternMatcherContextInterface* matcher_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_lexer( shared_, errorhnd_),m_matcher(0),m_consumer(0)
+	{
+		m_consumer = dynamic_cast<PatternMatcherTermConsumer*>( matcher_);
+		if (!m_consumer)
+		{
+			throw std::runtime_error( _TXT("pattern matcher not implemented by this library"));
+		}
+		m_matcher = matcher_;
+	}
+
+	virtual ~PatternMatchPipeline()
+	{
+		delete m_matcher;
+	}
+
+	virtual std::vector<analyzer::PatternMatcherResult> match( const char* src, std::size_t srcsize)
+	{
+		try
+		{
+			//... an error of the reset is thrown, errors left in the buffer by other calls do not fail the document
+			m_consumer->resetAutomaton();
+			m_lexer.matchToMatcher( src, srcsize, m_consumer);
+			return m_matcher->fetchResults();
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern match pipeline: %s"), *m_errorhnd, std::vector<analyzer::PatternMatcherResult>());
+	}
+
+	virtual analyzer::PatternMatcherStatistics getStatistics() const
+	{
+		try
+		{
+			analyzer::PatternMatcherStatistics rt = m_matcher->getStatistics();
+			m_lexer.collectStatistics( rt);
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to get pattern match pipeline statistics: %s"), *m_errorhnd, analyzer::PatternMatcherStatistics());
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	PatternLexerContext m_lexer;
+	PatternMatcherContextInterface* m_matcher;
+	PatternMatcherTermConsumer* m_consumer;
+};
+
+/// \brief Instruction set variant the hyperscan databases can be compiled for
+struct CompileTarget
+{
+	const char* name;			///< name of the variant reported in the introspection
+	unsigned int tune;			///< hyperscan tune family
+	unsigned_long_long cpu_features;	///< hyperscan CPU features required
+};
+
+/// \brief Variants compiled with the option MULTITARGET, ordered by ascending requirements
+static const CompileTarget g_compileTargets[] =
+{
+	{"generic", HS_TUNE_FAMILY_GENERIC, 0},
+	{"avx2", HS_TUNE_FAMILY_HSW, HS_CPU_FEATURES_AVX2},
+	{"avx512", HS_TUNE_FAMILY_SKX, HS_CPU_FEATURES_AVX2 | HS_CPU_FEATURES_AVX512},
+	{0, 0, 0}
+};
+
+/// \brief Array of hyperscan databases freed on destruction if not released
+class DatabaseArray
+{
+public:
+	explicit DatabaseArray( std::size_t size_)
+		:m_ar( size_, (hs_database_t*)0){}
+	~DatabaseArray()
+	{
+		clear();
+	}
+
+	/// \brief Free all databases not released
+	void clear()
+	{
+		std::vector<hs_database_t*>::iterator di = m_ar.begin(), de = m_ar.end();
+		for (; di != de; ++di)
+		{
+			if (*di) hs_free_database( *di);
+			*di = 0;
+		}
+	}
+
+	hs_database_t** ptr()			{return &m_ar[0];}
+	hs_database_t* release( std::size_t idx)
+	{
+		hs_database_t* rt = m_ar[ idx];
+		m_ar[ idx] = 0;
+		return rt;
+	}
+	std::size_t size() const		{return m_ar.size();}
+
+private:
+	DatabaseArray( const DatabaseArray&){}		//... non copyable
+	void operator=( const DatabaseArray&){}		//... non copyable
+
+private:
+	std::vector<hs_database_t*> m_ar;
+};
+
+/// \brief Compiler of the databases of a shard of the patterns in a thread of its own
+/// \note A shard is a contiguous range of each pattern table, the shards are of equal size
+/// \remark Errors are not reported to the error buffer, because the thread might not be known to it, but kept and reported by the caller after the compilation
+class PatternShardCompiler
+{
+public:
+	/// \brief Index of the databases of a shard relative to the first one
+	enum {ExactBlock=0,ExactStream=1,LiteralBlock=2,LiteralStream=3,ApproxBlock=4,ApproxStream=5};
+
+	/// \param[in] tablear_ tables of the exact, of the literal and of the approximate patterns
+	/// \param[in] shardidx_ index of the shard to compile
+	/// \param[in] nofShards_ number of shards the patterns are split into
+	/// \param[in] platformar_ platforms to compile the databases for
+	/// \param[in] selected_ index of the platform selected for scanning on this host
+	/// \param[in] allTargets_ true if the databases are compiled for all platforms, false if only for the selected one
+	/// \param[in] withStream_ true if also the databases for stream mode are compiled
+	/// \param[out] dbar_ where to write the databases compiled to, per platform and shard TermMatchData::NofDatabases databases
+	PatternShardCompiler( const HsPatternTable* const* tablear_, std::size_t shardidx_, std::size_t nofShards_, const std::vector<hs_platform_info_t>& platformar_, std::size_t selected_, bool allTargets_, bool withStream_, hs_database_t** dbar_)
+		:m_shardidx(shardidx_),m_nofShards(nofShards_),m_platformar(&platformar_),m_selected(selected_),m_allTargets(allTargets_),m_withStream(withStream_),m_dbar(dbar_),m_errcode(HS_SUCCESS),m_error()
+	{
+		m_tablear[0] = tablear_[0];
+		m_tablear[1] = tablear_[1];
+		m_tablear[2] = tablear_[2];
+	}
+
+	/// \brief Compile the databases of the shard, the entry point of the thread
+	void run()
+	{
+		try
+		{
+			std::size_t nofdb = TermMatchData::NofDatabases * m_nofShards;
+			std::size_t pi = 0, pe = m_platformar->size();
+			for (; pi != pe; ++pi)
+			{
+				if (pi != m_selected && !m_allTargets) continue;
+				hs_database_t** shard_dbar = m_dbar + pi*nofdb + m_shardidx*TermMatchData::NofDatabases;
+				int ti = 0;
+				for (; ti < 3; ++ti)
 				{
-					THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size() + 2);
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					std::vector<MatchEvent>::reverse_iterator prev_mi = mi;
-					for (mi+=2; mi != me && mi->origpos > matchEvent.origpos; prev_mi=mi++)
+					//... the tables are in the same order as the databases
+					if (!compileDatabases( shard_dbar + ti*2, shard_dbar + ti*2 + 1, *m_tablear[ ti], &(*m_platformar)[ pi]))
 					{
-						*prev_mi = *mi;
+						return;
 					}
-					--mi;
-					*mi = matchEvent;
-					--mi;
-					*mi = MatchEvent( patternid, patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from));
 				}
 			}
-			return 0;
 		}
-		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
-	}
-
-	static const char* hsErrorName( int ec)
-	{
-		switch (ec) {
-			case HS_SUCCESS:
-				return "HS_SUCCESS";
-			case HS_INVALID:
-				return "HS_INVALID";
-			case HS_NOMEM:
-				return "HS_NOMEM";
-			case HS_SCAN_TERMINATED:
-				return "HS_SCAN_TERMINATED";
-			case HS_COMPILER_ERROR:
-				return "HS_COMPILER_ERROR";
-			case HS_DB_VERSION_ERROR:
-				return "HS_DB_VERSION_ERROR";
-			case HS_DB_PLATFORM_ERROR:
-				return "HS_DB_PLATFORM_ERROR";
-			case HS_DB_MODE_ERROR:
-				return "HS_DB_MODE_ERROR";
-			case HS_BAD_ALIGN:
-				return "HS_BAD_ALIGN";
-			case HS_BAD_ALLOC:
-				return "HS_BAD_ALLOC";
-			case HS_SCRATCH_IN_USE:
-				return "HS_SCRATCH_IN_USE";
-			default:
-				return "unknown";
+		catch (const std::bad_alloc&)
+		{
+			m_errcode = HS_NOMEM;
+			m_error = _TXT("out of memory");
+		}
+		catch (const std::exception& err)
+		{
+			m_errcode = HS_INVALID;
+			m_error = err.what();
 		}
 	}
 
-	virtual std::vector<analyzer::PatternLexem> match( const char* src, std::size_t srclen)
+	/// \brief Get the error of the compilation, empty if it succeeded
+	const std::string& error() const	{return m_error;}
+	/// \brief Get the hyperscan error code of the compilation
+	hs_error_t errcode() const		{return m_errcode;}
+
+private:
+	/// \brief Compile the block mode and if required the stream mode database of the shard of a pattern table, leaving them null if the shard is empty
+	bool compileDatabases( hs_database_t** blockdb, hs_database_t** streamdb, const HsPatternTable& hspt, const hs_platform_info_t* platform)
 	{
-		try
+		std::size_t start = hspt.arsize * m_shardidx / m_nofShards;
+		std::size_t size = hspt.arsize * (m_shardidx+1) / m_nofShards - start;
+		if (!size) return true;
+		if (!compileDatabase( blockdb, hspt, start, size, HS_MODE_BLOCK, platform))
 		{
-			std::vector<analyzer::PatternLexem> rt;
-			unsigned int nofExpectedTokens = srclen / 4 + 10;
-			m_matchEventAr.reserve( nofExpectedTokens);
-			m_src = src;
-			if (srclen >= (std::size_t)std::numeric_limits<uint32_t>::max())
-			{
-				throw strus::runtime_error( "size of string to scan out of range");
-			}
-			// Collect all matches calling the Hyperscan engine:
-			hs_error_t err;
-			if (m_data->patternTable.withOneByteCharMap())
+			return false;
+		}
+		if (m_withStream)
+		{
+			// ... patterns compiled with HS_FLAG_SOM_LEFTMOST need a start of match horizon covering the maximum lexem size, the others none:
+			unsigned int mode = HS_MODE_STREAM;
+			if (hspt.withStartOfMatch( start, size))
 			{
-				m_charmap.init( src, srclen);
-				err = hs_scan( m_data->patterndb, m_charmap.value.c_str(), m_charmap.value.size(), 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				mode |= HS_MODE_SOM_HORIZON_LARGE;
 			}
-			else
+			if (!compileDatabase( streamdb, hspt, start, size, mode, platform))
 			{
-				err = hs_scan( m_data->patterndb, src, srclen, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				return false;
 			}
-			m_src = 0;
-			if (err != HS_SUCCESS)
+		}
+		return true;
+	}
+
+	bool compileDatabase( hs_database_t** db, const HsPatternTable& hspt, std::size_t start, std::size_t size, unsigned int mode, const hs_platform_info_t* platform)
+	{
+		hs_compile_error_t* compile_err = 0;
+
+		hs_error_t err = hspt.literal
+			? hs_compile_lit_multi(
+				hspt.patternar + start, hspt.flagar + start, hspt.idar + start, hspt.lenar + start, size, mode, platform,
+				db, &compile_err)
+			: hs_compile_ext_multi(
+				hspt.patternar + start, hspt.flagar + start, hspt.idar + start, hspt.extar + start, size, mode, platform,
+				db, &compile_err);
+		if (err != HS_SUCCESS)
+		{
+			m_errcode = err;
+			if (compile_err)
 			{
-				char srcbuf[ 128];
-				if (srclen > sizeof(srcbuf)-1) srclen = sizeof(srcbuf)-1;
-				std::memcpy( srcbuf, src, srclen);
-				srcbuf[ srclen] = 0;
-				m_matchEventAr.clear();
-				throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) on '%s'"), hsErrorName(err), srcbuf);
-			}
-			rt.reserve( m_matchEventAr.size());
-
-			// Build the result term array, calculate ordinal positions of the result terms:
-			std::vector<MatchEvent>::const_iterator
-				mi = m_matchEventAr.begin(), me = m_matchEventAr.end();
-			uint32_t ordpos = 0;
-			uint32_t origpos = 0;
-			uint8_t lastposbind = (uint8_t)analyzer::BindContent;
-			for (; mi != me; ++mi)
-			{
-				lastposbind = mi->posbind;
-				switch ((analyzer::PositionBind)mi->posbind)
+				const char* error_pattern = compile_err->expression < 0 ?0:hspt.patternar[ start + compile_err->expression];
+				if (error_pattern)
 				{
-					case analyzer::BindUnique:
-					case analyzer::BindContent:
-						ordpos = 1;
-						origpos = mi->origpos;
-						rt.push_back( analyzer::PatternLexem( mi->id, 1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						++mi;
-						goto EXITLOOP;
-					case analyzer::BindSuccessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, 1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindPredecessor:
-						break;
+					m_error = std::string( _TXT( "failed to compile pattern")) + " \"" + error_pattern + "\": " + compile_err->message;
 				}
-			}
-			EXITLOOP:
-			if (ordpos == 0)
-			{
-				rt.clear();
-			}
-			for (; mi != me; ++mi)
-			{
-				switch ((analyzer::PositionBind)mi->posbind)
+				else
 				{
-					case analyzer::BindUnique:
-						if (lastposbind == (uint8_t)analyzer::BindUnique) break;
-					case analyzer::BindContent:
-						if (mi->origpos > origpos)
-						{
-							origpos = mi->origpos;
-							++ordpos;
-						}
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindSuccessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos+1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindPredecessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
+					m_error = std::string( _TXT( "failed to build automaton from expressions")) + ": " + compile_err->message;
 				}
-				lastposbind = mi->posbind;
+				hs_free_compile_error( compile_err);
 			}
-			m_matchEventAr.clear();
-			return rt;
+			else
+			{
+				m_error = _TXT( "unknown error building automaton from expressions");
+			}
+			return false;
 		}
-		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+		return true;
 	}
 
 private:
-	ErrorBufferInterface* m_errorhnd;
-	const TermMatchData* m_data;
-	hs_scratch_t* m_hs_scratch;
-	const char* m_src;
-	std::vector<MatchEvent> m_matchEventAr;
-	OneByteCharMap m_charmap;
+	PatternShardCompiler( const PatternShardCompiler&){}		//... non copyable
+	void operator=( const PatternShardCompiler&){}			//... non copyable
+
+private:
+	const HsPatternTable* m_tablear[3];
+	std::size_t m_shardidx;
+	std::size_t m_nofShards;
+	const std::vector<hs_platform_info_t>* m_platformar;
+	std::size_t m_selected;
+	bool m_allTargets;
+	bool m_withStream;
+	hs_database_t** m_dbar;
+	hs_error_t m_errcode;
+	std::string m_error;
 };
 
 class PatternLexerInstance
-	:public PatternLexerInstanceInterface
+	:public PatternLexerInstanceExtInterface
 {
 public:
 	explicit PatternLexerInstance( ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_data(errorhnd_),m_state(DefinitionPhase),m_flags(0),m_idnamemap(),m_idnamestrings()
+		:m_errorhnd(errorhnd_),m_mutex(),m_mergeMutex(),m_patternTable(errorhnd_),m_shared(),m_nofThreads(0),m_nofShards(0),m_profiling(false),m_generation(0),m_symbolsDefined(false)
+		,m_state(DefinitionPhase),m_flags(0),m_withStream(false),m_idnamemap(),m_idnamestrings()
+		,m_cache(),m_loadedFromCache(false),m_target(TargetGeneric),m_targetName(),m_compileTime(0.0),m_nofCompiled(0)
 	{}
 
 	virtual ~PatternLexerInstance(){}
@@ -996,11 +3249,9 @@ public:
 	{
 		try
 		{
-			if (m_state != DefinitionPhase)
-			{
-				throw std::runtime_error( _TXT("called define pattern after calling 'compile'"));
-			}
-			m_data.patternTable.definePattern( id, expression, resultIndex, level, posbind);
+			strus::scoped_lock lock( m_mutex);
+			//... patterns defined after calling 'compile' are compiled into a new layer by the next call of 'compile'
+			m_patternTable.definePattern( id, expression, resultIndex, level, posbind);
 		}
 		CATCH_ERROR_MAP( _TXT("failed to define term match regular expression pattern: %s"), *m_errorhnd);
 	}
@@ -1009,11 +3260,10 @@ public:
 	{
 		try
 		{
-			if (m_state != DefinitionPhase)
-			{
-				throw std::runtime_error( _TXT("called define pattern after calling 'compile'"));
-			}
-			m_data.patternTable.defineSymbol( symbolid, patternid, name_);
+			strus::scoped_lock lock( m_mutex);
+			//... symbols defined after calling 'compile' are visible to the contexts after the next call of 'compile'
+			m_patternTable.defineSymbol( symbolid, patternid, name_);
+			m_symbolsDefined = true;
 		}
 		CATCH_ERROR_MAP( _TXT("failed to define regular expression pattern symbol: %s"), *m_errorhnd);
 	}
@@ -1023,15 +3273,22 @@ public:
 	{
 		try
 		{
-			return m_data.patternTable.getSymbol( patternid, name_);
+			strus::scoped_lock lock( m_mutex);
+			return m_patternTable.getSymbol( patternid, name_);
 		}
 		CATCH_ERROR_MAP_RETURN( _TXT("failed to retrieve regular expression pattern symbol: %s"), *m_errorhnd, 0);
 	}
 
-	virtual void defineOption( const std::string& name_, double)
+	virtual void defineOption( const std::string& name_, double value)
 	{
 		try
 		{
+			strus::scoped_lock lock( m_mutex);
+			if (m_state != DefinitionPhase)
+			{
+				//... the layers compiled later and the snapshots scanned by the contexts rely on the options of the first compilation
+				throw strus::runtime_error(_TXT("option '%s' has to be defined before calling 'compile'"), name_.c_str());
+			}
 			if (strus::caseInsensitiveEquals( name_, "CASELESS"))
 			{
 				m_flags |= HS_FLAG_CASELESS;
@@ -1054,7 +3311,50 @@ public:
 			}
 			else if (strus::caseInsensitiveEquals( name_, "BYTECHAR"))
 			{
-				m_data.patternTable.forceOneByteCharMap();
+				m_patternTable.forceOneByteCharMap();
+			}
+			else if (strus::caseInsensitiveEquals( name_, "NORMALIZE") || strus::caseInsensitiveEquals( name_, "NODIACRITICS"))
+			{
+				if (!m_patternTable.empty())
+				{
+					throw strus::runtime_error(_TXT("option '%s' has to be defined before the lexems and symbols"), name_.c_str());
+				}
+				m_patternTable.defineNormalization( strus::caseInsensitiveEquals( name_, "NORMALIZE")
+						? NormalizedCharMap::CaseFold
+						: (NormalizedCharMap::CaseFold | NormalizedCharMap::StripDiacritics));
+			}
+			else if (strus::caseInsensitiveEquals( name_, "STREAM"))
+			{
+				m_withStream = true;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "STATISTICS"))
+			{
+				//... the contexts created after measure the phases of the lexer for their statistics
+				m_profiling = true;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "HOSTTUNED"))
+			{
+				if (m_target == TargetGeneric) m_target = TargetHost;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "MULTITARGET"))
+			{
+				m_target = TargetMulti;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "THREADS"))
+			{
+				if (value < 0.0 || value > 1024.0)
+				{
+					throw strus::runtime_error(_TXT("value of option '%s' out of range"), name_.c_str());
+				}
+				m_nofThreads = (unsigned int)value;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "SHARDS"))
+			{
+				if (value < 0.0 || value > 256.0)
+				{
+					throw strus::runtime_error(_TXT("value of option '%s' out of range"), name_.c_str());
+				}
+				m_nofShards = (unsigned int)value;
 			}
 			else
 			{
@@ -1069,67 +3369,246 @@ public:
 	{
 		try
 		{
-			if (m_data.patterndb) hs_free_database( m_data.patterndb);
-			m_data.patterndb = 0;
-
-			HsPatternTable hspt;
-			m_data.patternTable.complete( hspt, m_flags);
+			strus::scoped_lock lock( m_mutex);
+			double compileStart = monotonicTime();
+			//... calling 'compile' again compiles the patterns defined since into a new layer, the databases compiled before are kept
+			bool incremental = (m_state == MatchPhase);
+			std::size_t startidx = incremental ? m_nofCompiled : 0;
+			if (incremental && startidx == m_patternTable.nofDefinitions())
+			{
+				if (m_symbolsDefined)
+				{
+					//... symbols defined since the last compilation are published with the layers compiled before
+					TermMatchDataReference current( m_shared.data());
+					m_patternTable.prepare( startidx, current->codepage.get());
+					publish( current->shards, current->codepage, current->nofLayers);
+				}
+				return true;
+			}
+			//... the regular expressions for the rematch are compiled by as many threads as there are shards
+			m_patternTable.complete( m_nofShards);
+			//... the code page of the layers is the one of the base, a new one would not fit to the databases compiled before
+			TermMatchDataReference current( m_shared.data());
+			Reference<OneByteCodePage> codepage( incremental ? current->codepage : Reference<OneByteCodePage>());
+			if (!codepage.get())
+			{
+				codepage.reset( m_patternTable.createCodePage());
+			}
+			m_patternTable.prepare( startidx, codepage.get());
 
-			hs_platform_info_t platform;
-			std::memset( &platform, 0, sizeof(platform));
-			platform.cpu_features = HS_TUNE_FAMILY_GENERIC;
-			hs_compile_error_t* compile_err = 0;
+			//... a layer is small and not worth to be split into shards
+			std::vector<TermMatchShardReference> shards;
+			CompileResult result;
+			if (!compileShards( m_patternTable, startidx, incremental ? 1 : m_nofShards, shards, result))
+			{
+				return false;
+			}
+			if (incremental)
+			{
+				shards.insert( shards.begin(), current->shards.begin(), current->shards.end());
+			}
+			publish( shards, codepage, incremental ? (current->nofLayers + 1) : 1);
+			m_loadedFromCache = result.loadedFromCache;
+			m_targetName = result.targetName;
+			m_nofCompiled = m_patternTable.nofDefinitions();
+			m_compileTime = monotonicTime() - compileStart;
+			m_state = MatchPhase;
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to compile regular expression patterns: %s"), *m_errorhnd, false);
+	}
 
-			hs_error_t err =
-				hs_compile_ext_multi(
-					hspt.patternar, hspt.flagar, hspt.idar, hspt.extar, hspt.arsize, HS_MODE_BLOCK, &platform,
-					&m_data.patterndb, &compile_err);
-			if (err != HS_SUCCESS)
+	virtual bool mergeLayers()
+	{
+		try
+		{
+			//... merges are serialized, definitions and compilations are only blocked while the patterns are copied and the result is published
+			strus::scoped_lock mergeLock( m_mergeMutex);
+			strus::local_ptr<PatternTable> table;
+			std::size_t nofMerged = 0;
+			std::size_t nofPrunedBefore = 0;
+			TermMatchDataReference before;
 			{
-				if (compile_err)
+				strus::scoped_lock lock( m_mutex);
+				if (m_state != MatchPhase)
 				{
-					const char* error_pattern = compile_err->expression < 0 ?0:hspt.patternar[ compile_err->expression];
-					if (error_pattern)
-					{
-						m_errorhnd->report(
-							hyperscanErrorCode( err),
-							_TXT( "failed to compile pattern \"%s\": %s\n"), error_pattern, compile_err->message);
-					}
-					else
-					{
-						m_errorhnd->report(
-							hyperscanErrorCode( err),
-							_TXT( "failed to build automaton from expressions: %s\n"), compile_err->message);
-					}
-					hs_free_compile_error( compile_err);
+					throw std::runtime_error( _TXT("called merge layers without calling 'compile'"));
+				}
+				//... the patterns compiled so far are merged, the ones defined meanwhile stay in the next layer
+				nofMerged = m_nofCompiled;
+				nofPrunedBefore = m_patternTable.nofPruned();
+				table.reset( new PatternTable( m_patternTable));
+				m_patternTable.markSymbolTablesShared();
+				before = m_shared.data();
+			}
+			double compileStart = monotonicTime();
+			table->truncate( nofMerged);
+			//... the code page is derived again from the characters of all patterns
+			Reference<OneByteCodePage> codepage( table->createCodePage());
+			table->prepare( 0/*all*/, codepage.get());
+
+			//... the layers are replaced only if the compilation succeeds, the streams open keep the replaced ones alive
+			std::vector<TermMatchShardReference> shards;
+			CompileResult result;
+			if (!compileShards( *table.get(), 0/*all*/, m_nofShards, shards, result))
+			{
+				return false;
+			}
+			strus::scoped_lock lock( m_mutex);
+			TermMatchDataReference current( m_shared.data());
+			unsigned int nofLayers = 1;
+			std::size_t nofPrunedLayers = m_patternTable.nofPruned() - nofPrunedBefore;
+			if (m_nofCompiled > nofMerged)
+			{
+				//... layers have been compiled during the merge
+				if (!codepage.get() && !current->codepage.get())
+				{
+					shards.insert( shards.end(), current->shards.begin() + before->shards.size(), current->shards.end());
+					nofLayers += current->nofLayers - before->nofLayers;
 				}
 				else
 				{
-					m_errorhnd->report(
-						hyperscanErrorCode( err),
-						_TXT( "unknown errpr building automaton from expressions\n"));
+					//... the layers compiled meanwhile are compiled again into one layer with the code page of the merge,
+					//... on a copy of the table that keeps the definitions consistent with the snapshot published if this fails
+					m_patternTable.complete( m_nofShards);
+					PatternTable layerTable( m_patternTable);
+					layerTable.prepare( nofMerged, codepage.get());
+					std::vector<TermMatchShardReference> layer;
+					CompileResult layerResult;
+					if (!compileShards( layerTable, nofMerged, 1, layer, layerResult))
+					{
+						return false;
+					}
+					nofPrunedLayers = layerTable.nofPruned() - m_patternTable.nofPruned();
+					m_patternTable.adoptAnalysis( layerTable, nofMerged, layerTable.nofDefinitions(), m_patternTable.nofPruned());
+					shards.insert( shards.end(), layer.begin(), layer.end());
+					nofLayers += 1;
+					m_nofCompiled = m_patternTable.nofDefinitions();
 				}
-				return false;
 			}
-			m_state = MatchPhase;
+			m_patternTable.adoptAnalysis( *table.get(), 0, nofMerged, table->nofPruned() + nofPrunedLayers);
+			publish( shards, codepage, nofLayers);
+			m_loadedFromCache = result.loadedFromCache;
+			m_targetName = result.targetName;
+			m_compileTime = monotonicTime() - compileStart;
 			return true;
 		}
-		CATCH_ERROR_MAP_RETURN( _TXT("failed to compile regular expression patterns: %s"), *m_errorhnd, false);
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to merge the layers of the regular expression patterns: %s"), *m_errorhnd, false);
 	}
 
 	virtual PatternLexerContextInterface* createContext() const
 	{
 		try
 		{
-			if (m_state != MatchPhase)
+			if (!m_shared.data().get())
 			{
 				throw std::runtime_error( _TXT("called create context without calling 'compile'"));
 			}
-			return new PatternLexerContext( &m_data, m_errorhnd);
+			return new PatternLexerContext( &m_shared, m_errorhnd);
 		}
 		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match context: %s"), *m_errorhnd, 0);
 	}
 
+	virtual PatternLexerStreamContextInterface* createStreamContext() const
+	{
+		try
+		{
+			if (!m_shared.data().get())
+			{
+				throw std::runtime_error( _TXT("called create context without calling 'compile'"));
+			}
+			if (!m_withStream)
+			{
+				throw std::runtime_error( _TXT("called create stream context for a lexer not compiled with option 'STREAM'"));
+			}
+			return new PatternLexerStreamContext( &m_shared, m_errorhnd);
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match stream context: %s"), *m_errorhnd, 0);
+	}
+
+	virtual PatternMatchPipelineInterface* createMatchPipeline( const PatternMatcherInstanceInterface* matcher) const
+	{
+		try
+		{
+			if (!m_shared.data().get())
+			{
+				throw std::runtime_error( _TXT("called create match pipeline without calling 'compile'"));
+			}
+			PatternMatcherContextInterface* matcherContext = matcher->createContext();
+			if (!matcherContext)
+			{
+				throw std::runtime_error( _TXT("failed to create pattern matcher context"));
+			}
+			try
+			{
+				return new PatternMatchPipeline( &m_shared, matcherContext, m_errorhnd);
+			}
+			catch (...)
+			{
+				delete matcherContext;
+				throw;
+			}
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create pattern match pipeline: %s"), *m_errorhnd, 0);
+	}
+
+	virtual void defineCacheDirectory( const std::string& path)
+	{
+		try
+		{
+			strus::scoped_lock lock( m_mutex);
+			if (m_state != DefinitionPhase)
+			{
+				throw std::runtime_error( _TXT("called define cache directory after calling 'compile'"));
+			}
+			m_cache = LexerDatabaseCache( path);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define pattern lexer database cache directory: %s"), *m_errorhnd);
+	}
+
+	virtual void defineSymbolDictionary( unsigned int patternid, const std::string& path)
+	{
+		try
+		{
+			strus::scoped_lock lock( m_mutex);
+			if (m_state != DefinitionPhase)
+			{
+				throw std::runtime_error( _TXT("called define symbol dictionary after calling 'compile'"));
+			}
+			m_patternTable.defineSymbolDictionary( patternid, path, m_cache);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define regular expression pattern symbol dictionary: %s"), *m_errorhnd);
+	}
+
+	virtual void defineUsedTerms( const PatternMatcherInstanceInterface* matcher)
+	{
+		try
+		{
+			const PatternMatcherTermUsage* usage = dynamic_cast<const PatternMatcherTermUsage*>( matcher);
+			if (!usage)
+			{
+				throw std::runtime_error( _TXT("pattern matcher not implemented by this library"));
+			}
+			strus::scoped_lock lock( m_mutex);
+			m_patternTable.defineUsedTerms( usage->usedTermIds());
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define the terms used by a pattern matcher: %s"), *m_errorhnd);
+	}
+
+	virtual void defineAlwaysEmit( unsigned int id)
+	{
+		try
+		{
+			if (id == 0 || id > MaxPatternId)
+			{
+				throw strus::runtime_error(_TXT("pattern id out of range, The id must be a positive integer in the range 1..%u"), MaxPatternId);
+			}
+			strus::scoped_lock lock( m_mutex);
+			m_patternTable.defineAlwaysEmit( id);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to mark regular expression pattern as always emitted: %s"), *m_errorhnd);
+	}
+
 	virtual const char* name() const
 	{
 		return "std";
@@ -1137,24 +3616,257 @@ public:
 
 	virtual StructView view() const
 	{
-		return StructView()("name",name());
+		try
+		{
+			strus::scoped_lock lock( m_mutex);
+			TermMatchDataReference current( m_shared.data());
+			StructView rt;
+			rt( "name", name());
+			if (m_state == MatchPhase)
+			{
+				rt( "target", m_targetName);
+			}
+			if (m_cache.defined())
+			{
+				rt( "cached", m_loadedFromCache ? "loaded" : "stored");
+			}
+			if (m_nofThreads > 1)
+			{
+				rt( "threads", m_nofThreads);
+			}
+			if (m_profiling)
+			{
+				rt( "statistics", "profile");
+			}
+			if (m_patternTable.normalization())
+			{
+				rt( "normalize", (m_patternTable.normalization() & NormalizedCharMap::StripDiacritics) ? "nodiacritics" : "casefold");
+			}
+			if (m_state == MatchPhase)
+			{
+				rt( "fixedwidth", m_patternTable.nofFixedWidth());
+				if (m_patternTable.nofPruned())
+				{
+					rt( "pruned", (unsigned int)m_patternTable.nofPruned());
+				}
+				rt( "shards", (unsigned int)current->shards.size());
+				rt( "layers", current->nofLayers);
+				if (current->codepage.get())
+				{
+					rt( "codepage", (unsigned int)current->codepage->size());
+				}
+				rt( "compiletime", m_compileTime);
+			}
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("introspection failed: %s"), *m_errorhnd, StructView());
+	}
+
+private:
+	/// \brief Publish the snapshot of the lexer compiled, the contexts switch to it on their next match or reset
+	/// \param[in] shards databases of the shards of all layers
+	/// \param[in] codepage code page of the source mapped to a one byte character set
+	/// \param[in] nofLayers number of layers compiled
+	void publish( const std::vector<TermMatchShardReference>& shards, const Reference<OneByteCodePage>& codepage, unsigned int nofLayers)
+	{
+		TermMatchDataReference data( new TermMatchData( m_patternTable, shards, codepage, nofLayers, ++m_generation, m_nofThreads, m_profiling));
+		m_patternTable.markSymbolTablesShared();
+		m_symbolsDefined = false;
+		m_shared.publish( data);
+	}
+
+	/// \brief Get the flags the patterns are compiled with
+	/// \note Patterns matched on normalized sources are compiled as byte patterns, the case folding is done by the normalization
+	unsigned int compileFlags( const PatternTable& patternTable) const
+	{
+		return patternTable.normalization() ? (m_flags & ~(HS_FLAG_CASELESS|HS_FLAG_UCP)) : m_flags;
+	}
+
+	/// \brief Result of a compilation reported by 'view'
+	struct CompileResult
+	{
+		bool loadedFromCache;		///< true if the databases have been loaded from the cache
+		std::string targetName;		///< name of the platform variant selected for scanning
+
+		CompileResult()
+			:loadedFromCache(false),targetName(){}
+	};
+
+	/// \brief Compile the databases of the patterns prepared split into shards, loading them with the analysis of the patterns from the cache if defined
+	/// \param[in,out] patternTable table of the patterns prepared, the results of the analysis are stored in it
+	/// \param[in] startidx index of the first pattern definition compiled, 0 for all
+	/// \param[in] nofShards_ number of shards to split the patterns into, 0 or 1 for no split
+	/// \param[out] shards the databases compiled per shard
+	/// \param[out] result where the compilation got its databases from
+	/// \return true on success, false on a compile error reported
+	/// \note Does not use members changed after the first compilation, a merge calls it without holding the lock of the instance
+	bool compileShards( PatternTable& patternTable, std::size_t startidx, unsigned int nofShards_, std::vector<TermMatchShardReference>& shards, CompileResult& result) const
+	{
+		std::vector<hs_platform_info_t> platformar;
+		std::vector<const char*> targetnamear;
+		std::size_t selected = getCompileTargets( platformar, targetnamear);
+
+		// ... per target and shard the databases for block and stream mode of the exact patterns followed by the ones of the literal and of the approximate patterns:
+		std::size_t nofShards = nofShards_ > 1 ? nofShards_ : 1;
+		const std::size_t nofdb = TermMatchData::NofDatabases * nofShards;
+		DatabaseArray dbar( platformar.size() * nofdb);
+		result.loadedFromCache = false;
+		std::string signature;
+		if (m_cache.defined())
+		{
+			//... the signature is built from the definitions as they are, the analysis of the patterns is part of the cache entry
+			signature = databaseSignature( patternTable, startidx, platformar, nofShards);
+			std::string analysis;
+			result.loadedFromCache = m_cache.load( signature, analysis, dbar.ptr(), dbar.size());
+			if (result.loadedFromCache && !patternTable.deserializeAnalysis( analysis, startidx))
+			{
+				//... entry not fitting to the definitions, the databases loaded are freed before compiling them again
+				dbar.clear();
+				result.loadedFromCache = false;
+			}
+		}
+		if (!result.loadedFromCache)
+		{
+			HsPatternTable hspt_exact;
+			HsPatternTable hspt_literal;
+			HsPatternTable hspt_approx;
+			patternTable.analyse( compileFlags( patternTable), startidx);
+			patternTable.buildTables( hspt_exact, hspt_literal, hspt_approx, compileFlags( patternTable), startidx);
+
+			//... variants not selected for this host are only compiled to be stored in the cache
+			const HsPatternTable* tablear[3] = {&hspt_exact, &hspt_literal, &hspt_approx};
+			std::vector<Reference<PatternShardCompiler> > compilers;
+			std::size_t si = 0;
+			for (; si != nofShards; ++si)
+			{
+				compilers.push_back( Reference<PatternShardCompiler>( new PatternShardCompiler(
+							tablear, si, nofShards, platformar, selected, m_cache.defined()/*all targets*/, m_withStream, dbar.ptr())));
+			}
+			runParallel( compilers, nofShards);
+			for (si = 0; si != nofShards; ++si)
+			{
+				if (!compilers[ si]->error().empty())
+				{
+					m_errorhnd->report( hyperscanErrorCode( compilers[ si]->errcode()), "%s", compilers[ si]->error().c_str());
+					return false;
+				}
+			}
+			if (m_cache.defined())
+			{
+				std::string analysis;
+				patternTable.serializeAnalysis( analysis, startidx);
+				m_cache.store( signature, analysis, dbar.ptr(), dbar.size());
+			}
+		}
+		shards.clear();
+		for (std::size_t si = 0; si != nofShards; ++si)
+		{
+			std::size_t dbidx = selected*nofdb + si*TermMatchData::NofDatabases;
+			TermMatchShardReference shard( new TermMatchShard());
+			shard->patterndb = dbar.release( dbidx + PatternShardCompiler::ExactBlock);
+			shard->streamdb = dbar.release( dbidx + PatternShardCompiler::ExactStream);
+			shard->literaldb = dbar.release( dbidx + PatternShardCompiler::LiteralBlock);
+			shard->literalstreamdb = dbar.release( dbidx + PatternShardCompiler::LiteralStream);
+			shard->approxdb = dbar.release( dbidx + PatternShardCompiler::ApproxBlock);
+			shard->approxstreamdb = dbar.release( dbidx + PatternShardCompiler::ApproxStream);
+			shards.push_back( shard);
+		}
+		result.targetName = targetnamear[ selected];
+		return true;
+	}
+
+	/// \brief Get the platforms to compile the databases for
+	/// \return the index of the platform selected for scanning on this host
+	std::size_t getCompileTargets( std::vector<hs_platform_info_t>& platformar, std::vector<const char*>& namear) const
+	{
+		hs_platform_info_t platform;
+		std::memset( &platform, 0, sizeof(platform));
+		if (m_target == TargetGeneric)
+		{
+			platform.tune = HS_TUNE_FAMILY_GENERIC;
+			platformar.push_back( platform);
+			namear.push_back( "generic");
+			return 0;
+		}
+		hs_platform_info_t host;
+		std::memset( &host, 0, sizeof(host));
+		hs_error_t err = hs_populate_platform( &host);
+		if (err != HS_SUCCESS)
+		{
+			throw strus::runtime_error(_TXT("failed to determine platform of host: %s"), hsErrorName( err));
+		}
+		if (m_target == TargetHost)
+		{
+			platformar.push_back( host);
+			namear.push_back( "host");
+			return 0;
+		}
+		std::size_t rt = 0;
+		std::size_t ti = 0;
+		for (; g_compileTargets[ ti].name; ++ti)
+		{
+			platform.tune = g_compileTargets[ ti].tune;
+			platform.cpu_features = g_compileTargets[ ti].cpu_features;
+			platformar.push_back( platform);
+			namear.push_back( g_compileTargets[ ti].name);
+			if ((platform.cpu_features & ~host.cpu_features) == 0)
+			{
+				rt = ti;
+			}
+		}
+		return rt;
+	}
+
+	/// \brief Get the key identifying the databases to compile in the cache
+	/// \param[in] startidx index of the first pattern definition compiled, 0 for all
+	std::string databaseSignature( const PatternTable& patternTable, std::size_t startidx, const std::vector<hs_platform_info_t>& platformar, std::size_t nofShards) const
+	{
+		std::string rt;
+		Serializer::packString( rt, hs_version());
+		Serializer::packUint32( rt, platformar.size());
+		std::vector<hs_platform_info_t>::const_iterator pi = platformar.begin(), pe = platformar.end();
+		for (; pi != pe; ++pi)
+		{
+			Serializer::packUint32( rt, pi->tune);
+			Serializer::packUint64( rt, pi->cpu_features);
+		}
+		Serializer::packUint32( rt, m_withStream ? 1:0);
+		Serializer::packUint32( rt, nofShards);
+		patternTable.serializeDefinitions( rt, compileFlags( patternTable), startidx);
+		return rt;
 	}
 
 private:
 	ErrorBufferInterface* m_errorhnd;
-	TermMatchData m_data;
+	mutable strus::mutex m_mutex;			///< mutex serializing the definitions, compilations and the publication of a merge, the contexts do not use it
+	strus::mutex m_mergeMutex;			///< mutex serializing the merges, held during the whole merge, locked before m_mutex
+	PatternTable m_patternTable;			///< pattern definitions, copied into the snapshot published by every compilation
+	TermMatchShared m_shared;			///< snapshot published last and the scratch spaces, shared with the contexts
+	unsigned int m_nofThreads;			///< maximum number of threads scanning a document in parallel, 0 or 1 for sequential scanning
+	unsigned int m_nofShards;			///< number of shards the patterns are split into for compiling them in parallel, 0 or 1 for no split
+	bool m_profiling;				///< true if the contexts measure the phases of the lexer for the statistics
+	unsigned int m_generation;			///< number of snapshots published
+	bool m_symbolsDefined;				///< true if symbols have been defined since the last snapshot published
 	enum State {DefinitionPhase,MatchPhase};
 	State m_state;
 	unsigned int m_flags;
+	bool m_withStream;
 	std::map<unsigned int,std::size_t> m_idnamemap;
 	std::string m_idnamestrings;
+	LexerDatabaseCache m_cache;
+	bool m_loadedFromCache;
+	enum Target {TargetGeneric,TargetHost,TargetMulti};
+	Target m_target;				///< platforms to compile the databases for
+	std::string m_targetName;			///< name of the platform variant selected for scanning
+	double m_compileTime;				///< wall time of the last compilation in seconds
+	std::size_t m_nofCompiled;			///< number of patterns compiled into the layers of databases, the ones defined after are compiled into the next layer
 };
 
 
 std::vector<std::string> PatternLexer::getCompileOptionNames() const
 {
 	std::vector<std::string> rt;
-	static const char* ar[] = {"CASELESS", "DOTALL", "MULTILINE", "ALLOWEMPTY", "UCP", 0};
+	static const char* ar[] = {"CASELESS", "DOTALL", "MULTILINE", "ALLOWEMPTY", "UCP", "NORMALIZE", "NODIACRITICS", "STREAM", "STATISTICS", "HOSTTUNED", "MULTITARGET", "THREADS", "SHARDS", 0};
 	for (std::size_t ai=0; ar[ai]; ++ai)
 	{
 		rt.push_back( ar[ ai]);
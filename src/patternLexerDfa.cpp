@@ -0,0 +1,1357 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Implementation of detecting tokens defined as regular expressions on text with a table driven DFA built without external libraries
+/// \file "patternLexerDfa.cpp"
+#include "patternLexerDfa.hpp"
+#include "matchEventList.hpp"
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/analyzer/positionBind.hpp"
+#include "strus/patternLexerInstanceInterface.hpp"
+#include "strus/patternLexerContextInterface.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "strus/base/stdint.h"
+#include "strus/base/string_conv.hpp"
+#include "errorUtils.hpp"
+#include "internationalization.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <bitset>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace strus;
+using namespace strus::analyzer;
+
+enum {MaxPatternId=(1 << 30)-1};
+/// \brief Maximum bound of a counted repetition {m,n}, the repetitions are unfolded in the automaton
+enum {MaxRepeat=255};
+/// \brief Maximum number of states of the nondeterministic automaton the DFA is built from
+enum {MaxNfaStates=(1 << 20)};
+/// \brief Default for the maximum number of states of the DFA, the transition table has (number of states * number of byte classes) elements of 2 bytes
+enum {DefaultMaxStates=4096};
+
+typedef std::bitset<256> ByteSet;
+
+static ByteSet byteRange( unsigned int from, unsigned int to)
+{
+	ByteSet rt;
+	for (; from <= to; ++from) rt.set( from);
+	return rt;
+}
+
+static bool isAsciiAlpha( unsigned int ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+static bool isAsciiDigit( unsigned int ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+/// \brief Add the other case of the ASCII letters in a set
+static void foldCase( ByteSet& set)
+{
+	unsigned int ch = 'a';
+	for (; ch <= 'z'; ++ch)
+	{
+		if (set.test( ch) || set.test( ch - 'a' + 'A'))
+		{
+			set.set( ch);
+			set.set( ch - 'a' + 'A');
+		}
+	}
+}
+
+/// \brief Node of the syntax tree of a regular expression
+struct RegexNode
+{
+	enum Type {Empty,Set,Sequence,Alternative,Repeat};
+	enum {Unbounded=0xFFFFffffU};
+
+	Type type;
+	ByteSet set;				///< bytes matched (Set)
+	std::vector<unsigned int> args;		///< indices of the argument nodes (Sequence, Alternative, Repeat)
+	unsigned int min;			///< minimum number of repetitions (Repeat)
+	unsigned int max;			///< maximum number of repetitions or Unbounded (Repeat)
+
+	explicit RegexNode( Type type_)
+		:type(type_),set(),args(),min(0),max(0){}
+	RegexNode( const RegexNode& o)
+		:type(o.type),set(o.set),args(o.args),min(o.min),max(o.max){}
+};
+
+/// \brief Evaluate if a node of a syntax tree matches the empty string
+static bool isNullable( const std::vector<RegexNode>& nodear, unsigned int nodeidx)
+{
+	const RegexNode& node = nodear[ nodeidx];
+	std::vector<unsigned int>::const_iterator ai = node.args.begin(), ae = node.args.end();
+	switch (node.type)
+	{
+		case RegexNode::Empty:
+			return true;
+		case RegexNode::Set:
+			return false;
+		case RegexNode::Sequence:
+			for (; ai != ae; ++ai) if (!isNullable( nodear, *ai)) return false;
+			return true;
+		case RegexNode::Alternative:
+			for (; ai != ae; ++ai) if (isNullable( nodear, *ai)) return true;
+			return false;
+		case RegexNode::Repeat:
+			return node.min == 0 || isNullable( nodear, node.args[0]);
+	}
+	return false;
+}
+
+/// \brief Parser of the supported subset of the regular expression syntax into syntax trees
+/// \note The expressions are matched on UTF-8 bytes. The classes \\d \\w \\s and case folding are ASCII only, '.' and negated classes match any ASCII character or UTF-8 multibyte sequence
+class RegexParser
+{
+public:
+	RegexParser( std::vector<RegexNode>& nodear_, bool caseless_, bool dotall_)
+		:m_nodear(nodear_),m_caseless(caseless_),m_dotall(dotall_),m_start(0),m_itr(0),m_end(0){}
+
+	/// \brief Parse an expression
+	/// \return the index of the root node of its syntax tree
+	/// \remark Throws on error
+	unsigned int parse( const std::string& expression)
+	{
+		m_start = m_itr = expression.c_str();
+		m_end = m_start + expression.size();
+		unsigned int rt = parseAlternative();
+		if (m_itr != m_end)
+		{
+			throw strus::runtime_error(_TXT("unbalanced parentheses at position %u"), position());
+		}
+		return rt;
+	}
+
+private:
+	unsigned int position() const
+	{
+		return (unsigned int)(m_itr - m_start);
+	}
+
+	unsigned int newNode( const RegexNode& node)
+	{
+		m_nodear.push_back( node);
+		return m_nodear.size()-1;
+	}
+
+	unsigned int newSet( const ByteSet& set)
+	{
+		RegexNode node( RegexNode::Set);
+		node.set = set;
+		if (m_caseless) foldCase( node.set);
+		return newNode( node);
+	}
+
+	unsigned int newList( RegexNode::Type type, const std::vector<unsigned int>& args)
+	{
+		if (args.size() == 1) return args[0];
+		RegexNode node( args.empty() ? RegexNode::Empty : type);
+		node.args = args;
+		return newNode( node);
+	}
+
+	unsigned int newAlternative( unsigned int arg1, unsigned int arg2)
+	{
+		std::vector<unsigned int> args;
+		args.push_back( arg1);
+		args.push_back( arg2);
+		return newList( RegexNode::Alternative, args);
+	}
+
+	unsigned int newRepeat( unsigned int arg, unsigned int min, unsigned int max)
+	{
+		RegexNode node( RegexNode::Repeat);
+		node.args.push_back( arg);
+		node.min = min;
+		node.max = max;
+		return newNode( node);
+	}
+
+	/// \brief Create the nodes matching a sequence of bytes
+	unsigned int newLiteral( const std::string& bytes)
+	{
+		std::vector<unsigned int> args;
+		std::string::const_iterator bi = bytes.begin(), be = bytes.end();
+		for (; bi != be; ++bi)
+		{
+			ByteSet set;
+			set.set( (unsigned char)*bi);
+			args.push_back( newSet( set));
+		}
+		return newList( RegexNode::Sequence, args);
+	}
+
+	/// \brief Create the nodes matching any UTF-8 multibyte character
+	unsigned int newAnyMultibyteChar()
+	{
+		ByteSet follow = byteRange( 0x80, 0xBF);
+		std::vector<unsigned int> alt;
+		static const unsigned int leadar[3][2] = {{0xC2,0xDF},{0xE0,0xEF},{0xF0,0xF4}};
+		unsigned int li = 0;
+		for (; li < 3; ++li)
+		{
+			std::vector<unsigned int> seq;
+			seq.push_back( newSet( byteRange( leadar[li][0], leadar[li][1])));
+			unsigned int fi = 0;
+			for (; fi <= li; ++fi) seq.push_back( newSet( follow));
+			alt.push_back( newList( RegexNode::Sequence, seq));
+		}
+		return newList( RegexNode::Alternative, alt);
+	}
+
+	/// \brief Create the nodes matching any character of a negated set
+	/// \param[in] excluded the ASCII characters excluded
+	unsigned int newNegatedSet( ByteSet excluded)
+	{
+		if (m_caseless) foldCase( excluded);
+		return newAlternative( newSet( ~excluded & byteRange( 0x00, 0x7F)), newAnyMultibyteChar());
+	}
+
+	unsigned int parseAlternative()
+	{
+		std::vector<unsigned int> args;
+		args.push_back( parseSequence());
+		while (m_itr != m_end && *m_itr == '|')
+		{
+			++m_itr;
+			args.push_back( parseSequence());
+		}
+		return newList( RegexNode::Alternative, args);
+	}
+
+	unsigned int parseSequence()
+	{
+		std::vector<unsigned int> args;
+		while (m_itr != m_end && *m_itr != '|' && *m_itr != ')')
+		{
+			args.push_back( parseQuantified());
+		}
+		return newList( RegexNode::Sequence, args);
+	}
+
+	unsigned int parseQuantified()
+	{
+		unsigned int rt = parseAtom();
+		if (m_itr == m_end) return rt;
+		unsigned int min = 0;
+		unsigned int max = 0;
+		switch (*m_itr)
+		{
+			case '*': min = 0; max = RegexNode::Unbounded; ++m_itr; break;
+			case '+': min = 1; max = RegexNode::Unbounded; ++m_itr; break;
+			case '?': min = 0; max = 1; ++m_itr; break;
+			case '{': if (!parseBounds( min, max)) return rt; break;
+			default: return rt;
+		}
+		if (m_itr != m_end)
+		{
+			if (*m_itr == '?')
+			{
+				//... lazy and greedy quantifiers are the same for a lexer reporting the longest match
+				++m_itr;
+			}
+			else if (*m_itr == '+')
+			{
+				throw strus::runtime_error(_TXT("possessive quantifiers are not supported (position %u)"), position());
+			}
+			else if (*m_itr == '*' || *m_itr == '{')
+			{
+				throw strus::runtime_error(_TXT("nothing to repeat at position %u"), position());
+			}
+		}
+		return newRepeat( rt, min, max);
+	}
+
+	/// \brief Parse a counted repetition {m}, {m,} or {m,n}
+	/// \return false if the '{' does not start a counted repetition and is a literal
+	bool parseBounds( unsigned int& min, unsigned int& max)
+	{
+		char const* si = m_itr+1;
+		if (si == m_end || !isAsciiDigit( *si)) return false;
+		min = parseNumber( si);
+		max = min;
+		if (si != m_end && *si == ',')
+		{
+			++si;
+			max = (si != m_end && isAsciiDigit( *si)) ? parseNumber( si) : (unsigned int)RegexNode::Unbounded;
+		}
+		if (si == m_end || *si != '}') return false;
+		if (min > (unsigned int)MaxRepeat || (max != (unsigned int)RegexNode::Unbounded && max > (unsigned int)MaxRepeat))
+		{
+			throw strus::runtime_error(_TXT("bound of repetition out of range, maximum %u allowed (position %u)"), (unsigned int)MaxRepeat, position());
+		}
+		if (max < min)
+		{
+			throw strus::runtime_error(_TXT("invalid bounds of repetition at position %u"), position());
+		}
+		m_itr = si+1;
+		return true;
+	}
+
+	unsigned int parseNumber( char const*& si)
+	{
+		unsigned int rt = 0;
+		for (; si != m_end && isAsciiDigit( *si); ++si)
+		{
+			rt = rt * 10 + (*si - '0');
+			if (rt > 0xFFFF) rt = 0xFFFF;
+		}
+		return rt;
+	}
+
+	unsigned int parseAtom()
+	{
+		unsigned char ch = *m_itr;
+		switch (ch)
+		{
+			case '(':
+			{
+				++m_itr;
+				if (m_itr != m_end && *m_itr == '?')
+				{
+					if (m_itr+1 == m_end || m_itr[1] != ':')
+					{
+						throw strus::runtime_error(_TXT("lookarounds and group options are not supported (position %u)"), position());
+					}
+					m_itr += 2;
+				}
+				unsigned int rt = parseAlternative();
+				if (m_itr == m_end || *m_itr != ')')
+				{
+					throw strus::runtime_error(_TXT("missing ')' at position %u"), position());
+				}
+				++m_itr;
+				return rt;
+			}
+			case '[':
+				++m_itr;
+				return parseClass();
+			case '.':
+			{
+				++m_itr;
+				ByteSet excluded;
+				if (!m_dotall) excluded.set( '\n');
+				return newNegatedSet( excluded);
+			}
+			case '^':
+			case '$':
+				throw strus::runtime_error(_TXT("anchors are not supported (position %u)"), position());
+			case '*':
+			case '+':
+			case '?':
+				throw strus::runtime_error(_TXT("nothing to repeat at position %u"), position());
+			case '\\':
+			{
+				++m_itr;
+				if (m_itr == m_end)
+				{
+					throw std::runtime_error(_TXT("escape at the end of the expression"));
+				}
+				unsigned char ech = *m_itr++;
+				ByteSet set;
+				if (parseClassEscape( ech, set))
+				{
+					return isAsciiAlpha( ech) && ech < 'a' ? newNegatedSet( set) : newSet( set);
+				}
+				set.set( parseCharEscape( ech));
+				return newSet( set);
+			}
+			default:
+			{
+				if (ch >= 0x80)
+				{
+					return newLiteral( parseMultibyteChar());
+				}
+				++m_itr;
+				ByteSet set;
+				set.set( ch);
+				return newSet( set);
+			}
+		}
+	}
+
+	/// \brief Parse the class escapes \\d \\w \\s and their negations \\D \\W \\S
+	/// \param[out] set the ASCII characters of the class not negated
+	/// \return false if the escape is not a class escape
+	static bool parseClassEscape( unsigned char ech, ByteSet& set)
+	{
+		switch (ech)
+		{
+			case 'd': case 'D':
+				set |= byteRange( '0', '9');
+				return true;
+			case 'w': case 'W':
+				set |= byteRange( '0', '9') | byteRange( 'a', 'z') | byteRange( 'A', 'Z');
+				set.set( '_');
+				return true;
+			case 's': case 'S':
+				set.set( ' '); set.set( '\t'); set.set( '\n'); set.set( '\v'); set.set( '\f'); set.set( '\r');
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/// \brief Parse an escape of a single byte, the escape character already consumed
+	unsigned char parseCharEscape( unsigned char ech)
+	{
+		switch (ech)
+		{
+			case 'n': return '\n';
+			case 't': return '\t';
+			case 'r': return '\r';
+			case 'f': return '\f';
+			case 'v': return '\v';
+			case 'e': return 0x1B;
+			case 'x':
+			{
+				unsigned int rt = 0;
+				unsigned int di = 0;
+				for (; di < 2 && m_itr != m_end && std::isxdigit( (unsigned char)*m_itr); ++di,++m_itr)
+				{
+					unsigned char hx = *m_itr;
+					rt = rt * 16 + (isAsciiDigit( hx) ? (hx - '0') : ((hx | 0x20) - 'a' + 10));
+				}
+				if (di == 0)
+				{
+					throw strus::runtime_error(_TXT("invalid hexadecimal escape at position %u"), position());
+				}
+				return (unsigned char)rt;
+			}
+			default:
+				if (ech < 0x80 && (isAsciiAlpha( ech) || isAsciiDigit( ech)))
+				{
+					throw strus::runtime_error(_TXT("escape '\\%c' is not supported (position %u)"), (char)ech, position());
+				}
+				return ech;
+		}
+	}
+
+	/// \brief Parse the bytes of a UTF-8 multibyte character
+	std::string parseMultibyteChar()
+	{
+		unsigned char lead = *m_itr;
+		std::size_t len = (lead >= 0xF0 && lead <= 0xF4) ? 4 : (lead >= 0xE0 && lead <= 0xEF) ? 3 : (lead >= 0xC2 && lead <= 0xDF) ? 2 : 0;
+		if (!len || (std::size_t)(m_end - m_itr) < len)
+		{
+			throw strus::runtime_error(_TXT("invalid UTF-8 character at position %u"), position());
+		}
+		std::string rt( m_itr, len);
+		std::size_t ci = 1;
+		for (; ci < len; ++ci)
+		{
+			if (((unsigned char)rt[ ci] & 0xC0) != 0x80)
+			{
+				throw strus::runtime_error(_TXT("invalid UTF-8 character at position %u"), position());
+			}
+		}
+		m_itr += len;
+		return rt;
+	}
+
+	bool atRange() const
+	{
+		return m_itr != m_end && *m_itr == '-' && m_itr+1 != m_end && m_itr[1] != ']';
+	}
+
+	/// \brief Parse a character class, the '[' already consumed
+	unsigned int parseClass()
+	{
+		bool negated = false;
+		if (m_itr != m_end && *m_itr == '^')
+		{
+			negated = true;
+			++m_itr;
+		}
+		ByteSet set;
+		std::vector<unsigned int> alt;
+		bool withAnyMultibyte = false;
+		bool first = true;
+		for (;;)
+		{
+			if (m_itr == m_end)
+			{
+				throw std::runtime_error(_TXT("missing ']' at the end of the expression"));
+			}
+			unsigned char ch = *m_itr;
+			if (ch == ']' && !first)
+			{
+				++m_itr;
+				break;
+			}
+			first = false;
+			if (ch == '[' && m_itr+1 != m_end && m_itr[1] == ':')
+			{
+				throw strus::runtime_error(_TXT("POSIX character classes are not supported (position %u)"), position());
+			}
+			if (ch >= 0x80)
+			{
+				if (negated)
+				{
+					throw strus::runtime_error(_TXT("non ASCII characters in negated classes are not supported (position %u)"), position());
+				}
+				alt.push_back( newLiteral( parseMultibyteChar()));
+				if (atRange())
+				{
+					throw strus::runtime_error(_TXT("ranges of non ASCII characters are not supported (position %u)"), position());
+				}
+				continue;
+			}
+			++m_itr;
+			if (ch == '\\')
+			{
+				if (m_itr == m_end)
+				{
+					throw std::runtime_error(_TXT("escape at the end of the expression"));
+				}
+				unsigned char ech = *m_itr++;
+				ByteSet eset;
+				if (parseClassEscape( ech, eset))
+				{
+					if (ech < 'a')
+					{
+						if (negated)
+						{
+							throw strus::runtime_error(_TXT("negated class escapes in negated classes are not supported (position %u)"), position());
+						}
+						set |= ~eset & byteRange( 0x00, 0x7F);
+						withAnyMultibyte = true;
+					}
+					else
+					{
+						set |= eset;
+					}
+					continue;
+				}
+				ch = parseCharEscape( ech);
+			}
+			if (atRange())
+			{
+				++m_itr;
+				unsigned char hi = *m_itr++;
+				if (hi == '\\')
+				{
+					if (m_itr == m_end)
+					{
+						throw std::runtime_error(_TXT("escape at the end of the expression"));
+					}
+					hi = parseCharEscape( *m_itr++);
+				}
+				else if (hi >= 0x80)
+				{
+					throw strus::runtime_error(_TXT("ranges of non ASCII characters are not supported (position %u)"), position());
+				}
+				if (hi < ch)
+				{
+					throw strus::runtime_error(_TXT("invalid range in character class at position %u"), position());
+				}
+				set |= byteRange( ch, hi);
+			}
+			else
+			{
+				set.set( ch);
+			}
+		}
+		if (negated)
+		{
+			return newNegatedSet( set);
+		}
+		if (set.any()) alt.push_back( newSet( set));
+		if (withAnyMultibyte) alt.push_back( newAnyMultibyteChar());
+		return newList( RegexNode::Alternative, alt);
+	}
+
+private:
+	std::vector<RegexNode>& m_nodear;
+	bool m_caseless;
+	bool m_dotall;
+	char const* m_start;
+	char const* m_itr;
+	char const* m_end;
+};
+
+/// \brief Transition of a state of a nondeterministic automaton on a set of bytes
+struct NfaEdge
+{
+	ByteSet set;
+	uint32_t target;
+
+	NfaEdge( const ByteSet& set_, uint32_t target_)
+		:set(set_),target(target_){}
+	NfaEdge( const NfaEdge& o)
+		:set(o.set),target(o.target){}
+};
+
+/// \brief State of a nondeterministic automaton
+struct NfaState
+{
+	std::vector<uint32_t> eps;		///< targets of the transitions without input
+	std::vector<NfaEdge> edges;		///< transitions on input bytes
+	int accept;				///< index of the pattern accepted in this state or -1
+
+	NfaState()
+		:eps(),edges(),accept(-1){}
+	NfaState( const NfaState& o)
+		:eps(o.eps),edges(o.edges),accept(o.accept){}
+};
+
+/// \brief Construction of a nondeterministic automaton for a set of patterns with the start state 0
+class NfaBuilder
+{
+public:
+	explicit NfaBuilder( const std::vector<RegexNode>& nodear_)
+		:m_nodear(nodear_),m_statear()
+	{
+		m_statear.push_back( NfaState());
+	}
+
+	void addPattern( unsigned int rootidx, unsigned int patternidx)
+	{
+		uint32_t start = newState();
+		m_statear[ 0].eps.push_back( start);
+		uint32_t end = build( rootidx, start);
+		m_statear[ end].accept = patternidx;
+	}
+
+	const std::vector<NfaState>& states() const
+	{
+		return m_statear;
+	}
+
+private:
+	uint32_t newState()
+	{
+		if (m_statear.size() >= (std::size_t)MaxNfaStates)
+		{
+			throw strus::runtime_error(_TXT("too many states of the automaton, maximum %u allowed"), (unsigned int)MaxNfaStates);
+		}
+		m_statear.push_back( NfaState());
+		return m_statear.size()-1;
+	}
+
+	/// \brief Build the transitions of a node of a syntax tree starting from a state
+	/// \return the state reached after a match of the node
+	uint32_t build( unsigned int nodeidx, uint32_t from)
+	{
+		const RegexNode& node = m_nodear[ nodeidx];
+		std::vector<unsigned int>::const_iterator ai = node.args.begin(), ae = node.args.end();
+		switch (node.type)
+		{
+			case RegexNode::Empty:
+				return from;
+			case RegexNode::Set:
+			{
+				uint32_t to = newState();
+				m_statear[ from].edges.push_back( NfaEdge( node.set, to));
+				return to;
+			}
+			case RegexNode::Sequence:
+			{
+				uint32_t cur = from;
+				for (; ai != ae; ++ai) cur = build( *ai, cur);
+				return cur;
+			}
+			case RegexNode::Alternative:
+			{
+				uint32_t to = newState();
+				for (; ai != ae; ++ai)
+				{
+					uint32_t start = newState();
+					m_statear[ from].eps.push_back( start);
+					uint32_t end = build( *ai, start);
+					m_statear[ end].eps.push_back( to);
+				}
+				return to;
+			}
+			case RegexNode::Repeat:
+			{
+				uint32_t cur = from;
+				unsigned int ri = 0;
+				for (; ri < node.min; ++ri) cur = build( node.args[0], cur);
+				if (node.max == (unsigned int)RegexNode::Unbounded)
+				{
+					//... the loop state is a new one, so that the transitions added to it later are only taken after the repetition
+					uint32_t loop = newState();
+					m_statear[ cur].eps.push_back( loop);
+					uint32_t end = build( node.args[0], loop);
+					m_statear[ end].eps.push_back( loop);
+					return loop;
+				}
+				for (; ri < node.max; ++ri)
+				{
+					uint32_t to = newState();
+					m_statear[ cur].eps.push_back( to);
+					uint32_t end = build( node.args[0], cur);
+					m_statear[ end].eps.push_back( to);
+					cur = to;
+				}
+				return cur;
+			}
+		}
+		return from;
+	}
+
+private:
+	const std::vector<RegexNode>& m_nodear;
+	std::vector<NfaState> m_statear;
+};
+
+/// \brief Deterministic automaton on bytes with a transition table over classes of bytes that are not distinguished by any pattern
+class TokenDfa
+{
+public:
+	enum {DeadState=0,StartState=1};
+	enum {MaxStates=0xFFFF};
+
+	TokenDfa()
+		:m_nofClasses(1),m_table(),m_acceptidx(),m_acceptar()
+	{
+		std::memset( m_classmap, 0, sizeof(m_classmap));
+	}
+	TokenDfa( const TokenDfa& o)
+		:m_nofClasses(o.m_nofClasses),m_table(o.m_table),m_acceptidx(o.m_acceptidx),m_acceptar(o.m_acceptar)
+	{
+		std::memcpy( m_classmap, o.m_classmap, sizeof(m_classmap));
+	}
+
+	/// \brief Build the automaton from a nondeterministic one by subset construction
+	/// \param[in] maxStates maximum number of states allowed
+	/// \remark Throws on error
+	void build( const std::vector<NfaState>& nfa, unsigned int maxStates);
+
+	/// \brief Get the follow state of a state on an input byte
+	uint32_t next( uint32_t state, unsigned char ch) const
+	{
+		return m_table[ state * m_nofClasses + m_classmap[ ch]];
+	}
+
+	/// \brief Get the start of the indices of the patterns accepted in a state in the array of accepted patterns
+	uint32_t acceptStart( uint32_t state) const	{return m_acceptidx[ state];}
+	/// \brief Get the end of the indices of the patterns accepted in a state in the array of accepted patterns
+	uint32_t acceptEnd( uint32_t state) const	{return m_acceptidx[ state+1];}
+	/// \brief Get an element of the array of accepted patterns
+	uint32_t acceptPattern( uint32_t idx) const	{return m_acceptar[ idx];}
+
+	unsigned int nofStates() const			{return m_acceptidx.empty() ? 0 : (m_acceptidx.size()-1);}
+	unsigned int nofClasses() const			{return m_nofClasses;}
+	/// \brief Size of the transition table in bytes
+	std::size_t tableSize() const			{return m_table.size() * sizeof(m_table[0]);}
+
+private:
+	void refineClasses( const ByteSet& set, unsigned int* classSize);
+	static void closure( const std::vector<NfaState>& nfa, std::vector<uint32_t>& stateset, std::vector<uint32_t>& visited, uint32_t visitid);
+
+private:
+	unsigned char m_classmap[ 256];			///< map byte -> class of bytes
+	unsigned int m_nofClasses;			///< number of classes of bytes
+	std::vector<uint16_t> m_table;			///< transition table, row per state, column per class of bytes
+	std::vector<uint32_t> m_acceptidx;		///< map state -> start index in m_acceptar, with an additional element for the end
+	std::vector<uint32_t> m_acceptar;		///< indices of the patterns accepted per state, ascending
+};
+
+/// \brief Split the classes of bytes so that each class is either contained in a set or disjoint to it
+void TokenDfa::refineClasses( const ByteSet& set, unsigned int* classSize)
+{
+	unsigned int inside[ 256];
+	int remap[ 256];
+	std::memset( inside, 0, sizeof(inside));
+	unsigned int bi = 0;
+	for (; bi < 256; ++bi)
+	{
+		if (set.test( bi)) ++inside[ m_classmap[ bi]];
+	}
+	unsigned int ci = 0, nofOldClasses = m_nofClasses;
+	for (; ci < nofOldClasses; ++ci) remap[ ci] = -1;
+	for (bi = 0; bi < 256; ++bi)
+	{
+		if (!set.test( bi)) continue;
+		unsigned int cl = m_classmap[ bi];
+		if (inside[ cl] < classSize[ cl])
+		{
+			if (remap[ cl] < 0) remap[ cl] = m_nofClasses++;
+			m_classmap[ bi] = (unsigned char)remap[ cl];
+		}
+	}
+	for (ci = 0; ci < nofOldClasses; ++ci)
+	{
+		if (remap[ ci] >= 0)
+		{
+			classSize[ remap[ ci]] = inside[ ci];
+			classSize[ ci] -= inside[ ci];
+		}
+	}
+}
+
+/// \brief Complete a set of states with the states reachable without input, keeping only the ones relevant for the follow states and the acceptance
+void TokenDfa::closure( const std::vector<NfaState>& nfa, std::vector<uint32_t>& stateset, std::vector<uint32_t>& visited, uint32_t visitid)
+{
+	std::vector<uint32_t> stk( stateset);
+	stateset.clear();
+	while (!stk.empty())
+	{
+		uint32_t st = stk.back();
+		stk.pop_back();
+		if (visited[ st] == visitid) continue;
+		visited[ st] = visitid;
+		const NfaState& state = nfa[ st];
+		if (!state.edges.empty() || state.accept >= 0) stateset.push_back( st);
+		std::vector<uint32_t>::const_iterator ei = state.eps.begin(), ee = state.eps.end();
+		for (; ei != ee; ++ei)
+		{
+			if (visited[ *ei] != visitid) stk.push_back( *ei);
+		}
+	}
+	std::sort( stateset.begin(), stateset.end());
+}
+
+void TokenDfa::build( const std::vector<NfaState>& nfa, unsigned int maxStates)
+{
+	if (maxStates > (unsigned int)MaxStates) maxStates = MaxStates;
+	m_table.clear();
+	m_acceptidx.clear();
+	m_acceptar.clear();
+
+	// Build the classes of bytes and a representative byte for each class:
+	std::memset( m_classmap, 0, sizeof(m_classmap));
+	m_nofClasses = 1;
+	unsigned int classSize[ 256];
+	classSize[ 0] = 256;
+	std::vector<NfaState>::const_iterator ni = nfa.begin(), ne = nfa.end();
+	for (; ni != ne; ++ni)
+	{
+		std::vector<NfaEdge>::const_iterator ei = ni->edges.begin(), ee = ni->edges.end();
+		for (; ei != ee; ++ei) refineClasses( ei->set, classSize);
+	}
+	unsigned char representative[ 256];
+	unsigned int bi = 256;
+	while (bi-- > 0) representative[ m_classmap[ bi]] = (unsigned char)bi;
+
+	// Subset construction with the dead state 0 (empty set) and the start state 1:
+	typedef std::vector<uint32_t> StateSet;
+	typedef std::map<StateSet,uint32_t> StateSetMap;
+	StateSetMap statemap;
+	std::vector<StateSet> statear;
+	std::vector<uint32_t> visited( nfa.size(), 0);
+	uint32_t visitid = 0;
+
+	statear.push_back( StateSet());
+	statemap[ StateSet()] = DeadState;
+	StateSet start;
+	start.push_back( 0);
+	closure( nfa, start, visited, ++visitid);
+	statemap[ start] = StartState;
+	statear.push_back( start);
+
+	std::size_t si = 0;
+	for (; si < statear.size(); ++si)
+	{
+		StateSet cur = statear[ si];
+		unsigned int ci = 0;
+		for (; ci < m_nofClasses; ++ci)
+		{
+			StateSet follow;
+			StateSet::const_iterator xi = cur.begin(), xe = cur.end();
+			for (; xi != xe; ++xi)
+			{
+				std::vector<NfaEdge>::const_iterator ei = nfa[ *xi].edges.begin(), ee = nfa[ *xi].edges.end();
+				for (; ei != ee; ++ei)
+				{
+					if (ei->set.test( representative[ ci])) follow.push_back( ei->target);
+				}
+			}
+			closure( nfa, follow, visited, ++visitid);
+			StateSetMap::const_iterator mi = statemap.find( follow);
+			if (mi == statemap.end())
+			{
+				if (statear.size() >= maxStates)
+				{
+					throw strus::runtime_error(_TXT("the patterns need more than %u states, use the lexer 'std' for them or raise the option MAXSTATES"), maxStates);
+				}
+				mi = statemap.insert( StateSetMap::value_type( follow, statear.size())).first;
+				statear.push_back( follow);
+			}
+			m_table.push_back( (uint16_t)mi->second);
+		}
+	}
+
+	// Collect the patterns accepted per state:
+	std::vector<StateSet>::const_iterator ai = statear.begin(), ae = statear.end();
+	for (; ai != ae; ++ai)
+	{
+		m_acceptidx.push_back( m_acceptar.size());
+		std::size_t startidx = m_acceptar.size();
+		StateSet::const_iterator xi = ai->begin(), xe = ai->end();
+		for (; xi != xe; ++xi)
+		{
+			if (nfa[ *xi].accept >= 0) m_acceptar.push_back( nfa[ *xi].accept);
+		}
+		std::sort( m_acceptar.begin() + startidx, m_acceptar.end());
+		m_acceptar.erase( std::unique( m_acceptar.begin() + startidx, m_acceptar.end()), m_acceptar.end());
+	}
+	m_acceptidx.push_back( m_acceptar.size());
+}
+
+/// \brief Definition of a lexem
+struct DfaPatternDef
+{
+	std::string expression;
+	uint32_t id;
+	uint8_t level;
+	uint8_t posbind;
+	bool withSymbols;			///< true if symbols are defined for the lexem, evaluated by 'compile'
+
+	DfaPatternDef( const std::string& expression_, uint32_t id_, uint8_t level_, uint8_t posbind_)
+		:expression(expression_),id(id_),level(level_),posbind(posbind_),withSymbols(false){}
+	DfaPatternDef( const DfaPatternDef& o)
+		:expression(o.expression),id(o.id),level(o.level),posbind(o.posbind),withSymbols(o.withSymbols){}
+};
+
+/// \brief Data of a lexer instance shared with its contexts
+struct DfaLexerData
+{
+	typedef std::map<std::string,uint32_t> SymbolTable;
+	typedef std::map<uint32_t,SymbolTable> SymbolTableMap;
+
+	std::vector<DfaPatternDef> patternar;	///< lexems defined, the index is the one reported by the automaton
+	SymbolTableMap symtabmap;		///< map lexem identifier -> symbols defined for it
+	TokenDfa dfa;				///< automaton compiled
+
+	DfaLexerData()
+		:patternar(),symtabmap(),dfa(){}
+
+	/// \brief Lookup a symbol of a lexem
+	/// \return the symbol identifier or 0 if not found
+	uint32_t symbolId( uint32_t patternid, const char* key, std::size_t keylen) const
+	{
+		SymbolTableMap::const_iterator ti = symtabmap.find( patternid);
+		if (ti == symtabmap.end()) return 0;
+		SymbolTable::const_iterator si = ti->second.find( std::string( key, keylen));
+		return si == ti->second.end() ? 0 : si->second;
+	}
+};
+
+
+class PatternLexerDfaContext
+	:public PatternLexerContextInterface
+{
+public:
+	PatternLexerDfaContext( const DfaLexerData* data_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_data(data_),m_matchEventList(),m_matchEnd(),m_touched(),m_marks(){}
+
+	virtual ~PatternLexerDfaContext(){}
+
+	virtual std::vector<analyzer::PatternLexem> match( const char* src, std::size_t srclen)
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			scan( src, srclen);
+			// ... lexems bound to the successor before the first lexem with content are only valid if such a lexem exists
+			if (containsContentEvent( m_matchEventList.begin(), m_matchEventList.end()))
+			{
+				rt.reserve( m_matchEventList.size());
+				LexemVectorOutput out( rt);
+				OrdinalPositionAssigner ordposAssigner;
+				ordposAssigner.append( out, m_matchEventList.begin(), m_matchEventList.end());
+			}
+			m_matchEventList.clear();
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+	virtual void reset()
+	{
+		m_matchEventList.clear();
+	}
+
+private:
+	/// \brief Run the automaton from each start position and collect the longest match of each lexem as match event
+	/// \note Every end of a lexem match is assigned to the leftmost start position it is reached from, like the start reported for a match by the lexer "std".
+	///	For each start position the longest of the matches assigned to it is reported, the same as the lexer "std" keeps after dropping the superseded matches.
+	/// \note The automaton is run from a start position for at most the maximum size of a lexem, a match reaching it is rejected as too long.
+	///	A run stops where it reaches a state an earlier start position has reached at the same position, because all ends ahead are assigned to the earlier one
+	void scan( const char* src, std::size_t srcsize)
+	{
+		if (srcsize >= (std::size_t)std::numeric_limits<uint32_t>::max())
+		{
+			throw strus::runtime_error( _TXT("position of matched term out of range"));
+		}
+		const TokenDfa& dfa = m_data->dfa;
+		const unsigned char* us = (const unsigned char*)src;
+		std::size_t nofPatterns = m_data->patternar.size();
+		m_matchEventList.clear();
+		m_matchEnd.assign( nofPatterns, 0);
+		//... the positions ahead of a start position reached by a run fit into a ring of the maximum size of a lexem
+		std::size_t nofMarks = std::min( srcsize, (std::size_t)MaxLexemSize) + 1;
+		if (m_marks.size() < nofMarks) m_marks.resize( nofMarks);
+		std::vector<PositionMark>::iterator mi = m_marks.begin(), me = m_marks.begin() + nofMarks;
+		for (; mi != me; ++mi) mi->reset( 0);
+
+		std::size_t start = 0;
+		for (; start < srcsize; ++start)
+		{
+			uint32_t state = dfa.next( TokenDfa::StartState, us[ start]);
+			std::size_t pos = start+1;
+			std::size_t maxpos = std::min( srcsize, start + (std::size_t)MaxLexemSize);
+			m_touched.clear();
+			for (; state != TokenDfa::DeadState; ++pos)
+			{
+				PositionMark& mark = m_marks[ pos % nofMarks];
+				if (mark.pos != pos)
+				{
+					//... the slot of a position not ahead of the start position anymore
+					mark.reset( pos);
+				}
+				if (!mark.visit( state))
+				{
+					//... runs of characters matched by a pattern like [a-z]+ merge with the run of the previous start position after one step
+					break;
+				}
+
+				uint32_t ai = dfa.acceptStart( state), ae = dfa.acceptEnd( state);
+				for (; ai != ae; ++ai)
+				{
+					uint32_t pidx = dfa.acceptPattern( ai);
+					if (mark.reach( pidx))
+					{
+						if (!m_matchEnd[ pidx]) m_touched.push_back( pidx);
+						m_matchEnd[ pidx] = pos;
+					}
+				}
+				if (pos == maxpos) break;
+				state = dfa.next( state, us[ pos]);
+			}
+			std::vector<uint32_t>::const_iterator ti = m_touched.begin(), te = m_touched.end();
+			for (; ti != te; ++ti)
+			{
+				std::size_t end = m_matchEnd[ *ti];
+				m_matchEnd[ *ti] = 0;
+				pushMatchEvent( *ti, src, start, end);
+			}
+		}
+		m_matchEventList.resolveAll();
+	}
+
+	void pushMatchEvent( uint32_t pidx, const char* src, std::size_t from, std::size_t to)
+	{
+		if (to - from >= MaxLexemSize)
+		{
+			throw strus::runtime_error( _TXT("size of matched term out of range"));
+		}
+		const DfaPatternDef& patternDef = m_data->patternar[ pidx];
+		uint32_t patternid = patternDef.id;
+		if (patternDef.withSymbols)
+		{
+			uint32_t symid = m_data->symbolId( patternDef.id, src + from, to - from);
+			if (symid) patternid = symid;
+		}
+		m_matchEventList.add( MatchEvent( patternDef.id, patternDef.level, patternDef.posbind, (uint32_t)from, (uint32_t)(to-from)), patternid, (uint32_t)to);
+	}
+
+private:
+	PatternLexerDfaContext( const PatternLexerDfaContext&){}	//... non copyable
+	void operator=( const PatternLexerDfaContext&){}		//... non copyable
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const DfaLexerData* m_data;
+	MatchEventList m_matchEventList;
+	std::vector<std::size_t> m_matchEnd;		///< map pattern index -> end of its longest match assigned to the current start position or 0
+	std::vector<uint32_t> m_touched;		///< indices of the patterns matching from the current start position
+
+	/// \brief What the runs from the start positions before have reached at a position ahead of the current start position
+	struct PositionMark
+	{
+		std::size_t pos;			///< position marked, 0 for none
+		std::vector<uint32_t> states;		///< states of the automaton reached at this position
+		std::vector<uint32_t> reached;		///< indices of the patterns with a match ending at this position
+
+		PositionMark()
+			:pos(0),states(),reached(){}
+
+		void reset( std::size_t pos_)
+		{
+			pos = pos_;
+			states.clear();
+			reached.clear();
+		}
+
+		/// \brief Mark a state of the automaton as reached at this position
+		/// \return true, if it has not been reached from a start position before
+		bool visit( uint32_t state)
+		{
+			if (std::find( states.begin(), states.end(), state) != states.end()) return false;
+			states.push_back( state);
+			return true;
+		}
+
+		/// \brief Mark the end of a match of a lexem at this position as reached
+		/// \return true, if it has not been reached from a start position before
+		bool reach( uint32_t pidx)
+		{
+			if (std::find( reached.begin(), reached.end(), pidx) != reached.end()) return false;
+			reached.push_back( pidx);
+			return true;
+		}
+	};
+	std::vector<PositionMark> m_marks;		///< map position modulo the number of positions ahead of a start position -> marks of the runs at this position
+};
+
+
+class PatternLexerDfaInstance
+	:public PatternLexerInstanceInterface
+{
+public:
+	explicit PatternLexerDfaInstance( ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_data(),m_state(DefinitionPhase),m_caseless(false),m_dotall(false),m_maxStates(DefaultMaxStates),m_idnamemap(),m_idnamestrings()
+	{}
+
+	virtual ~PatternLexerDfaInstance(){}
+
+	virtual void defineLexemName( unsigned int id, const std::string& name_)
+	{
+		try
+		{
+			if (m_idnamemap.find( id) != m_idnamemap.end()) throw std::runtime_error( _TXT("duplicate definition"));
+			m_idnamemap[ id] = m_idnamestrings.size()+1;
+			m_idnamestrings.push_back( '\0');
+			m_idnamestrings.append( name_);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to assign lexem name to lexem or symbol identifier: %s"), *m_errorhnd);
+	}
+
+	virtual const char* getLexemName( unsigned int id) const
+	{
+		std::map<unsigned int,std::size_t>::const_iterator li = m_idnamemap.find( id);
+		if (li == m_idnamemap.end()) return 0;
+		return m_idnamestrings.c_str() + li->second;
+	}
+
+	virtual void defineLexem(
+			unsigned int id,
+			const std::string& expression,
+			unsigned int resultIndex,
+			unsigned int level,
+			analyzer::PositionBind posbind)
+	{
+		try
+		{
+			if (id == 0 || id > MaxPatternId)
+			{
+				throw strus::runtime_error(_TXT("%s out of range, It must be a positive integer in the range 1..%u"), "pattern id", MaxPatternId);
+			}
+			if (level > std::numeric_limits<uint8_t>::max())
+			{
+				throw strus::runtime_error(_TXT("%s out of range, It must be a positive integer in the range 1..%u"), "level", (unsigned int)std::numeric_limits<uint8_t>::max());
+			}
+			if (resultIndex != 0)
+			{
+				throw strus::runtime_error(_TXT("sub expressions as result (result index %u) are not supported by the lexer '%s', use the lexer 'std'"), resultIndex, name());
+			}
+			//... lexems defined after calling 'compile' are compiled with all others by the next call of 'compile'
+			m_data.patternar.push_back( DfaPatternDef( expression, id, (uint8_t)level, (uint8_t)posbind));
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define term match regular expression pattern: %s"), *m_errorhnd);
+	}
+
+	virtual void defineSymbol( unsigned int symbolid, unsigned int patternid, const std::string& name_)
+	{
+		try
+		{
+			if (patternid == 0 || patternid > MaxPatternId)
+			{
+				throw strus::runtime_error(_TXT("pattern id out of range, The id must be a positive integer in the range 1..%u"), MaxPatternId);
+			}
+			if (symbolid == 0 || symbolid > MaxPatternId)
+			{
+				throw strus::runtime_error(_TXT("symbol id out of range, The id must be a positive integer in the range 1..%u"), MaxPatternId);
+			}
+			DfaLexerData::SymbolTable& symtab = m_data.symtabmap[ patternid];
+			if (symtab.find( name_) != symtab.end())
+			{
+				throw strus::runtime_error(_TXT("symbol '%s' defined twice"), name_.c_str());
+			}
+			symtab[ name_] = symbolid;
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define regular expression pattern symbol: %s"), *m_errorhnd);
+	}
+
+	virtual unsigned int getSymbol(
+			unsigned int patternid,
+			const std::string& name_) const
+	{
+		try
+		{
+			return m_data.symbolId( patternid, name_.c_str(), name_.size());
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to retrieve regular expression pattern symbol: %s"), *m_errorhnd, 0);
+	}
+
+	virtual void defineOption( const std::string& name_, double value)
+	{
+		try
+		{
+			if (strus::caseInsensitiveEquals( name_, "CASELESS"))
+			{
+				m_caseless = true;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "DOTALL"))
+			{
+				m_dotall = true;
+			}
+			else if (strus::caseInsensitiveEquals( name_, "MAXSTATES"))
+			{
+				if (value < 2.0 || value > (double)TokenDfa::MaxStates)
+				{
+					throw strus::runtime_error(_TXT("value of option '%s' out of range"), name_.c_str());
+				}
+				m_maxStates = (unsigned int)value;
+			}
+			else
+			{
+				throw strus::runtime_error(_TXT("unknown option '%s'"), name_.c_str());
+			}
+		}
+		CATCH_ERROR_MAP( _TXT("define option failed for DFA pattern lexer: %s"), *m_errorhnd);
+	}
+
+	virtual bool compile()
+	{
+		try
+		{
+			std::vector<RegexNode> nodear;
+			std::vector<unsigned int> rootar;
+			RegexParser parser( nodear, m_caseless, m_dotall);
+			std::vector<DfaPatternDef>::iterator pi = m_data.patternar.begin(), pe = m_data.patternar.end();
+			for (; pi != pe; ++pi)
+			{
+				unsigned int root = 0;
+				try
+				{
+					root = parser.parse( pi->expression);
+				}
+				catch (const std::runtime_error& err)
+				{
+					throw strus::runtime_error(_TXT("error in expression '%s' of lexem %u: %s"), pi->expression.c_str(), pi->id, err.what());
+				}
+				if (isNullable( nodear, root))
+				{
+					throw strus::runtime_error(_TXT("expression '%s' of lexem %u matches the empty string"), pi->expression.c_str(), pi->id);
+				}
+				rootar.push_back( root);
+				pi->withSymbols = m_data.symtabmap.find( pi->id) != m_data.symtabmap.end();
+			}
+			NfaBuilder nfa( nodear);
+			std::size_t ri = 0, re = rootar.size();
+			for (; ri != re; ++ri)
+			{
+				nfa.addPattern( rootar[ ri], ri);
+			}
+			TokenDfa dfa;
+			dfa.build( nfa.states(), m_maxStates);
+			m_data.dfa = dfa;
+			m_state = MatchPhase;
+			return true;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to compile regular expression patterns: %s"), *m_errorhnd, false);
+	}
+
+	virtual PatternLexerContextInterface* createContext() const
+	{
+		try
+		{
+			if (m_state != MatchPhase)
+			{
+				throw std::runtime_error( _TXT("called create context without calling 'compile'"));
+			}
+			return new PatternLexerDfaContext( &m_data, m_errorhnd);
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match context: %s"), *m_errorhnd, 0);
+	}
+
+	virtual const char* name() const
+	{
+		return "dfa";
+	}
+
+	virtual StructView view() const
+	{
+		try
+		{
+			StructView rt;
+			rt( "name", name());
+			rt( "lexems", (unsigned int)m_data.patternar.size());
+			if (m_state == MatchPhase)
+			{
+				rt( "states", m_data.dfa.nofStates());
+				rt( "classes", m_data.dfa.nofClasses());
+				rt( "tablesize", (unsigned int)m_data.dfa.tableSize());
+			}
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("introspection failed: %s"), *m_errorhnd, StructView());
+	}
+
+private:
+	PatternLexerDfaInstance( const PatternLexerDfaInstance&){}	//... non copyable
+	void operator=( const PatternLexerDfaInstance&){}		//... non copyable
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	DfaLexerData m_data;
+	enum State {DefinitionPhase,MatchPhase};
+	State m_state;
+	bool m_caseless;				///< ASCII letters matched case insensitive
+	bool m_dotall;					///< '.' matches also end of line
+	unsigned int m_maxStates;			///< maximum number of states of the automaton
+	std::map<unsigned int,std::size_t> m_idnamemap;
+	std::string m_idnamestrings;
+};
+
+
+std::vector<std::string> PatternLexerDfa::getCompileOptionNames() const
+{
+	std::vector<std::string> rt;
+	static const char* ar[] = {"CASELESS", "DOTALL", "MAXSTATES", 0};
+	for (std::size_t ai=0; ar[ai]; ++ai)
+	{
+		rt.push_back( ar[ ai]);
+	}
+	return rt;
+}
+
+PatternLexerInstanceInterface* PatternLexerDfa::createInstance() const
+{
+	try
+	{
+		return new PatternLexerDfaInstance( m_errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match instance: %s"), *m_errorhnd, 0);
+}
+
+StructView PatternLexerDfa::view() const
+{
+	try
+	{
+		return StructView()
+			("name", name())
+			("description", _TXT( "Pattern lexer for small sets of simple token expressions compiled into a table driven DFA"));
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("introspection failed: %s"), *m_errorhnd, 0);
+}
+
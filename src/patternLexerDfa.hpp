@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Implementation of detecting tokens defined as regular expressions on text with a table driven DFA built without external libraries
+/// \file "patternLexerDfa.hpp"
+#ifndef _STRUS_PATTERN_PATTERN_LEXER_DFA_IMPLEMENTATION_HPP_INCLUDED
+#define _STRUS_PATTERN_PATTERN_LEXER_DFA_IMPLEMENTATION_HPP_INCLUDED
+#include "strus/patternLexerInterface.hpp"
+
+namespace strus {
+
+///\brief Forward declaration
+class ErrorBufferInterface;
+
+/// \brief Object for creating a lexer for small sets of simple token expressions compiled into one deterministic automaton with a byte transition table
+/// \note The lexems are detected like with the lexer "std": Each end of a match of a lexem is assigned to the leftmost start position it is reached from,
+///	and for each start position the longest match assigned to it is reported. Matches of a lexem may overlap.
+///	The rules for levels and position binding are the same as for the lexer "std".
+/// \note Supports literals, '.', character classes, the escapes \\d \\w \\s (ASCII) and their negation, groups, alternatives and the quantifiers * + ? {m,n}.
+///	Anchors, word boundaries, lookarounds, edit distance matching and sub expressions (result index) are not supported and rejected.
+class PatternLexerDfa
+	:public PatternLexerInterface
+{
+public:
+	explicit PatternLexerDfa( ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_){}
+
+	virtual ~PatternLexerDfa(){}
+
+	virtual std::vector<std::string> getCompileOptionNames() const;
+	virtual PatternLexerInstanceInterface* createInstance() const;
+
+	virtual const char* name() const	{return "dfa";}
+	virtual StructView view() const;
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+};
+
+}//namespace
+#endif
+
+
@@ -22,6 +22,7 @@
 #include "strus/lib/pattern_resultformat.hpp"
 #include "ruleMatcherAutomaton.hpp"
 #include <map>
+#include <set>
 #include <limits>
 #include <vector>
 #include <cstring>
@@ -104,18 +105,33 @@ static uint32_t eventHandle( PatternEventType type_, uint32_t idx)
 	return idx | ((uint32_t)type_ << 29);
 }
 
+void PatternMatcherTermConsumer::putTerm( uint32_t id, uint32_t ordpos, uint32_t origseg, uint32_t origpos, uint32_t origsize)
+{
+	if (m_curPosition > (int)ordpos)
+	{
+		throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), (unsigned int)m_curPosition, (unsigned int)ordpos);
+	}
+	else if (m_curPosition < (int)ordpos)
+	{
+		m_statemachine->setCurrentPos( m_curPosition = ordpos);
+	}
+	uint32_t eventid = eventHandle( TermEvent, id);
+	EventData data( origseg, origpos, origseg, origpos + origsize, ordpos, ordpos+1, 0/*subdataref*/, 0/*formathandle*/);
+	m_statemachine->doTransition( eventid, data);
+	++m_nofEvents;
+}
+
 class PatternMatcherContext
 	:public PatternMatcherContextInterface
+	,public PatternMatcherTermConsumer
 {
 public:
 	PatternMatcherContext( const PatternMatcherData* data_, ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_)
+		:PatternMatcherTermConsumer()
+		,m_errorhnd(errorhnd_)
 		,m_debugtrace(0)
 		,m_data(data_)
 		,m_resultFormatContext(errorhnd_)
-		,m_statemachine(0)
-		,m_nofEvents(0)
-		,m_curPosition(0)
 	{
 		DebugTraceInterface* dbgi = m_errorhnd->debugTrace();
 		if (dbgi) m_debugtrace = dbgi->createTraceContext( STRUS_DBGTRACE_COMPONENT_NAME);
@@ -133,15 +149,7 @@ public:
 		try
 		{
 			DEBUG_EVENT2( "input", "id=%u ordpos=%u", term.id(), (unsigned int)term.ordpos())
-			if (m_curPosition > term.ordpos())
-			{
-				throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), m_curPosition, term.ordpos());
-			}
-			else if (m_curPosition < term.ordpos())
-			{
-				m_statemachine->setCurrentPos( m_curPosition = term.ordpos());
-			}
-			else if (term.origsize() >= std::numeric_limits<int32_t>::max())
+			if (term.origsize() >= std::numeric_limits<int32_t>::max())
 			{
 				throw std::runtime_error( _TXT("term event orig size out of range"));
 			}
@@ -153,10 +161,7 @@ public:
 			{
 				throw std::runtime_error( _TXT("term event orig segment byte position out of range"));
 			}
-			uint32_t eventid = eventHandle( TermEvent, term.id());
-			EventData data( term.origpos().seg(), term.origpos().ofs(), term.origpos().seg(), term.origpos().ofs() + term.origsize(), term.ordpos(), term.ordpos()+1, 0/*subdataref*/, 0/*formathandle*/);
-			m_statemachine->doTransition( eventid, data);
-			++m_nofEvents;
+			putTerm( term.id(), term.ordpos(), term.origpos().seg(), term.origpos().ofs(), term.origsize());
 		}
 		CATCH_ERROR_MAP( _TXT("failed to feed input to pattern matcher: %s"), *m_errorhnd);
 	}
@@ -321,29 +326,32 @@ public:
 	{
 		try
 		{
-			StateMachine* new_statemachine = new StateMachine( &m_data->programTable, m_debugtrace);
-			delete m_statemachine;
-			m_statemachine = new_statemachine;
-			m_nofEvents = 0;
-			m_curPosition = 0;
+			resetAutomaton();
 		}
 		CATCH_ERROR_MAP( _TXT("failed to get reset pattern matcher context: %s"), *m_errorhnd);
 	}
 
+	virtual void resetAutomaton()
+	{
+		StateMachine* new_statemachine = new StateMachine( &m_data->programTable, m_debugtrace);
+		delete m_statemachine;
+		m_statemachine = new_statemachine;
+		m_nofEvents = 0;
+		m_curPosition = 0;
+	}
+
 private:
 	ErrorBufferInterface* m_errorhnd;
 	DebugTraceContextInterface* m_debugtrace;
 	const PatternMatcherData* m_data;
 	PatternResultFormatContext m_resultFormatContext;
-	StateMachine* m_statemachine;
-	unsigned int m_nofEvents;
-	int m_curPosition;
 };
 
 
 /// \brief Interface for building the automaton for detecting patterns in a document stream
 class PatternMatcherInstance
 	:public PatternMatcherInstanceInterface
+	,public PatternMatcherTermUsage
 {
 public:
 	explicit PatternMatcherInstance( ErrorBufferInterface* errorhnd_)
@@ -670,6 +678,20 @@ public:
 		CATCH_ERROR_MAP_RETURN( _TXT("failed to compile (optimize) pattern matching automaton: %s"), *m_errorhnd, false);
 	}
 
+	virtual std::vector<uint32_t> usedTermIds() const
+	{
+		std::vector<uint32_t> rt;
+		std::set<uint32_t> events = m_data.programTable.usedEvents();
+		std::set<uint32_t>::const_iterator ei = events.begin(), ee = events.end();
+		for (; ei != ee; ++ei)
+		{
+			//... the events are ordered by type first, the term events come first with their identifier as handle
+			if ((*ei >> 29) != (uint32_t)TermEvent) break;
+			rt.push_back( *ei);
+		}
+		return rt;
+	}
+
 	virtual const char* name() const
 	{
 		return "std";
@@ -11,6 +11,8 @@
 #define _STRUS_PATTERN_MATCHER_IMPLEMENTATION_HPP_INCLUDED
 #include "strus/patternMatcherInterface.hpp"
 #include "strus/structView.hpp"
+#include "strus/base/stdint.h"
+#include <vector>
 
 namespace strus
 {
@@ -18,6 +20,49 @@ namespace strus
 class PatternMatcherInstanceInterface;
 /// \brief Forward declaration
 class ErrorBufferInterface;
+/// \brief Forward declaration
+class StateMachine;
+
+/// \brief Base of the pattern matcher contexts of this library, feeding term events to the automaton without virtual dispatch
+/// \note Used by pipelines feeding the lexems of a lexer of this library directly to the pattern matcher
+class PatternMatcherTermConsumer
+{
+public:
+	PatternMatcherTermConsumer()
+		:m_statemachine(0),m_nofEvents(0),m_curPosition(0){}
+	virtual ~PatternMatcherTermConsumer(){}
+
+	/// \brief Reset the automaton for matching a new document
+	/// \remark Throws on error, unlike PatternMatcherContextInterface::reset that reports its errors to the error buffer
+	virtual void resetAutomaton()=0;
+
+	/// \brief Feed a term event to the automaton
+	/// \param[in] id identifier of the term
+	/// \param[in] ordpos ordinal position of the term, not smaller than the ordinal position of the previous term fed
+	/// \param[in] origseg original segment of the term
+	/// \param[in] origpos original byte position of the term in the segment
+	/// \param[in] origsize original size of the term in bytes
+	/// \remark Throws on error
+	void putTerm( uint32_t id, uint32_t ordpos, uint32_t origseg, uint32_t origpos, uint32_t origsize);
+
+protected:
+	StateMachine* m_statemachine;
+	unsigned int m_nofEvents;
+	int m_curPosition;
+};
+
+/// \brief Base of the pattern matcher instances of this library, providing the terms the patterns defined are triggered by
+/// \note Used by lexers of this library for dropping the lexems not used by the pattern matcher
+class PatternMatcherTermUsage
+{
+public:
+	virtual ~PatternMatcherTermUsage(){}
+
+	/// \brief Get the identifiers of the terms used by the patterns defined
+	/// \return the term identifiers, sorted ascending
+	/// \remark Throws on error
+	virtual std::vector<uint32_t> usedTermIds() const=0;
+};
 
 /// \brief Implementation of an automaton builder for detecting patterns of tokens in a document stream
 class PatternMatcher
@@ -475,10 +475,8 @@ ProgramTable::Statistics ProgramTable::getProgramStatistics() const
 	return rt;
 }
 
-void ProgramTable::eliminateUnusedEvents()
+void ProgramTable::collectTriggerEvents( std::set<uint32_t>& usedEvents, std::set<uint32_t>& programs) const
 {
-	std::set<uint32_t> usedEvents;
-	std::set<uint32_t> programs;
 	EventProgamTriggerMap::const_iterator
 		ei = m_eventProgamTriggerMap.begin(),
 		ee = m_eventProgamTriggerMap.end();
@@ -498,6 +496,21 @@ void ProgramTable::eliminateUnusedEvents()
 			}
 		}
 	}
+}
+
+std::set<uint32_t> ProgramTable::usedEvents() const
+{
+	std::set<uint32_t> rt;
+	std::set<uint32_t> programs;
+	collectTriggerEvents( rt, programs);
+	return rt;
+}
+
+void ProgramTable::eliminateUnusedEvents()
+{
+	std::set<uint32_t> usedEvents;
+	std::set<uint32_t> programs;
+	collectTriggerEvents( usedEvents, programs);
 	std::set<uint32_t>::const_iterator gi = programs.begin(), ge = programs.end();
 	for (; gi != ge; ++gi)
 	{
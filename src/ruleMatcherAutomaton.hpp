@@ -385,6 +385,8 @@ public:
 
 	Statistics getProgramStatistics() const;
 	bool isStopWord( uint32_t eventid) const		{return m_stopWordSet.find(eventid) != m_stopWordSet.end();}
+	/// \brief Get the events triggering the programs defined
+	std::set<uint32_t> usedEvents() const;
 
 private:
 	void defineEventProgramAlt( uint32_t eventid, uint32_t programidx, uint32_t past_eventid);
@@ -393,6 +395,7 @@ private:
 	void getDelimTokenStopWordSet( uint32_t triggerListIdx);
 	void defineEventProgram( uint32_t eventid, uint32_t programidx);
 	void defineDisposeRule( uint32_t pos, uint32_t ruleidx);
+	void collectTriggerEvents( std::set<uint32_t>& usedEvents, std::set<uint32_t>& programs) const;
 	void eliminateUnusedEvents();
 
 private:
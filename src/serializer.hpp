@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Functions for packing and unpacking binary data in a platform independent byte order
+/// \file "serializer.hpp"
+#ifndef _STRUS_PATTERN_SERIALIZER_HPP_INCLUDED
+#define _STRUS_PATTERN_SERIALIZER_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include "internationalization.hpp"
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+namespace strus
+{
+
+struct Serializer
+{
+	static void packUint32( std::string& buf, uint32_t val)
+	{
+		char ar[4];
+		ar[0] = (char)(unsigned char)(val & 0xFF);
+		ar[1] = (char)(unsigned char)((val >> 8) & 0xFF);
+		ar[2] = (char)(unsigned char)((val >> 16) & 0xFF);
+		ar[3] = (char)(unsigned char)((val >> 24) & 0xFF);
+		buf.append( ar, sizeof(ar));
+	}
+	static void packUint64( std::string& buf, uint64_t val)
+	{
+		packUint32( buf, (uint32_t)(val & 0xFFffFFffU));
+		packUint32( buf, (uint32_t)(val >> 32));
+	}
+	static void packBlob( std::string& buf, const char* ptr, std::size_t size)
+	{
+		packUint64( buf, size);
+		buf.append( ptr, size);
+	}
+	static void packString( std::string& buf, const std::string& str)
+	{
+		packBlob( buf, str.c_str(), str.size());
+	}
+};
+
+class Deserializer
+{
+public:
+	Deserializer( const char* src_, std::size_t srcsize_)
+		:m_itr(src_),m_end(src_+srcsize_){}
+
+	bool eof() const
+	{
+		return m_itr == m_end;
+	}
+	std::size_t remaining() const
+	{
+		return m_end - m_itr;
+	}
+	uint32_t unpackUint32()
+	{
+		check( 4);
+		const unsigned char* ar = (const unsigned char*)m_itr;
+		uint32_t rt = (uint32_t)ar[0] | ((uint32_t)ar[1] << 8) | ((uint32_t)ar[2] << 16) | ((uint32_t)ar[3] << 24);
+		m_itr += 4;
+		return rt;
+	}
+	uint64_t unpackUint64()
+	{
+		uint64_t lo = unpackUint32();
+		uint64_t hi = unpackUint32();
+		return lo | (hi << 32);
+	}
+	/// \brief Unpack a blob without copying it
+	/// \return pointer to the blob in the source
+	const char* unpackBlob( std::size_t& size)
+	{
+		uint64_t blobsize = unpackUint64();
+		if (blobsize > (uint64_t)(m_end - m_itr))
+		{
+			throw std::runtime_error( _TXT("unexpected end of serialized data"));
+		}
+		const char* rt = m_itr;
+		m_itr += (std::size_t)blobsize;
+		size = (std::size_t)blobsize;
+		return rt;
+	}
+	std::string unpackString()
+	{
+		std::size_t size;
+		const char* ptr = unpackBlob( size);
+		return std::string( ptr, size);
+	}
+
+private:
+	void check( std::size_t size) const
+	{
+		if ((std::size_t)(m_end - m_itr) < size)
+		{
+			throw std::runtime_error( _TXT("unexpected end of serialized data"));
+		}
+	}
+
+private:
+	char const* m_itr;
+	const char* m_end;
+};
+
+}//namespace
+#endif
+
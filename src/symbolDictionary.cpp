@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Read only dictionary of symbols with a minimal perfect hash for lookup, built in bulk and mapped from a file
+/// \file "symbolDictionary.cpp"
+#include "symbolDictionary.hpp"
+#include "serializer.hpp"
+#include "unicodeUtils.hpp"
+#include "internationalization.hpp"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace strus;
+
+#define DICTIONARY_FILE_MAGIC "strus pattern symbol dictionary"
+enum {DictionaryFileFormatVersion=2};
+
+enum {
+	BucketLoad=2,				///< average number of keys per bucket of the first hash
+	DirectSlotFlag=0x80000000U,		///< flag marking a displacement as the index of the slot of the only key of a bucket
+	MaxDisplacement=(1<<20),		///< maximum number of displacements tried for a bucket before trying another seed
+	MaxNofSeeds=16				///< maximum number of seeds tried before giving up
+};
+
+static uint64_t keyHash( const char* key, std::size_t keylen, uint32_t seed)
+{
+	uint64_t rt = 14695981039346656037ULL ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ULL);
+	const unsigned char* ki = (const unsigned char*)key;
+	const unsigned char* ke = ki + keylen;
+	for (; ki != ke; ++ki)
+	{
+		rt ^= *ki;
+		rt *= 1099511628211ULL;
+	}
+	rt ^= rt >> 33;
+	rt *= 0xff51afd7ed558ccdULL;
+	rt ^= rt >> 33;
+	rt *= 0xc4ceb9fe1a85ec53ULL;
+	rt ^= rt >> 33;
+	return rt;
+}
+
+static uint32_t bucketIndex( uint64_t hash, uint32_t nofBuckets)
+{
+	return (uint32_t)(hash >> 32) % nofBuckets;
+}
+
+/// \brief Get the slot of a key, the second hash is derived from the first, so that the key is read only once
+static uint32_t slotIndex( uint64_t hash, uint32_t displacement, uint32_t nofSlots)
+{
+	uint64_t rt = hash + (uint64_t)displacement * 0x9E3779B97F4A7C15ULL;
+	rt ^= rt >> 33;
+	rt *= 0xff51afd7ed558ccdULL;
+	rt ^= rt >> 33;
+	return (uint32_t)(rt % nofSlots);
+}
+
+static uint32_t readUint32( const unsigned char* ar)
+{
+	return (uint32_t)ar[0] | ((uint32_t)ar[1] << 8) | ((uint32_t)ar[2] << 16) | ((uint32_t)ar[3] << 24);
+}
+
+namespace {
+struct DictionaryEntry
+{
+	uint32_t keyofs;
+	uint32_t keylen;
+	uint32_t value;
+	uint64_t hash;
+
+	DictionaryEntry( uint32_t keyofs_, uint32_t keylen_, uint32_t value_)
+		:keyofs(keyofs_),keylen(keylen_),value(value_),hash(0){}
+	DictionaryEntry( const DictionaryEntry& o)
+		:keyofs(o.keyofs),keylen(o.keylen),value(o.value),hash(o.hash){}
+};
+
+struct DictionaryEntryHashOrder
+{
+	bool operator()( const DictionaryEntry& a, const DictionaryEntry& b) const
+	{
+		return a.hash < b.hash;
+	}
+};
+
+struct BucketSizeOrder
+{
+	explicit BucketSizeOrder( const std::vector<uint32_t>& bucketsize_)
+		:bucketsize(&bucketsize_){}
+	bool operator()( uint32_t a, uint32_t b) const
+	{
+		return (*bucketsize)[ a] != (*bucketsize)[ b] ? (*bucketsize)[ a] > (*bucketsize)[ b] : a < b;
+	}
+	const std::vector<uint32_t>* bucketsize;
+};
+}//anonymous namespace
+
+static void parseDictionary( const std::string& path, const std::string& content, std::vector<DictionaryEntry>& entries, std::string& strings, uint32_t maxvalue)
+{
+	char const* si = content.c_str();
+	const char* se = si + content.size();
+	unsigned int linecnt = 0;
+	while (si != se)
+	{
+		++linecnt;
+		const char* eoln = (const char*)std::memchr( si, '\n', se - si);
+		if (!eoln) eoln = se;
+		const char* le = eoln;
+		if (le != si && *(le-1) == '\r') --le;
+		if (le != si)
+		{
+			const char* tab = (const char*)std::memchr( si, '\t', le - si);
+			if (!tab || tab == si)
+			{
+				throw strus::runtime_error(_TXT("syntax error in symbol dictionary file '%s' on line %u: expected symbol name followed by a tab and the symbol identifier"), path.c_str(), linecnt);
+			}
+			uint64_t value = 0;
+			const char* vi = tab+1;
+			for (; vi != le && *vi >= '0' && *vi <= '9'; ++vi)
+			{
+				value = value * 10 + (*vi - '0');
+				if (value > maxvalue) break;
+			}
+			if (vi != le || vi == tab+1 || value == 0 || value > maxvalue)
+			{
+				throw strus::runtime_error(_TXT("symbol id out of range in symbol dictionary file '%s' on line %u, The id must be a positive integer in the range 1..%u"), path.c_str(), linecnt, maxvalue);
+			}
+			if (strings.size() + (tab - si) > (std::size_t)std::numeric_limits<uint32_t>::max())
+			{
+				throw strus::runtime_error(_TXT("symbol dictionary file '%s' too big"), path.c_str());
+			}
+			entries.push_back( DictionaryEntry( strings.size(), tab - si, value));
+			strings.append( si, tab - si);
+		}
+		si = (eoln == se) ? se : eoln+1;
+	}
+	if (entries.size() >= (std::size_t)DirectSlotFlag)
+	{
+		throw strus::runtime_error(_TXT("too many entries in symbol dictionary file '%s'"), path.c_str());
+	}
+}
+
+/// \brief Replace the keys of the entries of a dictionary by their normalized form
+/// \note Keys equal after normalization are joined if they have the same value
+static void normalizeKeys( const std::string& path, std::vector<DictionaryEntry>& entries, std::string& strings, unsigned int normalization)
+{
+	typedef std::map<std::string,uint32_t> KeyMap;
+	KeyMap keymap;
+	NormalizedCharMap normalizer;
+	std::vector<DictionaryEntry>::const_iterator ei = entries.begin(), ee = entries.end();
+	for (; ei != ee; ++ei)
+	{
+		normalizer.init( strings.c_str() + ei->keyofs, ei->keylen, normalization);
+		std::string key( normalizer.data(), normalizer.size());
+		std::pair<KeyMap::iterator,bool> ins = keymap.insert( KeyMap::value_type( key, ei->value));
+		if (!ins.second && ins.first->second != ei->value)
+		{
+			throw strus::runtime_error(_TXT("symbol '%s' defined twice with different identifiers after normalization in symbol dictionary file '%s'"), key.c_str(), path.c_str());
+		}
+	}
+	entries.clear();
+	strings.clear();
+	KeyMap::const_iterator ki = keymap.begin(), ke = keymap.end();
+	for (; ki != ke; ++ki)
+	{
+		if (strings.size() + ki->first.size() > (std::size_t)std::numeric_limits<uint32_t>::max())
+		{
+			throw strus::runtime_error(_TXT("symbol dictionary file '%s' too big"), path.c_str());
+		}
+		entries.push_back( DictionaryEntry( strings.size(), ki->first.size(), ki->second));
+		strings.append( ki->first);
+	}
+}
+
+/// \brief Try to build the hash and displace table with a seed
+/// \return true on success, false if another seed has to be tried
+static bool buildTable( std::vector<DictionaryEntry>& entries, const std::string& strings, uint32_t seed, uint32_t nofBuckets, std::vector<uint32_t>& displacements, std::vector<uint32_t>& slotmap)
+{
+	uint32_t nofSlots = entries.size();
+	std::vector<DictionaryEntry>::iterator ei = entries.begin(), ee = entries.end();
+	for (; ei != ee; ++ei)
+	{
+		ei->hash = keyHash( strings.c_str() + ei->keyofs, ei->keylen, seed);
+	}
+	std::sort( entries.begin(), entries.end(), DictionaryEntryHashOrder());
+	for (ei = entries.begin(); ei != ee; ++ei)
+	{
+		std::vector<DictionaryEntry>::iterator next = ei+1;
+		if (next != ee && next->hash == ei->hash)
+		{
+			if (next->keylen == ei->keylen && 0==std::memcmp( strings.c_str() + next->keyofs, strings.c_str() + ei->keyofs, ei->keylen))
+			{
+				throw strus::runtime_error(_TXT("symbol defined twice: '%s'"), std::string( strings.c_str() + ei->keyofs, ei->keylen).c_str());
+			}
+			//... distinct keys with the same hash value cannot be separated by any displacement
+			return false;
+		}
+	}
+	// Group the entries by bucket:
+	std::vector<uint32_t> bucketsize( nofBuckets, 0);
+	for (ei = entries.begin(); ei != ee; ++ei)
+	{
+		++bucketsize[ bucketIndex( ei->hash, nofBuckets)];
+	}
+	std::vector<uint32_t> bucketstart( nofBuckets+1, 0);
+	uint32_t bi = 0;
+	for (; bi != nofBuckets; ++bi)
+	{
+		bucketstart[ bi+1] = bucketstart[ bi] + bucketsize[ bi];
+	}
+	std::vector<uint32_t> bucketmembers( nofSlots);
+	std::vector<uint32_t> fillpos( bucketstart.begin(), bucketstart.end()-1);
+	for (ei = entries.begin(); ei != ee; ++ei)
+	{
+		bucketmembers[ fillpos[ bucketIndex( ei->hash, nofBuckets)]++] = ei - entries.begin();
+	}
+	// Place the buckets, the biggest first, when the table is still empty:
+	std::vector<uint32_t> bucketorder;
+	bucketorder.reserve( nofBuckets);
+	for (bi = 0; bi != nofBuckets; ++bi)
+	{
+		if (bucketsize[ bi]) bucketorder.push_back( bi);
+	}
+	std::sort( bucketorder.begin(), bucketorder.end(), BucketSizeOrder( bucketsize));
+
+	displacements.assign( nofBuckets, 0);
+	slotmap.assign( nofSlots, std::numeric_limits<uint32_t>::max());
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t>::const_iterator oi = bucketorder.begin(), oe = bucketorder.end();
+	for (; oi != oe && bucketsize[ *oi] > 1; ++oi)
+	{
+		const uint32_t* members = &bucketmembers[ bucketstart[ *oi]];
+		uint32_t nofMembers = bucketsize[ *oi];
+		uint32_t displacement = 1;
+		for (; displacement < (uint32_t)MaxDisplacement; ++displacement)
+		{
+			candidates.clear();
+			uint32_t mi = 0;
+			for (; mi != nofMembers; ++mi)
+			{
+				uint32_t slot = slotIndex( entries[ members[ mi]].hash, displacement, nofSlots);
+				if (slotmap[ slot] != std::numeric_limits<uint32_t>::max()
+				||	std::find( candidates.begin(), candidates.end(), slot) != candidates.end()) break;
+				candidates.push_back( slot);
+			}
+			if (mi == nofMembers) break;
+		}
+		if (displacement == (uint32_t)MaxDisplacement) return false;
+		displacements[ *oi] = displacement;
+		uint32_t mi = 0;
+		for (; mi != nofMembers; ++mi)
+		{
+			slotmap[ candidates[ mi]] = members[ mi];
+		}
+	}
+	// The buckets with only one key get the free slots left assigned directly:
+	uint32_t freeslot = 0;
+	for (; oi != oe; ++oi)
+	{
+		while (slotmap[ freeslot] != std::numeric_limits<uint32_t>::max()) ++freeslot;
+		displacements[ *oi] = freeslot | DirectSlotFlag;
+		slotmap[ freeslot] = bucketmembers[ bucketstart[ *oi]];
+	}
+	return true;
+}
+
+SymbolDictionary::SymbolDictionary()
+	:m_image(),m_mapped(0),m_mappedSize(0)
+	,m_normalization(0),m_nofEntries(0),m_nofBuckets(0),m_seed(0)
+	,m_buckets(0),m_slots(0),m_strings(0),m_stringsSize(0)
+{}
+
+SymbolDictionary::~SymbolDictionary()
+{
+	if (m_mapped) ::munmap( m_mapped, m_mappedSize);
+}
+
+/// \brief Read the content of a dictionary text file
+static std::string readFile( const std::string& path)
+{
+	std::string rt;
+	FILE* fh = std::fopen( path.c_str(), "rb");
+	if (!fh)
+	{
+		throw strus::runtime_error(_TXT("failed to open symbol dictionary file '%s': %s"), path.c_str(), std::strerror( errno));
+	}
+	char buf[ 1<<16];
+	std::size_t nn;
+	while (0!=(nn=std::fread( buf, 1, sizeof(buf), fh)))
+	{
+		rt.append( buf, nn);
+	}
+	int ec = std::ferror( fh) ? errno : 0;
+	std::fclose( fh);
+	if (ec)
+	{
+		throw strus::runtime_error(_TXT("failed to read symbol dictionary file '%s': %s"), path.c_str(), std::strerror( ec));
+	}
+	return rt;
+}
+
+SymbolDictionary* SymbolDictionary::build( const std::string& path, const std::string& signature, uint32_t maxvalue, unsigned int normalization)
+{
+	std::string content = readFile( path);
+	std::vector<DictionaryEntry> entries;
+	std::string strings;
+	parseDictionary( path, content, entries, strings, maxvalue);
+	content.clear();
+	if (normalization)
+	{
+		//... the keys are looked up with the text of the normalized source
+		normalizeKeys( path, entries, strings, normalization);
+	}
+
+	uint32_t nofBuckets = entries.size() / BucketLoad + 1;
+	std::vector<uint32_t> displacements;
+	std::vector<uint32_t> slotmap;
+	uint32_t seed = 1;
+	for (; seed <= (uint32_t)MaxNofSeeds; ++seed)
+	{
+		if (buildTable( entries, strings, seed, nofBuckets, displacements, slotmap)) break;
+	}
+	if (seed > (uint32_t)MaxNofSeeds)
+	{
+		throw strus::runtime_error(_TXT("failed to build perfect hash for symbol dictionary file '%s'"), path.c_str());
+	}
+	SymbolDictionary* rt = new SymbolDictionary();
+	try
+	{
+		std::string& image = rt->m_image;
+		image.reserve( 128 + signature.size() + nofBuckets * 4 + entries.size() * 12 + strings.size());
+		Serializer::packString( image, DICTIONARY_FILE_MAGIC);
+		Serializer::packUint32( image, DictionaryFileFormatVersion);
+		Serializer::packString( image, signature);
+		Serializer::packUint32( image, normalization);
+		Serializer::packUint32( image, entries.size());
+		Serializer::packUint32( image, nofBuckets);
+		Serializer::packUint32( image, seed);
+		Serializer::packUint64( image, strings.size());
+		std::vector<uint32_t>::const_iterator di = displacements.begin(), de = displacements.end();
+		for (; di != de; ++di)
+		{
+			Serializer::packUint32( image, *di);
+		}
+		std::vector<uint32_t>::const_iterator si = slotmap.begin(), se = slotmap.end();
+		for (; si != se; ++si)
+		{
+			const DictionaryEntry& entry = entries[ *si];
+			Serializer::packUint32( image, entry.keyofs);
+			Serializer::packUint32( image, entry.keylen);
+			Serializer::packUint32( image, entry.value);
+		}
+		image.append( strings);
+		if (!rt->attach( image.c_str(), image.size(), signature))
+		{
+			throw std::runtime_error(_TXT("corrupt symbol dictionary image built"));
+		}
+		return rt;
+	}
+	catch (...)
+	{
+		delete rt;
+		throw;
+	}
+}
+
+SymbolDictionary* SymbolDictionary::map( const std::string& path, const std::string& signature)
+{
+	int fd = ::open( path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT) return 0;
+		throw strus::runtime_error(_TXT("failed to open symbol dictionary image '%s': %s"), path.c_str(), std::strerror( errno));
+	}
+	struct stat st;
+	if (0!=::fstat( fd, &st))
+	{
+		int ec = errno;
+		::close( fd);
+		throw strus::runtime_error(_TXT("failed to stat symbol dictionary image '%s': %s"), path.c_str(), std::strerror( ec));
+	}
+	if (st.st_size == 0)
+	{
+		::close( fd);
+		return 0;
+	}
+	void* mapped = ::mmap( 0, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	int ec = (mapped == MAP_FAILED) ? errno : 0;
+	::close( fd);
+	if (ec)
+	{
+		throw strus::runtime_error(_TXT("failed to map symbol dictionary image '%s': %s"), path.c_str(), std::strerror( ec));
+	}
+	SymbolDictionary* rt = new (std::nothrow) SymbolDictionary();
+	if (!rt)
+	{
+		::munmap( mapped, (std::size_t)st.st_size);
+		throw std::bad_alloc();
+	}
+	rt->m_mapped = mapped;
+	rt->m_mappedSize = (std::size_t)st.st_size;
+	if (!rt->attach( (const char*)mapped, (std::size_t)st.st_size, signature))
+	{
+		delete rt;
+		return 0;
+	}
+	return rt;
+}
+
+bool SymbolDictionary::isImageFile( const std::string& path)
+{
+	std::string magic;
+	Serializer::packString( magic, DICTIONARY_FILE_MAGIC);
+	std::vector<char> buf( magic.size());
+	FILE* fh = std::fopen( path.c_str(), "rb");
+	if (!fh) return false;
+	std::size_t nn = std::fread( &buf[0], 1, buf.size(), fh);
+	std::fclose( fh);
+	return nn == magic.size() && 0==std::memcmp( &buf[0], magic.c_str(), magic.size());
+}
+
+std::string SymbolDictionary::sourceSignature( const std::string& path, unsigned int normalization)
+{
+	struct stat st;
+	if (0!=::stat( path.c_str(), &st))
+	{
+		throw strus::runtime_error(_TXT("failed to stat symbol dictionary file '%s': %s"), path.c_str(), std::strerror( errno));
+	}
+	//... the same file referenced by different relative paths has the same signature, an image built with another normalization of the keys has a different one
+	std::string rt;
+	Serializer::packUint32( rt, normalization);
+	char* resolved = ::realpath( path.c_str(), NULL);
+	if (resolved)
+	{
+		rt.append( resolved);
+		std::free( resolved);
+	}
+	else
+	{
+		rt.append( path);
+	}
+	//... the image of a changed file is built again, a file replaced by another one gets a new inode,
+	//... one rewritten in place a new modification time in nanoseconds. The content is not read, a cache hit only maps the image
+#ifdef __APPLE__
+	uint64_t mtime_nsec = (uint64_t)st.st_mtimespec.tv_nsec;
+#else
+	uint64_t mtime_nsec = (uint64_t)st.st_mtim.tv_nsec;
+#endif
+	Serializer::packUint64( rt, (uint64_t)st.st_dev);
+	Serializer::packUint64( rt, (uint64_t)st.st_ino);
+	Serializer::packUint64( rt, (uint64_t)st.st_size);
+	Serializer::packUint64( rt, (uint64_t)st.st_mtime);
+	Serializer::packUint64( rt, mtime_nsec);
+	return rt;
+}
+
+bool SymbolDictionary::attach( const char* data, std::size_t size, const std::string& signature)
+{
+	try
+	{
+		Deserializer ds( data, size);
+		if (ds.unpackString() != DICTIONARY_FILE_MAGIC) return false;
+		if (ds.unpackUint32() != (uint32_t)DictionaryFileFormatVersion) return false;
+		if (ds.unpackString() != signature && !signature.empty()) return false;
+		m_normalization = ds.unpackUint32();
+		m_nofEntries = ds.unpackUint32();
+		m_nofBuckets = ds.unpackUint32();
+		m_seed = ds.unpackUint32();
+		m_stringsSize = ds.unpackUint64();
+		std::size_t tablesize = (std::size_t)m_nofBuckets * 4 + (std::size_t)m_nofEntries * 12;
+		if (m_nofBuckets == 0 || ds.remaining() != tablesize + m_stringsSize) return false;
+		m_buckets = (const unsigned char*)(data + size - ds.remaining());
+		m_slots = m_buckets + (std::size_t)m_nofBuckets * 4;
+		m_strings = (const char*)(m_slots + (std::size_t)m_nofEntries * 12);
+		return true;
+	}
+	catch (const std::runtime_error&)
+	{
+		//... truncated image
+		return false;
+	}
+}
+
+uint32_t SymbolDictionary::get( const char* key, std::size_t keylen) const
+{
+	if (!m_nofEntries) return 0;
+	uint64_t hash = keyHash( key, keylen, m_seed);
+	uint32_t displacement = readUint32( m_buckets + (std::size_t)bucketIndex( hash, m_nofBuckets) * 4);
+	if (!displacement) return 0;
+	uint32_t slot = (displacement & DirectSlotFlag)
+			? (displacement & ~(uint32_t)DirectSlotFlag)
+			: slotIndex( hash, displacement, m_nofEntries);
+	if (slot >= m_nofEntries) return 0;
+	const unsigned char* sl = m_slots + (std::size_t)slot * 12;
+	uint32_t keyofs = readUint32( sl);
+	uint32_t slotkeylen = readUint32( sl+4);
+	if (slotkeylen != keylen || (std::size_t)keyofs + slotkeylen > m_stringsSize) return 0;
+	if (0!=std::memcmp( m_strings + keyofs, key, keylen)) return 0;
+	return readUint32( sl+8);
+}
+
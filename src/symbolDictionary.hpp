@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Read only dictionary of symbols with a minimal perfect hash for lookup, built in bulk and mapped from a file
+/// \file "symbolDictionary.hpp"
+#ifndef _STRUS_PATTERN_SYMBOL_DICTIONARY_HPP_INCLUDED
+#define _STRUS_PATTERN_SYMBOL_DICTIONARY_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <string>
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Read only dictionary of symbols with a minimal perfect hash for lookup
+/// \note The dictionary is an image in a platform independent byte order that is either built in memory or mapped read only from a file.
+///	A mapped image is shared between all processes mapping the same file, it is not copied.
+/// \note The lookup evaluates two hash functions and compares one key, the image is a hash and displace table:
+///	the first hash selects a bucket, the displacement stored for the bucket selects the seed of the second hash or the slot of the key directly.
+class SymbolDictionary
+{
+public:
+	/// \brief Destructor, unmaps the image if mapped from a file
+	~SymbolDictionary();
+
+	/// \brief Build a dictionary from a text file
+	/// \param[in] path path of the text file with one entry per line, the symbol name followed by a tab and the symbol identifier as decimal number
+	/// \param[in] signature signature of the source stored in the image and compared when loading the image
+	/// \param[in] maxvalue maximum value of a symbol identifier allowed
+	/// \param[in] normalization normalization of the keys (bit set of NormalizedCharMap::Mode), the same as for the sources the keys are looked up from, 0 for none
+	/// \return the dictionary (with ownership)
+	/// \remark Throws on error
+	static SymbolDictionary* build( const std::string& path, const std::string& signature, uint32_t maxvalue, unsigned int normalization=0);
+
+	/// \brief Map a dictionary image from a file
+	/// \param[in] path path of the image file
+	/// \param[in] signature expected signature of the image or empty if not to check
+	/// \return the dictionary (with ownership) or NULL if the file does not exist or is not a valid image with the signature expected
+	/// \remark Throws on error
+	static SymbolDictionary* map( const std::string& path, const std::string& signature);
+
+	/// \brief Evaluate if a file is a dictionary image
+	/// \param[in] path path of the file
+	static bool isImageFile( const std::string& path);
+
+	/// \brief Get the signature identifying the source of a dictionary text file for caching its image
+	/// \param[in] path path of the text file
+	/// \param[in] normalization normalization of the keys the image is built with
+	/// \note The signature consists of the normalization, the real path, the device and inode, the size and the modification time with nanosecond resolution of the file, its content is not read
+	/// \remark Throws on error
+	static std::string sourceSignature( const std::string& path, unsigned int normalization);
+
+	/// \brief Lookup a symbol
+	/// \param[in] key pointer to the symbol name
+	/// \param[in] keylen length of the symbol name in bytes
+	/// \return the symbol identifier or 0 if not found
+	uint32_t get( const char* key, std::size_t keylen) const;
+
+	/// \brief Get the number of symbols defined
+	std::size_t size() const
+	{
+		return m_nofEntries;
+	}
+
+	/// \brief Get the normalization of the keys (bit set of NormalizedCharMap::Mode) the dictionary was built with
+	unsigned int normalization() const
+	{
+		return m_normalization;
+	}
+
+	/// \brief Get the image of the dictionary
+	const std::string& image() const
+	{
+		return m_image;
+	}
+
+private:
+	SymbolDictionary();
+	SymbolDictionary( const SymbolDictionary&){}	//... non copyable
+	void operator=( const SymbolDictionary&){}	//... non copyable
+
+	/// \brief Initialize the pointers to the tables from the image, return false if it is not valid
+	bool attach( const char* data, std::size_t size, const std::string& signature);
+
+private:
+	std::string m_image;			///< image of the dictionary if built in memory
+	void* m_mapped;				///< image of the dictionary if mapped from a file
+	std::size_t m_mappedSize;		///< size of the mapped file in bytes
+	unsigned int m_normalization;		///< normalization of the keys
+	uint32_t m_nofEntries;			///< number of entries (= number of slots)
+	uint32_t m_nofBuckets;			///< number of buckets of the first hash
+	uint32_t m_seed;			///< seed of the first hash
+	const unsigned char* m_buckets;		///< displacement per bucket (32 bit little endian)
+	const unsigned char* m_slots;		///< key offset, key length and value per slot (3 times 32 bit little endian)
+	const char* m_strings;			///< keys of the entries
+	std::size_t m_stringsSize;		///< size of the keys of the entries in bytes
+};
+
+}//namespace
+#endif
+
@@ -7,122 +7,508 @@
  */
 /// \brief Mapping of UTF-8 character set encodings to a one byte artificial charset encoding as hash
 #include "unicodeUtils.hpp"
-#include "textwolf/charset.hpp"
-#include "textwolf/sourceiterator.hpp"
-#include "textwolf/textscanner.hpp"
-#include "textwolf/cstringiterator.hpp"
-#include "textwolf/staticbuffer.hpp"
 #include "internationalization.hpp"
+#include <cstring>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace strus;
 
-void OneByteCharMap::init( const char* src, std::size_t srcsize)
+/// \brief Get the size of the prefix of a string consisting of ASCII characters only
+static std::size_t asciiPrefixSize( const char* src, std::size_t srcsize)
 {
-	typedef textwolf::TextScanner<textwolf::SrcIterator,textwolf::charset::UTF8> TextScanner;
-	textwolf::charset::UTF8 utf8;
-	textwolf::SrcIterator srcitr( src, srcsize, 0);
-	TextScanner itr( utf8, srcitr);
-	textwolf::UChar ch;
+	std::size_t si = 0;
+#if defined(__SSE2__)
+	// ... classify 16 bytes at once, the first block with a byte with the high bit set is examined bytewise
+	for (; si + 16 <= srcsize; si += 16)
+	{
+		if (_mm_movemask_epi8( _mm_loadu_si128( (const __m128i*)(const void*)(src + si)))) break;
+	}
+#else
+	for (; si + sizeof(uint64_t) <= srcsize; si += sizeof(uint64_t))
+	{
+		uint64_t block;
+		std::memcpy( &block, src + si, sizeof(block));
+		if (block & 0x8080808080808080ULL) break;
+	}
+#endif
+	for (; si < srcsize && ((unsigned char)src[ si] & 0x80) == 0; ++si){}
+	return si;
+}
 
-	value.clear();
-	posar.clear();
+/// \brief Get the size of a non ASCII character in a UTF-8 string, an invalid or incomplete sequence is treated as a character of one byte
+static std::size_t utf8CharSize( const char* src, std::size_t srcsize)
+{
+	unsigned char lead = (unsigned char)src[ 0];
+	std::size_t charsize;
+	if ((lead & 0xE0) == 0xC0) charsize = 2;
+	else if ((lead & 0xF0) == 0xE0) charsize = 3;
+	else if ((lead & 0xF8) == 0xF0) charsize = 4;
+	else return 1;
 
-	posar.push_back( 0);
-	while ((ch = *itr) != 0)
+	if (charsize > srcsize) return 1;
+	std::size_t ci = 1;
+	for (; ci < charsize; ++ci)
 	{
-		++itr;
-		if (ch <= 127)
+		if (((unsigned char)src[ ci] & 0xC0) != 0x80) return 1;
+	}
+	return charsize;
+}
+
+/// \brief Get the unicode character of a multibyte UTF-8 sequence validated by utf8CharSize
+static uint32_t utf8MultibyteChar( const char* src, std::size_t charsize)
+{
+	uint32_t rt = (unsigned char)src[0] & (0x7F >> charsize);
+	std::size_t ci = 1;
+	for (; ci < charsize; ++ci)
+	{
+		rt = (rt << 6) | ((unsigned char)src[ ci] & 0x3F);
+	}
+	return rt;
+}
+
+OneByteCodePage::OneByteCodePage( const std::vector<uint32_t>& chars_)
+	:m_starts()
+{
+	std::vector<uint32_t> chars( chars_);
+	std::sort( chars.begin(), chars.end());
+	chars.erase( std::unique( chars.begin(), chars.end()), chars.end());
+
+	// ... the intervals of the pattern characters, each one a character of its own:
+	m_starts.push_back( 0x80);
+	std::vector<uint32_t>::const_iterator ci = chars.begin(), ce = chars.end();
+	for (; ci != ce; ++ci)
+	{
+		if (*ci > m_starts.back()) m_starts.push_back( *ci);
+	}
+	if (m_starts.size() > (std::size_t)NofBytes)
+	{
+		// ... too many pattern characters, neighbours share a byte
+		std::vector<uint32_t> reduced;
+		std::size_t si = 0;
+		for (; si != (std::size_t)NofBytes; ++si)
 		{
-			value.push_back( ch);
+			reduced.push_back( m_starts[ si * m_starts.size() / NofBytes]);
 		}
-		else
+		m_starts.swap( reduced);
+	}
+	else
+	{
+		// ... the bytes left are given to the gaps after the pattern characters, the widest gaps first
+		std::vector<std::pair<uint32_t,uint32_t> > gaps;
+		std::size_t si = 0, se = m_starts.size();
+		for (; si != se; ++si)
 		{
-			value.push_back( 128 + (ch % 128));
+			uint32_t gapstart = (si == 0 && (chars.empty() || chars[0] != 0x80)) ? 0 : (m_starts[ si] + 1);
+			uint32_t gapend = (si+1 == se) ? 0x110000 : m_starts[ si+1];
+			if (gapstart && gapstart < gapend)
+			{
+				//... pairs of negative width and start for sorting the widest first
+				gaps.push_back( std::pair<uint32_t,uint32_t>( 0x110000 - (gapend - gapstart), gapstart));
+			}
 		}
-		posar.push_back( itr.getPosition());
+		std::sort( gaps.begin(), gaps.end());
+		std::size_t nofGaps = std::min( gaps.size(), (std::size_t)NofBytes - m_starts.size());
+		std::size_t gi = 0;
+		for (; gi != nofGaps; ++gi) m_starts.push_back( gaps[ gi].second);
+		std::sort( m_starts.begin(), m_starts.end());
+	}
+	uint32_t chr = 0x80;
+	for (; chr < (uint32_t)LowTableEnd; ++chr)
+	{
+		m_lowtab[ chr - 0x80] = mapHigh( chr);
+	}
+}
+
+unsigned char OneByteCodePage::mapHigh( uint32_t chr) const
+{
+	// ... the index of the last interval starting not after the character
+	std::size_t idx = std::upper_bound( m_starts.begin(), m_starts.end(), chr) - m_starts.begin();
+	return (unsigned char)(0x80 + (idx ? (idx-1) : 0));
+}
+
+void OneByteCodePage::collectChars( std::vector<uint32_t>& chars, const char* src, std::size_t srcsize)
+{
+	std::size_t si = 0;
+	while (si < srcsize)
+	{
+		si += asciiPrefixSize( src + si, srcsize - si);
+		if (si == srcsize) break;
+		std::size_t chsize = utf8CharSize( src + si, srcsize - si);
+		chars.push_back( chsize == 1 ? (uint32_t)(unsigned char)src[ si] : utf8MultibyteChar( src + si, chsize));
+		si += chsize;
 	}
 }
 
-template <class CharSet>
-static void printString( const CharSet& charset, textwolf::StaticBuffer& outbuf, std::size_t* posar, const char* src, std::size_t srcsize, int sizeofwchar)
+void OneByteCharMap::init( const char* src, std::size_t srcsize, const OneByteCodePage* codepage)
 {
-	typedef textwolf::TextScanner<textwolf::SrcIterator,textwolf::charset::UTF8> TextScanner;
-	textwolf::charset::UTF8 utf8;
-	textwolf::SrcIterator srcitr( src, srcsize, 0);
-	TextScanner itr( utf8, srcitr);
-	textwolf::UChar ch;
+	m_checkpoints.clear();
+	m_checkpoints.push_back( CharMapCheckpoint( 0, 0));
 
-	std::size_t chidx = 0;
-	while ((ch = *itr) != 0)
+	std::size_t si = asciiPrefixSize( src, srcsize);
+	if (si == srcsize)
 	{
-		++itr;
-		std::size_t pi = outbuf.size();
-		charset.print( ch, outbuf);
-		std::size_t pe = outbuf.size();
-		for (; pi < pe; pi += sizeofwchar)
+		// ... pure ASCII, the source is its own mapping
+		m_value.clear();
+		m_ptr = src;
+		m_size = srcsize;
+		return;
+	}
+	m_value.resize( 0);
+	m_value.reserve( srcsize);
+	m_value.append( src, si);
+	while (si < srcsize)
+	{
+		std::size_t chsize = utf8CharSize( src + si, srcsize - si);
+		unsigned char last = (unsigned char)src[ si + chsize - 1];
+		unsigned char chr;
+		if (codepage)
+		{
+			//... an invalid byte is mapped like the character with its value
+			chr = codepage->map( chsize == 1 ? (uint32_t)last : utf8MultibyteChar( src + si, chsize)) - 128;
+		}
+		else if (chsize == 1)
 		{
-			posar[ chidx++] = itr.getPosition();
+			chr = last & 0x7F;
 		}
+		else
+		{
+			// ... the lowest 7 bits of the unicode character are the 6 bits of the last byte and the lowest bit of the byte before
+			unsigned char prev = (unsigned char)src[ si + chsize - 2];
+			chr = ((prev & 1) << 6) | (last & 0x3F);
+		}
+		m_value.push_back( (char)(128 + chr));
+		si += chsize;
+		m_checkpoints.push_back( CharMapCheckpoint( m_value.size(), si));
+
+		std::size_t asciisize = asciiPrefixSize( src + si, srcsize - si);
+		m_value.append( src + si, asciisize);
+		si += asciisize;
 	}
+	m_ptr = m_value.c_str();
+	m_size = m_value.size();
 }
 
-WCharString::WCharString( const char* src, std::size_t srcsize)
+std::size_t OneByteCharMap::charMapOrigPos( const std::vector<CharMapCheckpoint>& ar, std::size_t pos)
 {
-	static const short be_le = 1;
-	if (srcsize >= (sizeof( m_charbuf) / sizeof( m_charbuf[0])))
+	std::size_t lo = 0, hi = ar.size();
+	// ... binary search for the last checkpoint not after pos
+	while (hi - lo > 1)
 	{
-		m_ptr = (wchar_t*)malloc( (1+srcsize) * sizeof(wchar_t));
-		m_pos = (std::size_t*)malloc( (1+srcsize) * sizeof(std::size_t));
-		if (!m_ptr || !m_pos)
+		std::size_t mid = (lo + hi) / 2;
+		if (ar[ mid].pos <= pos) lo = mid; else hi = mid;
+	}
+	return ar[ lo].origpos + (pos - ar[ lo].pos);
+}
+
+std::size_t strus::utf8CompletePrefixSize( const char* src, std::size_t srcsize)
+{
+	std::size_t si = srcsize;
+	std::size_t nofFollowBytes = 0;
+	for (; si > 0 && nofFollowBytes < 4 && ((unsigned char)src[ si-1] & 0xC0) == 0x80; --si,++nofFollowBytes){}
+	if (si == 0) return srcsize;
+
+	unsigned char lead = (unsigned char)src[ si-1];
+	std::size_t charsize;
+	if (lead < 0x80) charsize = 1;
+	else if ((lead & 0xE0) == 0xC0) charsize = 2;
+	else if ((lead & 0xF0) == 0xE0) charsize = 3;
+	else if ((lead & 0xF8) == 0xF0) charsize = 4;
+	else charsize = 1;
+	//... an invalid lead byte is treated as a complete character
+
+	return (nofFollowBytes + 1 < charsize) ? (si-1) : srcsize;
+}
+
+/// \brief Get the size of the prefix of a string consisting of ASCII characters without null bytes, converting them to wide characters
+static std::size_t convertAsciiPrefix( wchar_t* dest, const char* src, std::size_t srcsize)
+{
+	std::size_t si = 0;
+#if defined(__SSE2__)
+	if (sizeof(wchar_t) == 4)
+	{
+		// ... 16 bytes at once, zero extended to 32 bits
+		const __m128i zero = _mm_setzero_si128();
+		for (; si + 16 <= srcsize; si += 16)
 		{
-			if (m_ptr) std::free( m_ptr);
-			if (m_pos) std::free( m_pos);
-			throw std::bad_alloc();
+			__m128i chunk = _mm_loadu_si128( (const __m128i*)(const void*)(src + si));
+			if (_mm_movemask_epi8( chunk) | _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, zero))) break;
+			__m128i lo = _mm_unpacklo_epi8( chunk, zero);
+			__m128i hi = _mm_unpackhi_epi8( chunk, zero);
+			__m128i* out = (__m128i*)(void*)(dest + si);
+			_mm_storeu_si128( out+0, _mm_unpacklo_epi16( lo, zero));
+			_mm_storeu_si128( out+1, _mm_unpackhi_epi16( lo, zero));
+			_mm_storeu_si128( out+2, _mm_unpacklo_epi16( hi, zero));
+			_mm_storeu_si128( out+3, _mm_unpackhi_epi16( hi, zero));
 		}
 	}
-	else
+#endif
+	for (; si < srcsize && (unsigned char)(src[ si] - 1) < 0x7F; ++si)
 	{
-		m_ptr = m_charbuf;
-		m_pos = m_posbuf;
+		dest[ si] = (wchar_t)src[ si];
 	}
-	textwolf::StaticBuffer outbuf( (char*)m_ptr, srcsize * sizeof(wchar_t));
+	return si;
+}
 
-	if (((const char*)&be_le)[0])
+void WCharBuffer::init( const char* src, std::size_t srcsize)
+{
+	// ... a character of a UTF-8 string is converted to at most two wide characters (surrogate pair) of at least two bytes, so the size of the source plus the terminator is enough
+	if (m_buf.size() < srcsize + 1)
 	{
-		/// ... Little endian
-		if (sizeof(wchar_t) == 4)
+		m_buf.resize( srcsize + 1);
+	}
+	m_checkpoints.clear();
+	m_checkpoints.push_back( CharMapCheckpoint( 0, 0));
+
+	wchar_t* dest = &m_buf[0];
+	std::size_t di = 0;
+	std::size_t si = 0;
+	while (si < srcsize)
+	{
+		std::size_t asciisize = convertAsciiPrefix( dest + di, src + si, srcsize - si);
+		si += asciisize;
+		di += asciisize;
+		if (si == srcsize || src[ si] == 0) break;
+
+		std::size_t chsize = utf8CharSize( src + si, srcsize - si);
+		uint32_t chr = (chsize == 1) ? 0xFFFD : utf8MultibyteChar( src + si, chsize);
+		si += chsize;
+		if (sizeof(wchar_t) == 2 && chr > 0xFFFF)
 		{
-			textwolf::charset::UCS4<textwolf::charset::ByteOrder::LE> outcharset;
-			printString( outcharset, outbuf, m_pos, src, srcsize, sizeof(wchar_t));
+			chr -= 0x10000;
+			dest[ di++] = (wchar_t)(0xD800 + (chr >> 10));
+			m_checkpoints.push_back( CharMapCheckpoint( di, si));
+			dest[ di++] = (wchar_t)(0xDC00 + (chr & 0x3FF));
 		}
 		else
 		{
-			textwolf::charset::UTF16<textwolf::charset::ByteOrder::LE> outcharset;
-			printString( outcharset, outbuf, m_pos, src, srcsize, sizeof(wchar_t));
+			dest[ di++] = (wchar_t)chr;
 		}
+		m_checkpoints.push_back( CharMapCheckpoint( di, si));
 	}
-	else
+	dest[ di] = 0;
+	m_size = di;
+}
+
+
+/// \brief Copy the prefix of a string consisting of ASCII characters lowercased
+/// \return the size of the prefix copied
+static std::size_t foldAsciiPrefix( char* dest, const char* src, std::size_t srcsize)
+{
+	std::size_t si = 0;
+#if defined(__SSE2__)
+	// ... 16 bytes at once, the bit 0x20 is set for the uppercase letters
+	const __m128i beforeA = _mm_set1_epi8( 'A'-1);
+	const __m128i afterZ = _mm_set1_epi8( 'Z'+1);
+	const __m128i caseBit = _mm_set1_epi8( 0x20);
+	for (; si + 16 <= srcsize; si += 16)
+	{
+		__m128i chunk = _mm_loadu_si128( (const __m128i*)(const void*)(src + si));
+		if (_mm_movemask_epi8( chunk)) break;
+		__m128i upper = _mm_and_si128( _mm_cmpgt_epi8( chunk, beforeA), _mm_cmplt_epi8( chunk, afterZ));
+		_mm_storeu_si128( (__m128i*)(void*)(dest + si), _mm_or_si128( chunk, _mm_and_si128( upper, caseBit)));
+	}
+#endif
+	for (; si < srcsize && ((unsigned char)src[ si] & 0x80) == 0; ++si)
+	{
+		unsigned char ch = (unsigned char)src[ si];
+		dest[ si] = (char)((ch >= 'A' && ch <= 'Z') ? (ch | 0x20) : ch);
+	}
+	return si;
+}
+
+/// \brief Simple case folding of a non ASCII character of the Latin, Greek or Cyrillic script
+static uint32_t caseFoldChar( uint32_t chr)
+{
+	if (chr < 0x100)
+	{
+		if (chr >= 0xC0 && chr <= 0xDE && chr != 0xD7) return chr + 0x20;
+		if (chr == 0xB5) return 0x3BC;
+		return chr;
+	}
+	if (chr < 0x180)
+	{
+		// ... Latin Extended-A, pairs of upper- and lowercase letters with a few exceptions
+		if (chr == 0x130) return 'i';
+		if (chr == 0x131 || chr == 0x138 || chr == 0x149) return chr;
+		if (chr == 0x178) return 0xFF;
+		if (chr == 0x17F) return 's';
+		if ((chr >= 0x139 && chr <= 0x148) || (chr >= 0x179 && chr <= 0x17E)) return (chr & 1) ? (chr + 1) : chr;
+		return (chr & 1) ? chr : (chr + 1);
+	}
+	if (chr >= 0x386 && chr < 0x3D0)
+	{
+		// ... Greek
+		if (chr == 0x386) return 0x3AC;
+		if (chr >= 0x388 && chr <= 0x38A) return chr + 0x25;
+		if (chr == 0x38C) return 0x3CC;
+		if (chr == 0x38E || chr == 0x38F) return chr + 0x3F;
+		if (chr >= 0x391 && chr <= 0x3AB && chr != 0x3A2) return chr + 0x20;
+		if (chr == 0x3C2) return 0x3C3;
+		return chr;
+	}
+	if (chr >= 0x400 && chr < 0x530)
+	{
+		// ... Cyrillic
+		if (chr < 0x410) return chr + 0x50;
+		if (chr < 0x430) return chr + 0x20;
+		if (chr < 0x460) return chr;
+		if (chr == 0x4C0) return 0x4CF;
+		if (chr >= 0x4C1 && chr <= 0x4CE) return (chr & 1) ? (chr + 1) : chr;
+		if (chr <= 0x481 || (chr >= 0x48A && chr <= 0x4BF) || chr >= 0x4D0) return (chr & 1) ? chr : (chr + 1);
+		return chr;
+	}
+	if (chr >= 0x1E00 && chr < 0x1F00)
+	{
+		// ... Latin Extended Additional
+		if (chr == 0x1E9E) return 0xDF;
+		if (chr >= 0x1E96 && chr < 0x1EA0) return chr;
+		return (chr & 1) ? chr : (chr + 1);
+	}
+	if (chr >= 0xFF21 && chr <= 0xFF3A) return chr + 0x20;
+	return chr;
+}
+
+/// \brief Base letters of the lowercase letters with diacritics of the Latin-1 supplement (U+00C0..U+00FF), '.' for characters without
+static const char g_latin1BaseLetters[ 65] =
+	"aaaaaa.ceeeeiiii" ".nooooo.ouuuuy.."
+	"aaaaaa.ceeeeiiii" ".nooooo.ouuuuy.y";
+
+/// \brief Base letters of the lowercase letters with diacritics of Latin Extended-A (U+0100..U+017F), '.' for characters without
+static const char g_latinExtABaseLetters[ 129] =
+	"aaaaaaccccccccdd" "ddeeeeeeeeeegggg" "gggghhhhiiiiiiii" "ii..jjkk.lllllll"
+	"llllnnnnnn..oooo" "oo..rrrrrrssssss" "ssttttttuuuuuuuu" "uuuuwwyyyzzzzzzs";
+
+/// \brief Map a case folded character to its base letter without diacritics
+/// \return the base letter, the character itself if it has none or 0 if it is a combining diacritical mark to remove
+static uint32_t baseLetterChar( uint32_t chr)
+{
+	if (chr >= 0xC0 && chr < 0x100)
+	{
+		char base = g_latin1BaseLetters[ chr - 0xC0];
+		return base == '.' ? chr : (uint32_t)(unsigned char)base;
+	}
+	if (chr >= 0x100 && chr < 0x180)
 	{
-		/// ... Big endian
-		if (sizeof(wchar_t) == 4)
+		char base = g_latinExtABaseLetters[ chr - 0x100];
+		return base == '.' ? chr : (uint32_t)(unsigned char)base;
+	}
+	if (chr >= 0x300 && chr < 0x370) return 0;
+	switch (chr)
+	{
+		// ... Greek letters with tonos or dialytika
+		case 0x390: return 0x3B9;
+		case 0x3AC: return 0x3B1;
+		case 0x3AD: return 0x3B5;
+		case 0x3AE: return 0x3B7;
+		case 0x3AF: return 0x3B9;
+		case 0x3B0: return 0x3C5;
+		case 0x3CA: return 0x3B9;
+		case 0x3CB: return 0x3C5;
+		case 0x3CC: return 0x3BF;
+		case 0x3CD: return 0x3C5;
+		case 0x3CE: return 0x3C9;
+		// ... Cyrillic io
+		case 0x451: return 0x435;
+		default: return chr;
+	}
+}
+
+/// \brief Write a unicode character as UTF-8
+/// \return the number of bytes written
+static std::size_t utf8EncodeChar( char* dest, uint32_t chr)
+{
+	if (chr < 0x80)
+	{
+		dest[0] = (char)chr;
+		return 1;
+	}
+	if (chr < 0x800)
+	{
+		dest[0] = (char)(0xC0 | (chr >> 6));
+		dest[1] = (char)(0x80 | (chr & 0x3F));
+		return 2;
+	}
+	if (chr < 0x10000)
+	{
+		dest[0] = (char)(0xE0 | (chr >> 12));
+		dest[1] = (char)(0x80 | ((chr >> 6) & 0x3F));
+		dest[2] = (char)(0x80 | (chr & 0x3F));
+		return 3;
+	}
+	dest[0] = (char)(0xF0 | (chr >> 18));
+	dest[1] = (char)(0x80 | ((chr >> 12) & 0x3F));
+	dest[2] = (char)(0x80 | ((chr >> 6) & 0x3F));
+	dest[3] = (char)(0x80 | (chr & 0x3F));
+	return 4;
+}
+
+void NormalizedCharMap::init( const char* src, std::size_t srcsize, unsigned int mode)
+{
+	m_checkpoints.clear();
+	m_checkpoints.push_back( CharMapCheckpoint( 0, 0));
+
+	// ... no character is normalized to more bytes than it has in the source, so the size of the source is enough
+	m_value.resize( srcsize);
+	char* dest = srcsize ? &m_value[0] : 0;
+	std::size_t di = 0;
+	std::size_t si = 0;
+	while (si < srcsize)
+	{
+		std::size_t asciisize = foldAsciiPrefix( dest + di, src + si, srcsize - si);
+		si += asciisize;
+		di += asciisize;
+		if (si == srcsize) break;
+
+		std::size_t chsize = utf8CharSize( src + si, srcsize - si);
+		if (chsize == 1)
 		{
-			textwolf::charset::UCS4<textwolf::charset::ByteOrder::BE> outcharset;
-			printString( outcharset, outbuf, m_pos, src, srcsize, sizeof(wchar_t));
+			dest[ di++] = src[ si++];
+			continue;
 		}
-		else
+		uint32_t chr = caseFoldChar( utf8MultibyteChar( src + si, chsize));
+		if (mode & StripDiacritics)
+		{
+			chr = baseLetterChar( chr);
+		}
+		std::size_t normsize = chr ? utf8EncodeChar( dest + di, chr) : 0;
+		si += chsize;
+		di += normsize;
+		if (normsize != chsize)
 		{
-			textwolf::charset::UTF16<textwolf::charset::ByteOrder::BE> outcharset;
-			printString( outcharset, outbuf, m_pos, src, srcsize, sizeof(wchar_t));
+			m_checkpoints.push_back( CharMapCheckpoint( di, si));
 		}
 	}
-	m_size = outbuf.size() / sizeof(wchar_t);
-	m_ptr[ m_size] = 0;
+	m_value.resize( di);
 }
 
-WCharString::~WCharString()
+std::string NormalizedCharMap::normalizeExpression( const std::string& expression, unsigned int mode)
 {
-	if (m_pos && m_pos != m_posbuf) std::free( m_pos);
-	if (m_ptr && m_ptr != m_charbuf) std::free( m_ptr);
-}
-
+	std::string rt;
+	NormalizedCharMap map;
+	char const* ei = expression.c_str();
+	const char* ee = ei + expression.size();
+	while (ei != ee)
+	{
+		// ... the text up to the next escape sequence is normalized
+		const char* next = (const char*)std::memchr( ei, '\\', ee - ei);
+		if (!next) next = ee;
+		map.init( ei, next - ei, mode);
+		rt.append( map.data(), map.size());
+		ei = next;
+		if (ei == ee) break;
 
+		// ... the escape sequence is copied, with its argument in curly brackets if it has one
+		const char* eend = (ei + 2 > ee) ? ee : (ei + 2);
+		if (eend < ee && *eend == '{' && ei[1] && 0!=std::strchr( "xopPN", ei[1]))
+		{
+			const char* bend = (const char*)std::memchr( eend, '}', ee - eend);
+			eend = bend ? (bend + 1) : ee;
+		}
+		rt.append( ei, eend - ei);
+		ei = eend;
+	}
+	return rt;
+}
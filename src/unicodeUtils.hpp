@@ -9,40 +9,174 @@
 /// \file "oneByteCharMap.hpp"
 #ifndef _STRUS_PATTERN_CODEPAGES_IMPLEMENTATION_HPP_INCLUDED
 #define _STRUS_PATTERN_CODEPAGES_IMPLEMENTATION_HPP_INCLUDED
+#include "strus/base/stdint.h"
 #include <string>
 #include <vector>
 #include <cwchar>
 
 namespace strus {
 
+/// \brief Position in a string mapped to a one byte character set with the corresponding position in its UTF-8 source
+struct CharMapCheckpoint
+{
+	uint32_t pos;		///< position in the mapped string
+	uint32_t origpos;	///< position in the source
+
+	CharMapCheckpoint( uint32_t pos_, uint32_t origpos_)
+		:pos(pos_),origpos(origpos_){}
+};
+
+/// \brief Code page of the upper half of a one byte character set, mapping intervals of non ASCII characters to one byte each
+/// \remark The mapping preserves the order of the characters, so that a character class range of a pattern is mapped to a range containing the bytes of all characters in it
+/// \remark The code page is derived from the characters of the patterns, each pattern character gets a byte of its own and the characters between them another one as long as there are enough bytes.
+///	The characters of a source that do not occur in the patterns then never collide with a pattern character.
+class OneByteCodePage
+{
+public:
+	/// \brief Build a code page
+	/// \param[in] chars non ASCII characters occurring in the patterns, in any order and with duplicates
+	explicit OneByteCodePage( const std::vector<uint32_t>& chars);
+
+	/// \brief Get the byte of a non ASCII character
+	unsigned char map( uint32_t chr) const
+	{
+		if (chr < (uint32_t)LowTableEnd) return m_lowtab[ chr - 0x80];
+		return mapHigh( chr);
+	}
+
+	/// \brief Get the number of bytes used
+	std::size_t size() const				{return m_starts.size();}
+
+	/// \brief Collect the non ASCII characters of a UTF-8 string
+	/// \param[in,out] chars where to append the characters to
+	/// \param[in] src pointer to the UTF-8 string
+	/// \param[in] srcsize size of the string in bytes
+	static void collectChars( std::vector<uint32_t>& chars, const char* src, std::size_t srcsize);
+
+private:
+	unsigned char mapHigh( uint32_t chr) const;
+
+private:
+	enum {LowTableEnd=0x800, NofBytes=128};
+	std::vector<uint32_t> m_starts;			///< first character of each interval mapped to one byte, ascending, starting with 0x80
+	unsigned char m_lowtab[ LowTableEnd - 0x80];	///< bytes of the characters encoded with two bytes in UTF-8 for a mapping without search
+};
+
+/// \brief Mapping of a UTF-8 string to a one byte character set, each character mapped to one byte
+/// \remark ASCII characters are mapped to themselves, a source that is pure ASCII is not copied at all
+/// \remark The positions are mapped back to the source with checkpoints after every multibyte character, positions between checkpoints have the same distance in the mapped string as in the source
 class OneByteCharMap
 {
 public:
 	OneByteCharMap()
-		:value(),posar(){}
+		:m_value(),m_checkpoints(),m_ptr(0),m_size(0){}
 
-	void init( const char* src, std::size_t srcsize);
+	/// \brief Map a source
+	/// \param[in] src pointer to the UTF-8 source, has to stay valid as long as the map is used, because it is referenced if the source is pure ASCII
+	/// \param[in] srcsize size of the source in bytes
+	/// \param[in] codepage code page of the non ASCII characters or NULL for mapping the lowest 7 bits of the characters
+	void init( const char* src, std::size_t srcsize, const OneByteCodePage* codepage=0);
+
+	/// \brief Get the string mapped, not null terminated
+	const char* data() const				{return m_ptr;}
+	/// \brief Get the size of the string mapped in bytes
+	std::size_t size() const				{return m_size;}
+
+	/// \brief Get the checkpoints of the mapping, starting with (0,0)
+	const std::vector<CharMapCheckpoint>& checkpoints() const	{return m_checkpoints;}
 
-	std::string value;
-	std::vector<std::size_t> posar;
+	/// \brief Get the position in the source of a position in the mapped string
+	std::size_t origpos( std::size_t pos) const		{return charMapOrigPos( m_checkpoints, pos);}
+
+	/// \brief Get the position in the source of a position in the mapped string
+	/// \param[in] ar ascending list of checkpoints, the first one not after pos
+	/// \param[in] pos position in the mapped string
+	static std::size_t charMapOrigPos( const std::vector<CharMapCheckpoint>& ar, std::size_t pos);
+
+private:
+	std::string m_value;
+	std::vector<CharMapCheckpoint> m_checkpoints;
+	const char* m_ptr;
+	std::size_t m_size;
 };
 
-struct WCharString
+/// \brief Normalization of a UTF-8 string by case folding and optionally removing diacritics, with the positions mapped back to the source
+/// \remark The case folding is simple (one character to one character) and covers the Latin, Greek and Cyrillic scripts, other characters are copied as they are
+/// \remark The positions are mapped back to the source with checkpoints after every character that changes its size in bytes, positions between checkpoints have the same distance in the normalized string as in the source
+class NormalizedCharMap
 {
 public:
-	WCharString( const char* src, std::size_t srcsize);
-	~WCharString();
+	/// \brief Normalization steps, combined as bit set
+	enum Mode
+	{
+		CaseFold=0x1,			///< lowercase and case fold the characters, always done
+		StripDiacritics=0x2		///< map letters with diacritics to their base letter and remove combining diacritical marks, after case folding
+	};
+
+	NormalizedCharMap()
+		:m_value(),m_checkpoints(){}
+
+	/// \brief Normalize a source
+	/// \param[in] src pointer to the UTF-8 source
+	/// \param[in] srcsize size of the source in bytes
+	/// \param[in] mode normalization steps (bit set of Mode)
+	/// \note An invalid UTF-8 sequence is copied byte by byte
+	void init( const char* src, std::size_t srcsize, unsigned int mode);
+
+	/// \brief Get the string normalized, not null terminated
+	const char* data() const				{return m_value.c_str();}
+	/// \brief Get the size of the string normalized in bytes
+	std::size_t size() const				{return m_value.size();}
+
+	/// \brief Get the checkpoints of the mapping, starting with (0,0)
+	const std::vector<CharMapCheckpoint>& checkpoints() const	{return m_checkpoints;}
+
+	/// \brief Get the position in the source of a position in the normalized string
+	std::size_t origpos( std::size_t pos) const		{return OneByteCharMap::charMapOrigPos( m_checkpoints, pos);}
+
+	/// \brief Normalize a regular expression, the characters of escape sequences are left untouched
+	/// \param[in] expression regular expression in UTF-8
+	/// \param[in] mode normalization steps (bit set of Mode)
+	/// \return the expression matching the normalized strings
+	static std::string normalizeExpression( const std::string& expression, unsigned int mode);
+
+private:
+	std::string m_value;
+	std::vector<CharMapCheckpoint> m_checkpoints;
+};
+
+/// \brief Get the size of the prefix of a UTF-8 string that does not end with an incomplete multibyte character
+/// \param[in] src pointer to the UTF-8 string
+/// \param[in] srcsize size of the string in bytes
+/// \return the size of the string without an incomplete character at its end
+std::size_t utf8CompletePrefixSize( const char* src, std::size_t srcsize);
+
+/// \brief Reusable buffer for the conversion of UTF-8 strings to wide character strings
+/// \remark The buffers grow to the largest string converted and are not freed between conversions
+/// \remark The positions are mapped back to the source with checkpoints after every multibyte character like in OneByteCharMap
+class WCharBuffer
+{
+public:
+	WCharBuffer()
+		:m_buf(),m_checkpoints(),m_size(0){}
+
+	/// \brief Convert a UTF-8 string
+	/// \param[in] src pointer to the UTF-8 string
+	/// \param[in] srcsize maximum size of the string in bytes, the conversion ends at a null byte
+	/// \note An invalid or incomplete UTF-8 sequence is converted to one replacement character (U+FFFD) for its first byte
+	void init( const char* src, std::size_t srcsize);
 
-	wchar_t* str() const					{return m_ptr;}
+	/// \brief Get the null terminated wide character string converted
+	const wchar_t* str() const				{return &m_buf[0];}
+	/// \brief Get the number of wide characters converted
 	std::size_t size() const				{return m_size;}
-	std::size_t origpos( std::size_t wcharpos) const	{return wcharpos ? ((wcharpos > m_size) ? m_posbuf[ m_size-1]:m_posbuf[ wcharpos-1]):0;}
+	/// \brief Get the position in the source of the end of the wide character before a position
+	std::size_t origpos( std::size_t wcharpos) const	{return OneByteCharMap::charMapOrigPos( m_checkpoints, wcharpos > m_size ? m_size : wcharpos);}
 
 private:
-	wchar_t* m_ptr;
-	std::size_t* m_pos;
+	std::vector<wchar_t> m_buf;
+	std::vector<CharMapCheckpoint> m_checkpoints;
 	std::size_t m_size;
-	std::size_t m_posbuf[ 1024];
-	wchar_t m_charbuf[ 1024];
 };
 
 }//namespace
@@ -12,6 +12,16 @@
 #include "strus/patternLexerInterface.hpp"
 #include "strus/patternLexerInstanceInterface.hpp"
 #include "strus/patternLexerContextInterface.hpp"
+#include "strus/patternLexerContextExtInterface.hpp"
+#include "strus/patternLexemSinkInterface.hpp"
+#include "strus/patternMatcherInterface.hpp"
+#include "strus/patternMatcherInstanceInterface.hpp"
+#include "strus/patternMatcherContextInterface.hpp"
+#include "strus/patternMatchPipelineInterface.hpp"
+#include "strus/analyzer/patternMatcherResult.hpp"
+#include "strus/analyzer/patternMatcherStatistics.hpp"
+#include "strus/patternLexerInstanceExtInterface.hpp"
+#include "strus/patternLexerStreamContextInterface.hpp"
 #include "strus/analyzer/patternLexem.hpp"
 #include "strus/base/local_ptr.hpp"
 #include <stdexcept>
@@ -20,6 +30,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <memory>
@@ -27,11 +38,68 @@
 #include <ctime>
 #include <cstring>
 #include <iomanip>
+#include <algorithm>
+#include <time.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
 strus::ErrorBufferInterface* g_errorBuffer = 0;
 
+/// \brief Temporary directory for the files written by the tests (cache entries and dictionary files), created fresh for every run and removed with its files at exit
+class TempDirectory
+{
+public:
+	TempDirectory()
+		:m_path(){}
+
+	~TempDirectory()
+	{
+		if (m_path.empty()) return;
+		DIR* dir = ::opendir( m_path.c_str());
+		if (dir)
+		{
+			struct dirent* entry;
+			while (0!=(entry = ::readdir( dir)))
+			{
+				if (0==std::strcmp( entry->d_name, ".") || 0==std::strcmp( entry->d_name, "..")) continue;
+				std::string filepath = m_path + "/" + entry->d_name;
+				std::remove( filepath.c_str());
+			}
+			::closedir( dir);
+		}
+		::rmdir( m_path.c_str());
+	}
+
+	/// \brief Create the directory
+	void create()
+	{
+		const char* tmpdir = ::getenv( "TMPDIR");
+		std::string pattern = std::string( tmpdir && tmpdir[0] ? tmpdir : "/tmp") + "/strusPatternTestXXXXXX";
+		std::vector<char> buf( pattern.c_str(), pattern.c_str() + pattern.size() + 1);
+		if (!::mkdtemp( &buf[0])) throw std::runtime_error("failed to create temporary directory for the tests");
+		m_path = &buf[0];
+	}
+
+	/// \brief Get the path of a file in the directory
+	std::string filePath( const std::string& name) const
+	{
+		return m_path + "/" + name;
+	}
+
+	const std::string& path() const
+	{
+		return m_path;
+	}
+
+private:
+	std::string m_path;
+};
+
+static TempDirectory g_tempDirectory;
+
 struct PatternDef
 {
 	unsigned int id;
@@ -102,6 +170,513 @@ static std::vector<strus::analyzer::PatternLexem>
 	return rt;
 }
 
+static std::vector<strus::analyzer::PatternLexem>
+	matchStream( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, std::size_t chunksize)
+{
+	strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst);
+	if (!ptinstext) throw std::runtime_error("lexer instance does not implement the stream interface");
+	strus::local_ptr<strus::PatternLexerStreamContextInterface> mt( ptinstext->createStreamContext());
+	if (!mt.get()) throw std::runtime_error("failed to create lexer stream context");
+
+	std::vector<strus::analyzer::PatternLexem> rt;
+	std::size_t pos = 0;
+	for (; pos < src.size(); pos += chunksize)
+	{
+		std::size_t size = (pos + chunksize > src.size()) ? (src.size() - pos) : chunksize;
+		mt->putInput( src.c_str() + pos, size);
+		std::vector<strus::analyzer::PatternLexem> part = mt->fetchResults();
+		rt.insert( rt.end(), part.begin(), part.end());
+	}
+	mt->close();
+	std::vector<strus::analyzer::PatternLexem> rest = mt->fetchResults();
+	rt.insert( rt.end(), rest.begin(), rest.end());
+	return rt;
+}
+
+static bool isEqual( const std::vector<strus::analyzer::PatternLexem>& res1, const std::vector<strus::analyzer::PatternLexem>& res2)
+{
+	if (res1.size() != res2.size()) return false;
+	std::vector<strus::analyzer::PatternLexem>::const_iterator ri1 = res1.begin(), re1 = res1.end(), ri2 = res2.begin();
+	for (; ri1 != re1; ++ri1,++ri2)
+	{
+		if (ri1->id() != ri2->id()) return false;
+		if (ri1->ordpos() != ri2->ordpos()) return false;
+		if (ri1->origpos().ofs() != ri2->origpos().ofs()) return false;
+		if (ri1->origsize() != ri2->origsize()) return false;
+	}
+	return true;
+}
+
+/// \brief Check that the patterns of a test compiled with the option "STREAM" give the same result matched in chunks of different sizes as matched as a whole
+static bool matchStreamEqual( strus::PatternLexerInterface* pt, const TestDef& test, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "DOTALL", 0);
+	ptinst->defineOption( "STREAM", 0);
+	compile( ptinst.get(), test.patterns, test.symbols);
+
+	std::size_t chunksize = 1;
+	for (; chunksize <= 16; chunksize *= 2)
+	{
+		std::vector<strus::analyzer::PatternLexem> streamResult = matchStream( ptinst.get(), test.src, chunksize);
+		if (g_errorBuffer->hasError())
+		{
+			throw std::runtime_error( "error matching stream");
+		}
+		if (!isEqual( expected, streamResult)) return false;
+	}
+	return true;
+}
+
+static bool matchBatchEqual( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the batch interface");
+
+	// ... batch of the source, an empty source and the source again:
+	const char* srcar[3] = {src.c_str(), "", src.c_str()};
+	std::size_t srcsizear[3] = {src.size(), 0, src.size()};
+	std::vector<strus::analyzer::PatternLexem> result;
+	std::vector<std::size_t> resultidxar;
+	if (!mtext->matchBatch( srcar, srcsizear, 3, result, resultidxar))
+	{
+		throw std::runtime_error( "error matching batch");
+	}
+	if (resultidxar.size() != 4 || resultidxar[3] != result.size()) return false;
+	std::size_t si = 0;
+	for (; si < 3; ++si)
+	{
+		std::vector<strus::analyzer::PatternLexem> part( result.begin() + resultidxar[si], result.begin() + resultidxar[si+1]);
+		if (!isEqual( part, si == 1 ? std::vector<strus::analyzer::PatternLexem>() : expected)) return false;
+	}
+	return true;
+}
+
+class LexemCollector
+	:public strus::PatternLexemSinkInterface
+{
+public:
+	virtual ~LexemCollector(){}
+	virtual void pushLexem( unsigned int id, unsigned int ordpos, const strus::analyzer::Position& origpos, unsigned int origsize)
+	{
+		result.push_back( strus::analyzer::PatternLexem( id, ordpos, origpos, origsize));
+	}
+
+	std::vector<strus::analyzer::PatternLexem> result;
+};
+
+static double statisticsValue( const strus::analyzer::PatternMatcherStatistics& stats, const char* name)
+{
+	std::vector<strus::analyzer::PatternMatcherStatistics::Item>::const_iterator si = stats.items().begin(), se = stats.items().end();
+	for (; si != se; ++si)
+	{
+		if (0==std::strcmp( si->name(), name)) return si->value();
+	}
+	return 0.0;
+}
+
+static bool matchOutputEqual( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the output interface");
+
+	std::vector<strus::analyzer::PatternLexem> buffer;
+	int ii = 0;
+	for (; ii < 2; ++ii)
+	{
+		// ... second round with the buffer reused
+		if (!mtext->matchToBuffer( src.c_str(), src.size(), buffer))
+		{
+			throw std::runtime_error( "error matching to buffer");
+		}
+		if (!isEqual( buffer, expected)) return false;
+	}
+	// ... the approximative rematches of the second round are all found in the cache:
+	strus::analyzer::PatternMatcherStatistics stats = mtext->getStatistics();
+	if (statisticsValue( stats, "nofRematchCacheLookups") > 0 && statisticsValue( stats, "rematchCacheHitRate") < 0.5) return false;
+	LexemCollector collector;
+	if (!mtext->matchToSink( src.c_str(), src.size(), &collector))
+	{
+		throw std::runtime_error( "error matching to sink");
+	}
+	if (!isEqual( collector.result, expected)) return false;
+	// ... the context reset keeps its scratch space:
+	mt->reset();
+	if (!mtext->matchToBuffer( src.c_str(), src.size(), buffer))
+	{
+		throw std::runtime_error( "error matching to buffer after reset");
+	}
+	return isEqual( buffer, expected);
+}
+
+static bool isEqual( const std::vector<strus::analyzer::PatternMatcherResult>& res1, const std::vector<strus::analyzer::PatternMatcherResult>& res2)
+{
+	if (res1.size() != res2.size()) return false;
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator ri1 = res1.begin(), re1 = res1.end(), ri2 = res2.begin();
+	for (; ri1 != re1; ++ri1,++ri2)
+	{
+		if (0!=std::strcmp( ri1->name(), ri2->name())) return false;
+		if (ri1->ordpos() != ri2->ordpos() || ri1->ordend() != ri2->ordend()) return false;
+		if (ri1->origpos().ofs() != ri2->origpos().ofs() || ri1->origend().ofs() != ri2->origend().ofs()) return false;
+	}
+	return true;
+}
+
+/// \brief Check that the pipeline feeding the lexems directly to a pattern matcher has the same result as feeding the lexems returned by the lexer
+static bool matchPipelineEqual( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, const std::vector<strus::analyzer::PatternLexem>& lexems)
+{
+	strus::local_ptr<strus::PatternMatcherInterface> pm( strus::createPatternMatcher_std( g_errorBuffer));
+	if (!pm.get()) throw std::runtime_error("failed to create pattern matcher");
+	strus::local_ptr<strus::PatternMatcherInstanceInterface> pminst( pm->createInstance());
+	if (!pminst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+
+	// ... a pattern for each pair of lexems with the same id following each other:
+	std::set<unsigned int> idset;
+	std::vector<strus::analyzer::PatternLexem>::const_iterator li = lexems.begin(), le = lexems.end();
+	for (; li != le; ++li) idset.insert( li->id());
+	std::set<unsigned int>::const_iterator ii = idset.begin(), ie = idset.end();
+	for (; ii != ie; ++ii)
+	{
+		pminst->pushTerm( *ii);
+		pminst->pushTerm( *ii);
+		pminst->pushExpression( strus::PatternMatcherInstanceInterface::OpSequence, 2, 2/*range*/, 0/*cardinality*/);
+		std::ostringstream ptname;
+		ptname << "pair" << *ii;
+		pminst->definePattern( ptname.str(), ""/*formatstring*/, true/*visible*/);
+	}
+	if (!pminst->compile()) throw std::runtime_error("failed to compile pattern matcher");
+
+	strus::local_ptr<strus::PatternMatcherContextInterface> mt( pminst->createContext());
+	if (!mt.get()) throw std::runtime_error("failed to create pattern matcher context");
+	for (li = lexems.begin(); li != le; ++li)
+	{
+		mt->putInput( *li);
+	}
+	std::vector<strus::analyzer::PatternMatcherResult> expected = mt->fetchResults();
+
+	strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst);
+	if (!ptinstext) throw std::runtime_error("lexer instance does not implement the pipeline interface");
+	strus::local_ptr<strus::PatternMatchPipelineInterface> pipeline( ptinstext->createMatchPipeline( pminst.get()));
+	if (!pipeline.get()) throw std::runtime_error("failed to create pattern match pipeline");
+	int ri = 0;
+	for (; ri < 2; ++ri)
+	{
+		// ... second round with the pipeline reused
+		std::vector<strus::analyzer::PatternMatcherResult> result = pipeline->match( src.c_str(), src.size());
+		if (g_errorBuffer->hasError()) throw std::runtime_error("error in pattern match pipeline");
+		if (!isEqual( result, expected)) return false;
+	}
+	// ... an error left in the buffer by an unrelated call does not fail the document:
+	g_errorBuffer->report( 0, "error of an unrelated call");
+	std::vector<strus::analyzer::PatternMatcherResult> result = pipeline->match( src.c_str(), src.size());
+	(void)g_errorBuffer->fetchError();
+	return isEqual( result, expected);
+}
+
+/// \brief Check that the patterns of a test split into shards compiled in parallel give the same result as the patterns compiled as a whole
+static bool matchShardedEqual( strus::PatternLexerInterface* pt, const TestDef& test, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "DOTALL", 0);
+	ptinst->defineOption( "STREAM", 0);
+	ptinst->defineOption( "SHARDS", 3);
+	ptinst->defineOption( "STATISTICS", 0);
+	compile( ptinst.get(), test.patterns, test.symbols);
+
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the statistics interface");
+	std::vector<strus::analyzer::PatternLexem> result = mt->match( test.src, std::strlen( test.src));
+	std::vector<strus::analyzer::PatternLexem> streamResult = matchStream( ptinst.get(), test.src, 4);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with patterns split into shards");
+
+	// ... the scan time is reported per shard with the option "STATISTICS":
+	strus::analyzer::PatternMatcherStatistics stats = mtext->getStatistics();
+	std::vector<strus::analyzer::PatternMatcherStatistics::Item>::const_iterator si = stats.items().begin(), se = stats.items().end();
+	for (; si != se && 0!=std::strcmp( si->name(), "scanTimeShard3"); ++si){}
+	if (si == se) return false;
+	return isEqual( result, expected) && isEqual( streamResult, expected);
+}
+
+/// \brief Check that the patterns of a test compiled with a cache directory give the same result when stored and when loaded from the cache
+static bool matchCachedEqual( strus::PatternLexerInterface* pt, const TestDef& test, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	int ci = 0;
+	for (; ci < 2; ++ci)
+	{
+		// ... the second compilation loads the automata and the analysis of the patterns stored by the first one
+		strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+		if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+		strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst.get());
+		if (!ptinstext) throw std::runtime_error("lexer instance does not implement the cache interface");
+		ptinst->defineOption( "DOTALL", 0);
+		ptinst->defineOption( "STREAM", 0);
+		ptinstext->defineCacheDirectory( g_tempDirectory.path());
+		compile( ptinst.get(), test.patterns, test.symbols);
+		std::vector<strus::analyzer::PatternLexem> result = match( ptinst.get(), test.src);
+		if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with automata of the cache");
+		if (!isEqual( result, expected)) return false;
+	}
+	return true;
+}
+
+/// \brief Check that the patterns of a test compiled in two layers, before and after merging them, give the same result as compiled at once
+static bool matchLayeredEqual( strus::PatternLexerInterface* pt, const TestDef& test, const std::vector<strus::analyzer::PatternLexem>& expected)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst.get());
+	if (!ptinstext) throw std::runtime_error("lexer instance does not implement the layer interface");
+	ptinst->defineOption( "DOTALL", 0);
+	ptinst->defineOption( "STREAM", 0);
+
+	std::size_t nofPatterns = 0;
+	for (; test.patterns[nofPatterns].expression; ++nofPatterns){}
+	strus::local_ptr<strus::PatternLexerContextInterface> mt;
+	std::size_t pi = 0;
+	for (; pi != nofPatterns; ++pi)
+	{
+		if (pi == nofPatterns / 2)
+		{
+			// ... the first half of the patterns is the base layer, a context created on it has to pick up the second layer
+			if (!ptinst->compile()) throw std::runtime_error("error building base layer of term match automaton");
+			mt.reset( ptinst->createContext());
+			if (!mt.get()) throw std::runtime_error("failed to create lexer context");
+		}
+		const PatternDef& pdef = test.patterns[ pi];
+		ptinst->defineLexem( pdef.id, pdef.expression, pdef.resultIndex, pdef.level, pdef.haspos ? strus::analyzer::BindContent : strus::analyzer::BindPredecessor);
+	}
+	for (pi=0; test.symbols[pi].name; ++pi)
+	{
+		ptinst->defineSymbol( test.symbols[pi].id, test.symbols[pi].patternid, test.symbols[pi].name);
+	}
+	if (!ptinst->compile()) throw std::runtime_error("error building layer of term match automaton");
+	if (!mt.get()) mt.reset( ptinst->createContext());
+	std::vector<strus::analyzer::PatternLexem> result = mt->match( test.src, std::strlen( test.src));
+	std::vector<strus::analyzer::PatternLexem> streamResult = matchStream( ptinst.get(), test.src, 4);
+	if (!ptinstext->mergeLayers()) throw std::runtime_error("error merging layers of term match automaton");
+	std::vector<strus::analyzer::PatternLexem> mergedResult = mt->match( test.src, std::strlen( test.src));
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with patterns compiled in layers");
+	return isEqual( result, expected) && isEqual( streamResult, expected) && isEqual( mergedResult, expected);
+}
+
+/// \brief Check that the lexems of patterns matched on a normalized source have the positions of the original source, in block and in stream mode with chunks splitting multibyte characters
+static bool matchNormalizedEqual( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "NODIACRITICS", 0);
+	ptinst->defineOption( "STREAM", 0);
+	static const PatternDef patterns[3] = {{1,"Cafe",0,0,true},{2,"STRA(SS|\xc3\x9f)E",0,0,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[1] = {{0,0,0}};
+	compile( ptinst.get(), patterns, symbols);
+
+	// ... the second 'cafe' with a precomposed and the third with a combining accent:
+	const char* src = "Ein CAF\xc3\x89 in der STRASSE, caf\xc3\xa9 au lait, Cafe\xcc\x81 Stra\xc3\x9f" "e";
+	static const ResultDef expectedar[6] = {{1,1,4,5},{2,2,17,7},{1,3,26,5},{1,4,41,6},{2,5,48,7},{0,0,0,0}};
+	std::vector<strus::analyzer::PatternLexem> expected;
+	std::size_t ei = 0;
+	for (; expectedar[ei].id; ++ei)
+	{
+		expected.push_back( strus::analyzer::PatternLexem( expectedar[ei].id, expectedar[ei].ordpos, strus::analyzer::Position( 0, expectedar[ei].origpos), expectedar[ei].origsize));
+	}
+	std::vector<strus::analyzer::PatternLexem> result = match( ptinst.get(), src);
+	std::vector<strus::analyzer::PatternLexem> streamResult = matchStream( ptinst.get(), src, 3);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching normalized source");
+	return isEqual( result, expected) && isEqual( streamResult, expected);
+}
+
+/// \brief Check that the code page of the source mapped to a one byte character set gives the characters of the patterns a byte of their own
+/// \note With the lowest 7 bits of the characters as mapping, the second word would be a false candidate, because 'Һ' (U+04BA) would collide with 'к' (U+043A)
+static bool matchCodePageCandidates( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "BYTECHAR", 0);
+	static const PatternDef patterns[2] = {{1,"\xD0\xBC\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0",0,0,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[1] = {{0,0,0}};
+	compile( ptinst.get(), patterns, symbols);
+
+	const char* src = "\xD0\xBC\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0 \xD0\xBC\xD0\xBE\xD1\x81\xD2\xBA\xD0\xB2\xD0\xB0 \xD0\x9C\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0";
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the statistics interface");
+	std::vector<strus::analyzer::PatternLexem> result = mt->match( src, std::strlen( src));
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with code page");
+	strus::analyzer::PatternMatcherStatistics stats = mtext->getStatistics();
+	if (statisticsValue( stats, "nofApproxCandidates") != 1.0 || statisticsValue( stats, "approxFalsePositiveRate") != 0.0) return false;
+	return result.size() == 1 && result[0].id() == 1 && result[0].origpos().ofs() == 0 && result[0].origsize() == 12;
+}
+
+/// \brief Check the statistics of the phases of the lexer measured with the option "STATISTICS"
+/// \note The lexems 'abc' are superseded by the lexems of the higher level covering them
+static bool matchProfileStatistics( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "STATISTICS", 0);
+	static const PatternDef patterns[3] = {{1,"abc",0,0,true},{2,"[a-z]+",0,1,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[1] = {{0,0,0}};
+	compile( ptinst.get(), patterns, symbols);
+
+	const char* src = "abcd xy abcd";
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the statistics interface");
+	std::vector<strus::analyzer::PatternLexem> result = mt->match( src, std::strlen( src));
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with statistics");
+	strus::analyzer::PatternMatcherStatistics stats = mtext->getStatistics();
+	if (statisticsValue( stats, "nofBytesScanned") != (double)std::strlen( src)) return false;
+	if (statisticsValue( stats, "nofCallbacks") < (double)result.size() || statisticsValue( stats, "callbacksPerKB") <= 0.0) return false;
+	if (statisticsValue( stats, "nofCallbacksPattern1") != 2.0 || statisticsValue( stats, "nofSuperseded") < 2.0) return false;
+	return !result.empty();
+}
+
+/// \brief Check the segments and the continuous ordinal positions of the lexems of a document matched split into segments
+static bool matchSegmentsEqual( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	static const PatternDef patterns[2] = {{1,"[a-z]+",0,0,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[1] = {{0,0,0}};
+	compile( ptinst.get(), patterns, symbols);
+
+	static const int segidar[4] = {3, 5, 7, 9};
+	static const char* srcar[4] = {"abc de", "", "fgh", "ij kl"};
+	std::size_t srcsizear[4];
+	std::size_t si = 0;
+	for (; si < 4; ++si) srcsizear[ si] = std::strlen( srcar[ si]);
+
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the segment interface");
+	std::vector<strus::analyzer::PatternLexem> result;
+	if (!mtext->matchSegments( segidar, srcar, srcsizear, 4, result))
+	{
+		throw std::runtime_error( "error matching segments");
+	}
+	struct {int seg; int ordpos; int origpos; int origsize;} expectedar[5] = {{3,1,0,3},{3,2,4,2},{7,3,0,3},{9,4,0,2},{9,5,3,2}};
+	if (result.size() != 5) return false;
+	std::size_t ri = 0;
+	for (; ri < 5; ++ri)
+	{
+		if (result[ ri].id() != 1 || result[ ri].ordpos() != expectedar[ ri].ordpos) return false;
+		if (result[ ri].origpos().seg() != expectedar[ ri].seg || result[ ri].origpos().ofs() != expectedar[ ri].origpos) return false;
+		if (result[ ri].origsize() != expectedar[ ri].origsize) return false;
+	}
+	return true;
+}
+
+/// \brief Check that the lexems not used by a pattern matcher are not reported, except the ones marked to be always emitted
+static bool matchPrunedLexems( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternMatcherInterface> pm( strus::createPatternMatcher_std( g_errorBuffer));
+	if (!pm.get()) throw std::runtime_error("failed to create pattern matcher");
+	strus::local_ptr<strus::PatternMatcherInstanceInterface> pminst( pm->createInstance());
+	if (!pminst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+	pminst->pushTerm( 1);
+	pminst->pushTerm( 1);
+	pminst->pushExpression( strus::PatternMatcherInstanceInterface::OpSequence, 2, 2/*range*/, 0/*cardinality*/);
+	pminst->definePattern( "pair", ""/*formatstring*/, true/*visible*/);
+	if (!pminst->compile()) throw std::runtime_error("failed to compile pattern matcher");
+
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst.get());
+	if (!ptinstext) throw std::runtime_error("lexer instance does not implement the term usage interface");
+	ptinstext->defineUsedTerms( pminst.get());
+	ptinstext->defineAlwaysEmit( 3);
+	static const PatternDef patterns[4] = {{1,"[a-z]+",0,0,true},{2,"[0-9]+",0,0,true},{3,"[A-Z]+",0,0,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[1] = {{0,0,0}};
+	compile( ptinst.get(), patterns, symbols);
+
+	std::vector<strus::analyzer::PatternLexem> result = match( ptinst.get(), "ab 12 CD ef");
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with lexems pruned");
+	static const unsigned int expectedIds[3] = {1, 3, 1};
+	if (result.size() != 3) return false;
+	std::size_t ri = 0;
+	for (; ri < 3; ++ri)
+	{
+		if ((unsigned int)result[ ri].id() != expectedIds[ ri]) return false;
+	}
+	return true;
+}
+
+/// \brief Check that the lexer "dfa" gives the same result as the lexer "std" for expressions supported by both
+static bool matchDfaEqual( strus::PatternLexerInterface* pt)
+{
+	strus::local_ptr<strus::PatternLexerInterface> dfa( strus::createPatternLexer_dfa( g_errorBuffer));
+	if (!dfa.get()) throw std::runtime_error("failed to create DFA regular expression term matcher");
+	static const PatternDef patterns[6] = {{1,"[0-9]+",0,2,true},{2,"[a-zA-Z0-9]+",0,1,true},{3,"[a-z]+ [a-z]+",0,1,false},{4,"cre|creation(ist)?s?",0,0,true},{5,"creat(ionists|ed)|eat|[0-9]+th|1",0,3,true},{0,0,0,0,0}};
+	static const SymbolDef symbols[3] = {{10,2,"The"},{10,2,"believe"},{0,0,0}};
+	const char* src = "The world was not created about 5000 years ago as some creationists still believe in the 21th century.";
+
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	strus::local_ptr<strus::PatternLexerInstanceInterface> dfainst( dfa->createInstance());
+	if (!ptinst.get() || !dfainst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	compile( ptinst.get(), patterns, symbols);
+	compile( dfainst.get(), patterns, symbols);
+	std::vector<strus::analyzer::PatternLexem> expected = match( ptinst.get(), src);
+	std::vector<strus::analyzer::PatternLexem> result = match( dfainst.get(), src);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with DFA lexer");
+	return !expected.empty() && isEqual( result, expected);
+}
+
+/// \brief Check that the symbols of a test defined with a dictionary file give the same result as the symbols defined one by one
+/// \param[in] cacheDirectory directory where the dictionary image is stored and mapped from, NULL for a dictionary built in memory
+/// \param[in] normalization normalization option of the lexer ("NORMALIZE" or "NODIACRITICS"), NULL for none
+static bool matchDictionaryEqual( strus::PatternLexerInterface* pt, const TestDef& test, const std::vector<strus::analyzer::PatternLexem>& expected, const char* cacheDirectory, const char* normalization=0)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	strus::PatternLexerInstanceExtInterface* ptinstext = dynamic_cast<strus::PatternLexerInstanceExtInterface*>( ptinst.get());
+	if (!ptinstext) throw std::runtime_error("lexer instance does not implement the dictionary interface");
+	if (normalization) ptinst->defineOption( normalization, 0);
+	ptinst->defineOption( "DOTALL", 0);
+	if (cacheDirectory) ptinstext->defineCacheDirectory( cacheDirectory);
+
+	std::set<unsigned int> patternids;
+	std::size_t si = 0;
+	for (; test.symbols[si].name; ++si) patternids.insert( test.symbols[si].patternid);
+	std::set<unsigned int>::const_iterator pi = patternids.begin(), pe = patternids.end();
+	for (; pi != pe; ++pi)
+	{
+		std::ostringstream filename;
+		filename << "symbols" << *pi << ".txt";
+		std::string filepath = g_tempDirectory.filePath( filename.str());
+		FILE* fh = std::fopen( filepath.c_str(), "wb");
+		if (!fh) throw std::runtime_error("failed to write symbol dictionary file");
+		for (si = 0; test.symbols[si].name; ++si)
+		{
+			if (test.symbols[si].patternid == *pi) std::fprintf( fh, "%s\t%u\n", test.symbols[si].name, test.symbols[si].id);
+		}
+		std::fclose( fh);
+		ptinstext->defineSymbolDictionary( *pi, filepath);
+	}
+	static const SymbolDef nosymbols[1] = {{0,0,0}};
+	compile( ptinst.get(), test.patterns, nosymbols);
+	std::vector<strus::analyzer::PatternLexem> result = match( ptinst.get(), test.src);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching with symbol dictionary");
+	return isEqual( result, expected);
+}
+
+/// \brief Check that the symbols of a test defined with a dictionary file are normalized like the symbols defined one by one and like the source
+static bool matchNormalizedDictionaryEqual( strus::PatternLexerInterface* pt, const TestDef& test)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "NORMALIZE", 0);
+	ptinst->defineOption( "DOTALL", 0);
+	compile( ptinst.get(), test.patterns, test.symbols);
+	std::vector<strus::analyzer::PatternLexem> expected = match( ptinst.get(), test.src);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching normalized source");
+	return matchDictionaryEqual( pt, test, expected, NULL, "NORMALIZE") && matchDictionaryEqual( pt, test, expected, g_tempDirectory.path().c_str(), "NORMALIZE");
+}
+
 static const TestDef g_tests[32] =
 {
 	{
@@ -208,6 +783,237 @@ static const TestDef g_tests[32] =
 	}
 };
 
+/// \brief Create a lexer instance for the patterns of a test compiled with a compile option selecting a variant of the automaton
+/// \param[in] option compile option selecting the variant, NULL for the generic variant
+static strus::PatternLexerInstanceInterface* createVariantInstance( strus::PatternLexerInterface* pt, const TestDef& test, const char* option, double optionValue)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineOption( "DOTALL", 0);
+	if (option) ptinst->defineOption( option, optionValue);
+	compile( ptinst.get(), test.patterns, test.symbols);
+	return ptinst.release();
+}
+
+/// \brief Get a document of 4MB built by repeating the source of a test
+static std::string repeatedSource( const TestDef& test)
+{
+	std::string rt;
+	while (rt.size() < (1<<22))
+	{
+		rt.append( test.src);
+		rt.push_back( '\n');
+	}
+	return rt;
+}
+
+/// \brief Check that a variant of the automaton selected by a compile option gives the same result on a big document as the generic variant
+static bool matchVariantEqual( strus::PatternLexerInterface* pt, const TestDef& test, const char* option, double optionValue)
+{
+	std::string doc = repeatedSource( test);
+	strus::local_ptr<strus::PatternLexerInstanceInterface> genericinst( createVariantInstance( pt, test, NULL, 0));
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( createVariantInstance( pt, test, option, optionValue));
+	std::vector<strus::analyzer::PatternLexem> expected = match( genericinst.get(), doc);
+	std::vector<strus::analyzer::PatternLexem> result = match( ptinst.get(), doc);
+	if (g_errorBuffer->hasError()) throw std::runtime_error("error matching big document");
+	return !expected.empty() && isEqual( result, expected);
+}
+
+/// \brief Measure the scan throughput of the patterns of a test on a document built by repeating its source
+/// \param[in] option compile option selecting the platform variant, NULL for the generic variant
+static void measureThroughput( strus::PatternLexerInterface* pt, const TestDef& test, const char* option, double optionValue=0)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( createVariantInstance( pt, test, option, optionValue));
+	std::string doc = repeatedSource( test);
+	enum {NofRuns=5};
+	std::clock_t start = std::clock();
+	for (int ri=0; ri<NofRuns; ++ri)
+	{
+		(void)match( ptinst.get(), doc);
+	}
+	double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+	double mbytes = (double)doc.size() * NofRuns / (1024.0 * 1024.0);
+	if (g_errorBuffer->hasError()) throw std::runtime_error( "error in throughput measurement");
+	std::cerr << "throughput " << (option ? option : "GENERIC") << ": "
+			<< std::fixed << std::setprecision(2)
+			<< (duration > 0.0 ? (mbytes / duration) : 0.0) << " MB/s" << std::endl;
+}
+
+/// \brief Get a word of the latency benchmark, different for every index
+static std::string latencyWord( unsigned int idx)
+{
+	std::string rt;
+	unsigned int val = idx * 7919 + 12345;
+	do
+	{
+		rt.push_back( 'a' + val % 26);
+		val /= 26;
+	}
+	while (val);
+	return rt;
+}
+
+static double latencyClock()
+{
+	struct timespec ts;
+	if (0!=::clock_gettime( CLOCK_MONOTONIC, &ts)) return 0.0;
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/// \brief Measure the latency of matching queries with a lexer context and print its median and 99th percentile
+/// \param[in] toBuffer true, if the lexems are written to a buffer with PatternLexerContextExtInterface::matchToBuffer, false for PatternLexerContextInterface::match
+static void measureQueryLatency( strus::PatternLexerContextInterface* mt, const std::vector<std::string>& queries, unsigned int nofPatterns, bool toBuffer)
+{
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt);
+	if (toBuffer && !mtext) throw std::runtime_error("lexer context does not implement the output interface");
+	std::vector<strus::analyzer::PatternLexem> buffer;
+	std::vector<double> latencies;
+	int ri = 0;
+	for (; ri < 2; ++ri)
+	{
+		// ... first round for warming up the buffers
+		latencies.clear();
+		std::vector<std::string>::const_iterator qi = queries.begin(), qe = queries.end();
+		for (; qi != qe; ++qi)
+		{
+			double start = latencyClock();
+			if (toBuffer)
+			{
+				if (!mtext->matchToBuffer( qi->c_str(), qi->size(), buffer))
+				{
+					throw std::runtime_error( "error matching query in latency measurement");
+				}
+			}
+			else
+			{
+				buffer = mt->match( qi->c_str(), qi->size());
+				if (buffer.empty() && g_errorBuffer->hasError())
+				{
+					throw std::runtime_error( "error matching query in latency measurement");
+				}
+			}
+			latencies.push_back( latencyClock() - start);
+		}
+	}
+	std::sort( latencies.begin(), latencies.end());
+	std::cerr << "latency " << (toBuffer ? "matchToBuffer" : "match") << " " << nofPatterns << " patterns: "
+			<< std::fixed << std::setprecision(2)
+			<< "p50 " << latencies[ latencies.size() / 2] * 1e6 << " us, "
+			<< "p99 " << latencies[ latencies.size() * 99 / 100] * 1e6 << " us" << std::endl;
+}
+
+/// \brief Create a lexer instance for the latency benchmarks
+/// \param[in] nofPatterns number of patterns of the lexer, words and every 16th a word followed by digits
+static strus::PatternLexerInstanceInterface* createLatencyInstance( strus::PatternLexerInterface* pt, unsigned int nofPatterns)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+	if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	ptinst->defineLexem( 1, "[a-z]+", 0, 0, strus::analyzer::BindContent);
+	unsigned int pi = 0;
+	for (; pi < nofPatterns; ++pi)
+	{
+		std::string expr = latencyWord( pi);
+		if (pi % 16 == 0) expr.append( "[0-9]+");
+		ptinst->defineLexem( pi+2, expr, 0, 1, strus::analyzer::BindContent);
+	}
+	if (!ptinst->compile()) throw std::runtime_error("error building term match automaton for latency measurement");
+	return ptinst.release();
+}
+
+/// \brief Get the query sized inputs (5 to 40 bytes) of the latency benchmarks
+static std::vector<std::string> latencyQueries( unsigned int nofPatterns)
+{
+	enum {NofQueries=2000, MinQuerySize=5, MaxQuerySize=40};
+	std::vector<std::string> queries;
+	unsigned int rnd = 4711;
+	while (queries.size() < (std::size_t)NofQueries)
+	{
+		std::string query;
+		while (query.size() < (std::size_t)MinQuerySize)
+		{
+			rnd = rnd * 1103515245 + 12345;
+			std::string word = latencyWord( (rnd >> 8) % (nofPatterns * 2));
+			if (query.size() + word.size() + 1 > (std::size_t)MaxQuerySize) break;
+			if (!query.empty()) query.push_back( ' ');
+			query.append( word);
+			if ((rnd >> 4) % 4 == 0) query.append( "42");
+		}
+		if (query.size() >= (std::size_t)MinQuerySize) queries.push_back( query);
+	}
+	return queries;
+}
+
+/// \brief Measure the latency of matching query sized inputs with match and with matchToBuffer
+/// \param[in] nofPatterns number of patterns of the lexer
+static void measureLatency( strus::PatternLexerInterface* pt, unsigned int nofPatterns)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( createLatencyInstance( pt, nofPatterns));
+	std::vector<std::string> queries = latencyQueries( nofPatterns);
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	if (!mt.get()) throw std::runtime_error("failed to create lexer context for latency measurement");
+	measureQueryLatency( mt.get(), queries, nofPatterns, false);
+	measureQueryLatency( mt.get(), queries, nofPatterns, true);
+}
+
+/// \brief Measure the time per field of matching the query sized inputs as one batch with matchBatch compared with a loop calling match for each of them
+/// \param[in] nofPatterns number of patterns of the lexer
+static void measureBatch( strus::PatternLexerInterface* pt, unsigned int nofPatterns)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( createLatencyInstance( pt, nofPatterns));
+	std::vector<std::string> queries = latencyQueries( nofPatterns);
+	strus::local_ptr<strus::PatternLexerContextInterface> mt( ptinst->createContext());
+	strus::PatternLexerContextExtInterface* mtext = dynamic_cast<strus::PatternLexerContextExtInterface*>( mt.get());
+	if (!mtext) throw std::runtime_error("lexer context does not implement the batch interface");
+
+	std::vector<const char*> srcar;
+	std::vector<std::size_t> srcsizear;
+	std::vector<std::string>::const_iterator qi = queries.begin(), qe = queries.end();
+	for (; qi != qe; ++qi)
+	{
+		srcar.push_back( qi->c_str());
+		srcsizear.push_back( qi->size());
+	}
+	enum {NofRuns=20};
+	std::vector<strus::analyzer::PatternLexem> result;
+	std::vector<std::size_t> resultidxar;
+	double loopTime = 0.0;
+	double batchTime = 0.0;
+	int ri = 0;
+	for (; ri <= NofRuns; ++ri)
+	{
+		// ... the first run is for warming up the buffers
+		double start = latencyClock();
+		std::size_t nofLexems = 0;
+		for (qi = queries.begin(); qi != qe; ++qi)
+		{
+			nofLexems += mt->match( qi->c_str(), qi->size()).size();
+		}
+		double loopEnd = latencyClock();
+		if (!mtext->matchBatch( &srcar[0], &srcsizear[0], srcar.size(), result, resultidxar))
+		{
+			throw std::runtime_error( "error matching batch in batch measurement");
+		}
+		double batchEnd = latencyClock();
+		if (result.size() != nofLexems) throw std::runtime_error( "result of matchBatch differs from the one of match in batch measurement");
+		if (ri)
+		{
+			loopTime += loopEnd - start;
+			batchTime += batchEnd - loopEnd;
+		}
+	}
+	double nofFields = (double)queries.size() * NofRuns;
+	std::cerr << "batch of " << queries.size() << " fields " << nofPatterns << " patterns: "
+			<< std::fixed << std::setprecision(2)
+			<< "loop of match " << loopTime / nofFields * 1e6 << " us/field, "
+			<< "matchBatch " << batchTime / nofFields * 1e6 << " us/field, "
+			<< "speedup " << (batchTime > 0.0 ? (loopTime / batchTime) : 0.0) << std::endl;
+}
+
+static void printUsage( const char* argv[])
+{
+	std::cerr << "usage: " << argv[0] << " [<options>]" << std::endl;
+	std::cerr << "<options>= -h print this usage, -b run the throughput, latency and batch benchmarks after the tests" << std::endl;
+}
 
 int main( int argc, const char** argv)
 {
@@ -219,11 +1025,37 @@ int main( int argc, const char** argv)
 			std::cerr << "construction of error buffer failed" << std::endl;
 			return -1;
 		}
-		else if (argc > 1)
+		bool doBenchmark = false;
+		int argidx = 1;
+		for (; argidx < argc && argv[argidx][0] == '-'; ++argidx)
+		{
+			if (std::strcmp( argv[argidx], "-h") == 0)
+			{
+				printUsage( argv);
+				delete g_errorBuffer;
+				return 0;
+			}
+			else if (std::strcmp( argv[argidx], "-b") == 0)
+			{
+				doBenchmark = true;
+			}
+			else
+			{
+				std::cerr << "unknown option " << argv[argidx] << std::endl;
+				printUsage( argv);
+				delete g_errorBuffer;
+				return 1;
+			}
+		}
+		if (argidx < argc)
 		{
 			std::cerr << "too many arguments" << std::endl;
+			printUsage( argv);
+			delete g_errorBuffer;
 			return 1;
 		}
+		//... a fresh directory for every run, so that the first compilation with a cache stores its entry and does not load one of a run before
+		g_tempDirectory.create();
 		strus::local_ptr<strus::PatternLexerInterface> pt( strus::createPatternLexer_std( g_errorBuffer));
 		if (!pt.get()) throw std::runtime_error("failed to create regular expression term matcher");
 		std::size_t ti = 0;
@@ -259,6 +1091,93 @@ int main( int argc, const char** argv)
 			{
 				throw std::runtime_error( "test failed");
 			}
+			if (!matchStreamEqual( pt.get(), g_tests[ti], result))
+			{
+				throw std::runtime_error( "test failed, stream result is different");
+			}
+			if (!matchBatchEqual( ptinst.get(), g_tests[ti].src, result))
+			{
+				throw std::runtime_error( "test failed, batch result is different");
+			}
+			if (!matchOutputEqual( ptinst.get(), g_tests[ti].src, result))
+			{
+				throw std::runtime_error( "test failed, result written to buffer or sink is different");
+			}
+			if (!matchPipelineEqual( ptinst.get(), g_tests[ti].src, result))
+			{
+				throw std::runtime_error( "test failed, result of pattern match pipeline is different");
+			}
+			if (!matchShardedEqual( pt.get(), g_tests[ti], result))
+			{
+				throw std::runtime_error( "test failed, result of patterns split into shards is different");
+			}
+			if (!matchCachedEqual( pt.get(), g_tests[ti], result))
+			{
+				throw std::runtime_error( "test failed, result of patterns loaded from the cache is different");
+			}
+			if (!matchLayeredEqual( pt.get(), g_tests[ti], result))
+			{
+				throw std::runtime_error( "test failed, result of patterns compiled in layers is different");
+			}
+			if (!matchDictionaryEqual( pt.get(), g_tests[ti], result, NULL) || !matchDictionaryEqual( pt.get(), g_tests[ti], result, g_tempDirectory.path().c_str()))
+			{
+				throw std::runtime_error( "test failed, result with symbol dictionary is different");
+			}
+			if (!matchNormalizedDictionaryEqual( pt.get(), g_tests[ti]))
+			{
+				throw std::runtime_error( "test failed, result with symbol dictionary on normalized source is different");
+			}
+		}
+		if (!matchCodePageCandidates( pt.get()))
+		{
+			throw std::runtime_error( "test failed, false candidates of patterns matched on the source mapped to a one byte character set");
+		}
+		if (!matchNormalizedEqual( pt.get()))
+		{
+			throw std::runtime_error( "test failed, positions of lexems matched on normalized source are not the ones of the original source");
+		}
+		if (!matchProfileStatistics( pt.get()))
+		{
+			throw std::runtime_error( "test failed, statistics of the phases of the lexer");
+		}
+		if (!matchSegmentsEqual( pt.get()))
+		{
+			throw std::runtime_error( "test failed, positions of lexems matched on the segments of a document");
+		}
+		if (!matchPrunedLexems( pt.get()))
+		{
+			throw std::runtime_error( "test failed, lexems not used by the pattern matcher are reported");
+		}
+		if (!matchDfaEqual( pt.get()))
+		{
+			throw std::runtime_error( "test failed, result of the DFA lexer is different");
+		}
+		if (!matchVariantEqual( pt.get(), g_tests[0], "HOSTTUNED", 0))
+		{
+			throw std::runtime_error( "test failed, result of host tuned automaton is different");
+		}
+		if (!matchVariantEqual( pt.get(), g_tests[0], "THREADS", 4))
+		{
+			throw std::runtime_error( "test failed, result of parallel match is different");
+		}
+		if (!matchVariantEqual( pt.get(), g_tests[0], "SHARDS", 4))
+		{
+			throw std::runtime_error( "test failed, result of patterns split into shards is different");
+		}
+		if (doBenchmark)
+		{
+			measureThroughput( pt.get(), g_tests[0], NULL);
+			measureThroughput( pt.get(), g_tests[0], "HOSTTUNED");
+			measureThroughput( pt.get(), g_tests[0], "THREADS", 4);
+			measureThroughput( pt.get(), g_tests[0], "SHARDS", 4);
+			measureLatency( pt.get(), 1000);
+			measureLatency( pt.get(), 50000);
+			measureBatch( pt.get(), 1000);
+			measureBatch( pt.get(), 50000);
+			if (g_errorBuffer->hasError())
+			{
+				throw std::runtime_error( "error in latency measurement");
+			}
 		}
 		std::cerr << "OK" << std::endl;
 		delete g_errorBuffer;